@@ -0,0 +1,60 @@
+#include <libembed/hal/clock.h>
+#include <libembed/util/coroutines.h>
+#include <libembed/util/debug.h>
+#include <libembed/bsp/autobsp.h>
+
+using namespace embed;
+
+// Number of scheduler passes per measurement
+#define PASSES 10000
+
+// Entry points of the coroutines
+void idle();
+void benchmark();
+
+// Coroutines which are only scheduled to make the scheduler do some work
+coroutines::Coroutine<128> idleCoroutine1{ idle };
+coroutines::Coroutine<128> idleCoroutine2{ idle };
+
+// Coroutine running the measurements
+coroutines::Coroutine<512> benchmarkCoroutine{ benchmark };
+
+int main() {
+    // Initialize the clock HAL and the virtual COM port used for the log
+    clock::init();
+    clock::setMaximumFrequency();
+    board::beginVCP(115200);
+
+    idleCoroutine1.start();
+    idleCoroutine2.start();
+    benchmarkCoroutine.start();
+
+    coroutines::enterScheduler();
+}
+
+void idle() {
+    while(1) yield;
+}
+
+// Measures the average number of CPU cycles of a scheduler pass
+uint32_t measure() {
+    uint32_t start = clock::getTimestamp();
+    for(int i = 0; i < PASSES; i++) yield;
+    return (clock::getTimestamp() - start) / PASSES;
+}
+
+void benchmark() {
+    while(1) {
+        // Tracing compiled in, but disabled at runtime
+        debug::setLevelMask(debug::MODULE_COROUTINES, 1 << debug::LEVEL_INFO);
+        uint32_t filtered = measure();
+
+        // Tracing enabled at runtime
+        debug::setLevelMask(debug::MODULE_COROUTINES, debug::LEVELMASK_ALL);
+        uint32_t enabled = measure();
+
+        debug::setLevelMask(debug::MODULE_COROUTINES, 1 << debug::LEVEL_INFO);
+        libembed_debug_info("Cycles per scheduler pass", debug::field("filtered", filtered), debug::field("enabled", enabled));
+        clock::delay(1000);
+    }
+}
@@ -0,0 +1,69 @@
+#include <libembed/hal/clock.h>
+#include <libembed/util/format.h>
+#include <libembed/bsp/autobsp.h>
+#include <stdio.h>
+
+using namespace embed;
+
+// Set to false for measuring the code size without snprintf()
+#define BENCHMARK_SNPRINTF true
+
+// Number of calls per measurement
+#define ITERATIONS 1000
+
+char buffer[64];
+
+// Values are volatile, so the compiler can't evaluate the calls at compile time
+volatile int32_t integer = -12345;
+volatile uint32_t hex = 0xBEEF;
+volatile int32_t q16 = 0x3243F; // 3.14159 in Q15.16
+const char* volatile string = "sensor";
+
+// Prints the average number of timestamp ticks per call of a measured function
+template<typename Function>
+void measure(const char* name, Function function) {
+    uint32_t start = clock::getTimestamp();
+    for(int i = 0; i < ITERATIONS; i++) function();
+    uint32_t ticks = (clock::getTimestamp() - start) / ITERATIONS;
+
+    format::format_to(board::UART_VCP, "{:<28} {:>6} ticks/call  \"{}\"\r\n", name, ticks, buffer);
+}
+
+int main() {
+    // Initialize the clock HAL and the virtual COM port
+    clock::init();
+    clock::setMaximumFrequency();
+    board::beginVCP(115200);
+
+    format::format_to(board::UART_VCP, "Timestamp frequency: {} Hz\r\n", clock::getTimestampFrequency());
+
+    while(1) {
+        measure("format_to integer", [] {
+            format::format_to(buffer, sizeof(buffer), "x={} y={:04x}", integer, hex);
+        });
+        measure("format_to string", [] {
+            format::format_to(buffer, sizeof(buffer), "{}: {:>8}", string, integer);
+        });
+        measure("format_to fixed-point", [] {
+            format::format_to(buffer, sizeof(buffer), "pi={:.4}", format::fixed(q16, 16));
+        });
+
+        #if BENCHMARK_SNPRINTF
+        measure("snprintf integer", [] {
+            snprintf(buffer, sizeof(buffer), "x=%ld y=%04lx", (long)integer, (unsigned long)hex);
+        });
+        measure("snprintf string", [] {
+            snprintf(buffer, sizeof(buffer), "%s: %8ld", string, (long)integer);
+        });
+        measure("snprintf fixed-point", [] {
+            // The integer and fractional parts have to be split manually without float support
+            int32_t value = q16;
+            snprintf(buffer, sizeof(buffer), "pi=%ld.%04ld", (long)(value >> 16), (long)(((value & 0xFFFF) * 10000 + 0x8000) >> 16));
+        });
+        #endif
+
+        board::UART_VCP.flush();
+        board::UART_VCP.write("\r\n");
+        clock::delay(2000);
+    }
+}
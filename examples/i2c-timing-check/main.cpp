@@ -0,0 +1,89 @@
+#include <libembed/arch/arm/stm32/stm32f412/i2c_timing.h>
+#include <stdio.h>
+
+using namespace embed::arch::arm::stm32::stm32f412;
+
+// PCLK1 frequencies to check, in Hz. The interfaces support 2 to 50 MHz, fast mode requires 4 MHz.
+const uint32_t PCLK_FREQUENCIES[] = { 2000000, 4000000, 8000000, 10000000, 16000000, 25000000, 36000000, 42000000, 45000000, 50000000 };
+
+// SCL frequencies to check, in Hz
+const uint32_t BUS_FREQUENCIES[] = { 100000, 400000 };
+
+// Register values given by the reference manual (RM0402) and computed by hand
+struct Reference {
+    uint32_t pclk;
+    uint32_t freq;
+    uint32_t ccr;
+    uint32_t trise;
+};
+
+const Reference REFERENCES[] = {
+    // Standard mode: CCR = 5000 ns / TPCLK1, TRISE = 1000 ns / TPCLK1 + 1
+    { 8000000, 100000, 0x28, 9 },
+    { 42000000, 100000, 210, 43 },
+    // Fast mode: 42 MHz isn't a multiple of 10 MHz, so DUTY = 0 comes closer to 400 kHz
+    { 42000000, 400000, i2c::CCR_FAST_MODE | 35, 13 },
+    { 50000000, 400000, i2c::CCR_FAST_MODE | i2c::CCR_DUTY | 5, 16 },
+};
+
+int failures = 0;
+
+// Prints a failed check
+void fail(uint32_t pclk, uint32_t freq, const char* message) {
+    printf("FAIL  PCLK1 %2lu MHz, %3lu kHz: %s\n", (unsigned long)(pclk / 1000000), (unsigned long)(freq / 1000), message);
+    failures++;
+}
+
+// Checks the generated SCL waveform against the I2C specification
+void check(uint32_t pclk, uint32_t freq) {
+    uint32_t ccr = i2c::clockControl(pclk, freq);
+    uint32_t trise = i2c::riseTime(pclk, freq);
+    if(ccr == 0) return fail(pclk, freq, "frequency not supported");
+
+    bool fast = ccr & i2c::CCR_FAST_MODE;
+    uint32_t count = ccr & i2c::CCR_CLOCK_CONTROL;
+    if(fast != (freq > 100000)) return fail(pclk, freq, "wrong mode");
+    if(count < (fast ? 1u : 4u)) return fail(pclk, freq, "CCR below the minimum");
+
+    // High and low time of SCL in cycles of PCLK1
+    uint32_t high = fast && (ccr & i2c::CCR_DUTY) ? 9 * count : count;
+    uint32_t low = !fast ? count : ccr & i2c::CCR_DUTY ? 16 * count : 2 * count;
+    double highNs = 1e9 * high / pclk;
+    double lowNs = 1e9 * low / pclk;
+    double scl = (double)pclk / (high + low);
+
+    // Minimum SCL low and high times of the I2C specification
+    if(lowNs < (fast ? 1300 : 4700)) fail(pclk, freq, "SCL low time too short");
+    if(highNs < (fast ? 600 : 4000)) fail(pclk, freq, "SCL high time too short");
+    if(scl > freq) fail(pclk, freq, "bus faster than requested");
+
+    // TRISE covers the maximum rise time of 1000 ns or 300 ns, but no more than one extra cycle
+    double riseNs = fast ? 300 : 1000;
+    if(1e9 * (trise - 1) / pclk > riseNs || 1e9 * trise / pclk <= riseNs) fail(pclk, freq, "wrong TRISE");
+
+    printf("PCLK1 %2lu MHz, %3lu kHz: CCR 0x%04lx, TRISE %2lu, SCL %6.1f kHz (low %6.0f ns, high %6.0f ns)\n",
+        (unsigned long)(pclk / 1000000), (unsigned long)(freq / 1000), (unsigned long)ccr, (unsigned long)trise,
+        scl / 1000, lowNs, highNs);
+}
+
+int main() {
+    for(uint32_t pclk : PCLK_FREQUENCIES) {
+        for(uint32_t freq : BUS_FREQUENCIES) {
+            if(freq > 100000 && pclk < 4000000) continue;
+            check(pclk, freq);
+        }
+    }
+
+    for(const Reference& reference : REFERENCES) {
+        if(i2c::clockControl(reference.pclk, reference.freq) != reference.ccr) fail(reference.pclk, reference.freq, "CCR differs from the reference");
+        if(i2c::riseTime(reference.pclk, reference.freq) != reference.trise) fail(reference.pclk, reference.freq, "TRISE differs from the reference");
+    }
+
+    // Fast mode plus needs the FMPI2C interface, which isn't supported
+    if(i2c::clockControl(50000000, 1000000) != 0) fail(50000000, 1000000, "fast mode plus accepted");
+    // Fast mode requires PCLK1 to be at least 4 MHz
+    if(i2c::clockControl(2000000, 400000) != 0) fail(2000000, 400000, "fast mode accepted below 4 MHz");
+
+    printf("%d failures\n", failures);
+    return failures ? 1 : 0;
+}
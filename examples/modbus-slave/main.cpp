@@ -0,0 +1,61 @@
+#include <libembed/hal/clock.h>
+#include <libembed/hal/gpio.h>
+#include <libembed/hal/uart.h>
+#include <libembed/util/coroutines.h>
+#include <libembed/protocol/modbus.h>
+#include <libembed/bsp/autobsp.h>
+
+using namespace embed;
+
+// Modbus settings
+#define BAUDRATE 115200
+#define SLAVE_ADDRESS 17
+
+// UART connected to the RS-485 transceiver: TX on PA9, RX on PA10, driver enable on PA12
+uart::HardwareUART rs485(uart::UART1);
+
+// Registers exposed to the master
+uint16_t holdingRegisters[16];
+uint16_t inputRegisters[4];
+
+void registersWritten(uint16_t address, uint16_t count) {
+    // Holding register 0 controls the green LED
+    if(address == 0) board::led_green.write(holdingRegisters[0] != 0);
+}
+
+modbus::RegisterTable registers = { holdingRegisters, 16, inputRegisters, 4, registersWritten };
+modbus::Slave slave(rs485, SLAVE_ADDRESS, registers);
+
+void modbusTask() {
+    slave.run();
+}
+
+void statisticsTask() {
+    while(1) {
+        // Input registers 0 to 2 contain the statistics of the slave, 3 the uptime in seconds
+        inputRegisters[0] = slave.requests();
+        inputRegisters[1] = slave.crcErrors();
+        inputRegisters[2] = slave.exceptions();
+        inputRegisters[3]++;
+        clock::delay(1000);
+    }
+}
+
+coroutines::Coroutine<512> modbusCoroutine{ modbusTask };
+coroutines::Coroutine<256> statisticsCoroutine{ statisticsTask };
+
+int main() {
+    clock::init();
+    clock::setMaximumFrequency();
+
+    gpio::PA9.setAlternate(GPIO_AF7_USART1);
+    gpio::PA10.setAlternate(GPIO_AF7_USART1);
+    rs485.setRS485Mode(&gpio::PA12);
+    // 8E1, the default of Modbus RTU: the word length includes the parity bit
+    rs485.begin(BAUDRATE, 9, uart::PARITY_EVEN);
+    slave.begin(BAUDRATE);
+
+    modbusCoroutine.start();
+    statisticsCoroutine.start();
+    coroutines::enterScheduler();
+}
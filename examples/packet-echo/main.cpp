@@ -0,0 +1,40 @@
+#include <libembed/hal/clock.h>
+#include <libembed/protocol/framing.h>
+#include <libembed/bsp/autobsp.h>
+
+using namespace embed;
+
+// Baudrate of the virtual COM port
+#define BAUDRATE 2000000
+
+// Maximum length of a packet, plus the CRC-32
+#define PACKET_LENGTH (1024 + 4)
+
+uint8_t packet[PACKET_LENGTH];
+
+int main() {
+    // Initialize the clock HAL and the virtual COM port
+    clock::init();
+    clock::setMaximumFrequency();
+    board::beginVCP(BAUDRATE);
+
+    framing::Link link(board::UART_VCP, packet, PACKET_LENGTH, framing::FRAMING_COBS, framing::CHECKSUM_CRC32);
+
+    while(1) {
+        // Wait for a valid packet; corrupted packets are dropped by the link
+        size_t length = link.receive(1000);
+        if(length == 0) {
+            board::led_red.toggle();
+            continue;
+        }
+
+        // Send the packet back, prefixed with the number of packets dropped so far
+        uint8_t errors[2] = { (uint8_t)link.checksumErrors(), (uint8_t)link.framingErrors() };
+        framing::Encoder& encoder = link.encoder();
+        encoder.begin();
+        encoder.write(errors, sizeof(errors));
+        encoder.write(link.packet(), length);
+        encoder.end();
+        board::led_green.toggle();
+    }
+}
@@ -0,0 +1,66 @@
+#include <libembed/hal/clock.h>
+#include <libembed/util/coroutines.h>
+#include <libembed/util/format.h>
+#include <libembed/bsp/autobsp.h>
+
+using namespace embed;
+
+// Baudrate of the virtual COM port
+#define BAUDRATE 2000000
+
+// Maximum length of a received line
+#define LINE_LENGTH 256
+
+// Entry points of the coroutines
+void receiver();
+void blink();
+
+// Coroutine receiving the lines
+coroutines::Coroutine<512> receiverCoroutine{ receiver };
+
+// Coroutine blinking an LED while the receiver is waiting for data
+coroutines::Coroutine<128> blinkCoroutine{ blink };
+
+uint8_t line[LINE_LENGTH];
+
+int main() {
+    // Initialize the clock HAL and the virtual COM port
+    clock::init();
+    clock::setMaximumFrequency();
+    board::beginVCP(BAUDRATE);
+
+    receiverCoroutine.start();
+    blinkCoroutine.start();
+
+    coroutines::enterScheduler();
+}
+
+void blink() {
+    while(1) {
+        board::led_green.toggle();
+        clock::delay(500);
+    }
+}
+
+void receiver() {
+    uint32_t lines = 0;
+    uint32_t bytes = 0;
+
+    while(1) {
+        // Wait for a complete line; the DMA keeps receiving while the reply is sent
+        size_t length = board::UART_VCP.readUntil('\n', line, LINE_LENGTH, 10000);
+        if(length == 0) continue;
+
+        lines++;
+        bytes += length;
+        if(board::UART_VCP.overrun()) {
+            board::UART_VCP.write("Received data has been lost, increase LIBEMBED_CONFIG_STM32_UART_RX_BUFFER_SIZE.\r\n");
+        }
+
+        // Echo every 100th line together with the statistics
+        if(lines % 100 == 0) {
+            board::UART_VCP.write(line, length);
+            format::format_to(board::UART_VCP, "{} lines, {} bytes received\r\n", lines, bytes);
+        }
+    }
+}
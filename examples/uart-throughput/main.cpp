@@ -0,0 +1,79 @@
+#include <libembed/hal/clock.h>
+#include <libembed/util/coroutines.h>
+#include <libembed/util/format.h>
+#include <libembed/bsp/autobsp.h>
+
+using namespace embed;
+
+// Baudrate of the measurement
+#define BAUDRATE 921600
+
+// Number of bytes sent per measurement
+#define BLOCK_SIZE 4096
+
+// Entry points of the coroutines
+void benchmark();
+void counter();
+
+// Coroutine running the measurements
+coroutines::Coroutine<512> benchmarkCoroutine{ benchmark };
+
+// Coroutine counting its scheduler passes, i.e. the CPU time left for other coroutines
+coroutines::Coroutine<128> counterCoroutine{ counter };
+volatile uint32_t counterPasses = 0;
+
+uint8_t block[BLOCK_SIZE];
+
+int main() {
+    // Initialize the clock HAL and the virtual COM port
+    clock::init();
+    clock::setMaximumFrequency();
+    board::beginVCP(BAUDRATE);
+
+    for(size_t i = 0; i < BLOCK_SIZE; i++) block[i] = 'A' + i % 26;
+
+    benchmarkCoroutine.start();
+    counterCoroutine.start();
+
+    coroutines::enterScheduler();
+}
+
+void counter() {
+    while(1) {
+        counterPasses++;
+        yield;
+    }
+}
+
+// Sends a block and prints the time spent in write() and the time until the transmission has completed
+void measure(const char* name) {
+    uint32_t passes = counterPasses;
+    uint32_t start = clock::getTimestamp();
+    board::UART_VCP.write(block, BLOCK_SIZE);
+    uint32_t returned = clock::getTimestamp();
+    board::UART_VCP.flush();
+    uint32_t completed = clock::getTimestamp();
+    passes = counterPasses - passes;
+
+    uint32_t ticksPerMicrosecond = clock::getTimestampFrequency() / 1000000;
+    uint32_t writeTime = (returned - start) / ticksPerMicrosecond;
+    uint32_t totalTime = (completed - start) / ticksPerMicrosecond;
+
+    format::format_to(board::UART_VCP, "\r\n{}: write() returned after {} us, {} bytes/s, {} passes of the counter coroutine\r\n",
+        name, writeTime, BLOCK_SIZE * 1000000ull / totalTime, passes);
+    board::UART_VCP.flush();
+}
+
+void benchmark() {
+    while(1) {
+        // Without the DMA: the transmitter is polled and the coroutine yields between the bytes
+        board::UART_VCP.setTxDMAEnabled(false);
+        measure("polling");
+
+        // Transmit buffer streamed out by the DMA
+        board::UART_VCP.setTxDMAEnabled(true);
+        measure("DMA");
+
+        clock::delay(2000);
+    }
+}
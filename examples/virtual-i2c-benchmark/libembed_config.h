@@ -0,0 +1,4 @@
+// *** libembed configuration file for host builds ***
+
+// Coroutines require an ARM target
+#define LIBEMBED_CONFIG_ENABLE_COROUTINES false
@@ -0,0 +1,112 @@
+#include <libembed/hal/i2c/virtual.h>
+#include <libembed/hal/i2c/regmap.h>
+#include <libembed/hal/i2c/queue.h>
+#include <chrono>
+#include <stdio.h>
+
+using namespace embed;
+
+// Clock frequency of the simulated bus
+#define CLOCK_FREQUENCY 400000
+
+// Number of transactions or pages per measurement
+#define ITERATIONS 10000
+
+// Addresses of the devices
+#define SENSOR_ADDRESS 0x19
+#define EEPROM_ADDRESS 0x50
+
+// Registers of the sensor
+typedef i2c::Register<0x0F, 1, i2c::ACCESS_CACHED> WHO_AM_I;
+typedef i2c::Register<0x20, 1, i2c::ACCESS_CACHED> CTRL1;
+typedef i2c::Field<CTRL1, 0xF0> CTRL1_ODR;
+typedef i2c::Register<0x28, 2, i2c::ACCESS_READ_ONLY> OUT_X;
+
+uint8_t sensorRegisters[0x30] = { };
+i2c::RegisterFile sensorFile = { sensorRegisters, sizeof(sensorRegisters), 0x20, nullptr };
+
+#define EEPROM_SIZE 4096
+#define EEPROM_PAGE_SIZE 32
+uint8_t eepromMemory[EEPROM_SIZE];
+
+// Prints the throughput of the bus and the CPU time per byte of a measured function.
+// The function returns the number of payload bytes it has transferred.
+template<typename Function>
+void measure(const char* name, i2c::VirtualBus& bus, Function function) {
+    uint64_t busStart = bus.time();
+    auto start = std::chrono::steady_clock::now();
+    size_t bytes = 0;
+    for(int i = 0; i < ITERATIONS; i++) bytes += function(i);
+    auto cpu = std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now() - start).count();
+    uint64_t busTime = bus.time() - busStart;
+
+    printf("%-32s %8llu bytes/s  %6.1f ns/byte\n", name,
+        busTime ? (unsigned long long)(bytes * 1000000000ull / busTime) : 0ull, bytes ? (double)cpu / bytes : 0.0);
+}
+
+// Writes a page to the EEPROM and polls it until the write cycle has completed
+size_t writePage(i2c::VirtualBus& bus, uint16_t address, const uint8_t* data) {
+    uint8_t message[2 + EEPROM_PAGE_SIZE] = { (uint8_t)(address >> 8), (uint8_t)address };
+    for(size_t i = 0; i < EEPROM_PAGE_SIZE; i++) message[2 + i] = data[i];
+    if(bus.write(EEPROM_ADDRESS, message, sizeof(message)) != i2c::RESULT_OK) return 0;
+    while(bus.write(EEPROM_ADDRESS, nullptr, 0) == i2c::RESULT_ADDRESS_NACK);
+    return EEPROM_PAGE_SIZE;
+}
+
+int main() {
+    i2c::VirtualBus bus;
+    bus.begin(CLOCK_FREQUENCY);
+
+    i2c::VirtualRegisterDevice sensorDevice(sensorFile);
+    i2c::VirtualEEPROM eeprom(eepromMemory, EEPROM_SIZE, EEPROM_PAGE_SIZE);
+    bus.attach(sensorDevice, SENSOR_ADDRESS);
+    bus.attach(eeprom, EEPROM_ADDRESS);
+
+    sensorRegisters[WHO_AM_I::address] = 0x33;
+    i2c::RegisterMap<sizeof(sensorRegisters), false> sensor(bus, SENSOR_ADDRESS);
+    uint8_t id = 0;
+    sensor.read<WHO_AM_I>(id);
+    sensor.writeField<CTRL1_ODR>(5);
+    printf("Sensor 0x%02x, CTRL1 = 0x%02x\n", id, sensorRegisters[CTRL1::address]);
+
+    // Register reads through the register map, with a new measurement before each one
+    measure("Register map reads", bus, [&](int i) {
+        sensorRegisters[OUT_X::address] = i & 0xFF;
+        uint16_t x;
+        return sensor.read<OUT_X>(x) == i2c::RESULT_OK ? OUT_X::width : 0;
+    });
+
+    // The same reads submitted to a transaction queue
+    i2c::TransactionQueue queue(bus);
+    measure("Queued register reads", bus, [&](int i) {
+        uint8_t reg = OUT_X::address;
+        uint8_t data[2];
+        i2c::Transaction transaction(SENSOR_ADDRESS, &reg, 1, data, sizeof(data));
+        queue.submit(transaction);
+        queue.poll();
+        return transaction.wait() == i2c::RESULT_OK ? sizeof(data) : 0;
+    });
+
+    // EEPROM page writes, limited by the write cycle of 5 ms
+    uint8_t page[EEPROM_PAGE_SIZE];
+    for(size_t i = 0; i < EEPROM_PAGE_SIZE; i++) page[i] = i * 7;
+    measure("EEPROM page writes", bus, [&](int i) {
+        return writePage(bus, (i * EEPROM_PAGE_SIZE) % EEPROM_SIZE, page);
+    });
+
+    // Register reads with a NACK in every 1000th byte, a lost arbitration in every 1000th message
+    // and 10 us of clock stretching after every 10th byte on average. Only the reads completed
+    // successfully count towards the throughput.
+    bus.resetStatistics();
+    bus.setFaults(1000, 1000);
+    bus.setClockStretching(10000, 10);
+    measure("Register reads with faults", bus, [&](int i) {
+        uint16_t x;
+        return sensor.read<OUT_X>(x) == i2c::RESULT_OK ? OUT_X::width : 0;
+    });
+
+    const i2c::BusStatistics& statistics = bus.statistics();
+    printf("Transactions: %u, NACKs: %u, arbitration lost: %u\n",
+        (unsigned)statistics.transactions, (unsigned)statistics.nacks, (unsigned)statistics.arbitrationLosses);
+    return 0;
+}
@@ -0,0 +1,102 @@
+#include <libembed/hal/uart/virtual.h>
+#include <libembed/protocol/framing.h>
+#include <libembed/protocol/modbus.h>
+#include <libembed/util/format.h>
+#include <chrono>
+#include <stdio.h>
+
+using namespace embed;
+
+// Baudrate of the simulated line
+#define BAUDRATE 115200
+
+// Number of messages or packets per measurement
+#define ITERATIONS 10000
+
+// Length of a packet, plus the CRC-32
+#define PACKET_LENGTH 64
+#define BUFFER_LENGTH (PACKET_LENGTH + 4)
+
+uint8_t packet[PACKET_LENGTH];
+uint8_t transmitBuffer[BUFFER_LENGTH];
+uint8_t receiveBuffer[BUFFER_LENGTH];
+uint8_t drain[256];
+
+// Registers of the Modbus slave, read 16 at a time
+#define MODBUS_ADDRESS 17
+#define MODBUS_REGISTERS 16
+uint16_t holdingRegisters[MODBUS_REGISTERS];
+modbus::RegisterTable registerTable = { holdingRegisters, MODBUS_REGISTERS, nullptr, 0, nullptr };
+
+// Prints the throughput of the line and the CPU time per byte of a measured function.
+// The function returns the number of payload bytes it has transferred.
+template<typename Function>
+void measure(const char* name, uart::VirtualLine& line, Function function) {
+    uint64_t lineStart = line.time();
+    auto start = std::chrono::steady_clock::now();
+    size_t bytes = 0;
+    for(int i = 0; i < ITERATIONS; i++) bytes += function();
+    auto cpu = std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now() - start).count();
+    uint64_t lineTime = line.time() - lineStart;
+
+    printf("%-28s %8llu bytes/s  %6.1f ns/byte\n", name,
+        lineTime ? (unsigned long long)(bytes * 1000000000ull / lineTime) : 0ull, (double)cpu / bytes);
+}
+
+int main() {
+    uart::VirtualLine line;
+    line.a.begin(BAUDRATE);
+    line.b.begin(BAUDRATE);
+
+    for(size_t i = 0; i < PACKET_LENGTH; i++) packet[i] = i * 7;
+
+    // Formatted text, read back by the other port
+    measure("format_to", line, [&]() {
+        size_t length = format::format_to(line.a, "t={} v={:04x}\r\n", 123456, 0xBEEF);
+        line.b.read(drain, length, 0);
+        return length;
+    });
+
+    // COBS-framed packets with a CRC-32 on an error-free line
+    framing::Link sender(line.a, transmitBuffer, BUFFER_LENGTH, framing::FRAMING_COBS, framing::CHECKSUM_CRC32);
+    framing::Link receiver(line.b, receiveBuffer, BUFFER_LENGTH, framing::FRAMING_COBS, framing::CHECKSUM_CRC32);
+    measure("COBS + CRC-32", line, [&]() {
+        sender.send(packet, PACKET_LENGTH);
+        return receiver.receive(0);
+    });
+
+    // The same with a bit error in every 1000th byte on average. Only the packets received
+    // correctly count towards the throughput.
+    line.b.setErrorRate(1000, 0);
+    measure("COBS + CRC-32, BER 1e-4", line, [&]() {
+        sender.send(packet, PACKET_LENGTH);
+        return receiver.receive(0);
+    });
+
+    printf("Corrupted bytes: %u, packets dropped: %u checksum, %u framing\n",
+        (unsigned)line.b.errors(), (unsigned)receiver.checksumErrors(), (unsigned)receiver.framingErrors());
+
+    // Modbus RTU requests on an 8E1 line. The line drives the timestamp counter, so the 3.5
+    // character gap the slave waits for before responding counts as line time.
+    uart::VirtualLine modbusLine;
+    modbusLine.a.begin(BAUDRATE, 9, uart::PARITY_EVEN);
+    modbusLine.b.begin(BAUDRATE, 9, uart::PARITY_EVEN);
+    modbusLine.useAsClock();
+
+    modbus::Slave slave(modbusLine.b, MODBUS_ADDRESS, registerTable);
+    slave.begin(BAUDRATE);
+    uint8_t request[8] = { MODBUS_ADDRESS, modbus::FUNCTION_READ_HOLDING_REGISTERS, 0, 0, 0, MODBUS_REGISTERS };
+    uint16_t crc = crc::CRC16Modbus::compute(request, 6);
+    request[6] = crc & 0xFF;
+    request[7] = crc >> 8;
+    measure("Modbus read 16 registers", modbusLine, [&]() {
+        modbusLine.a.write(request, sizeof(request));
+        slave.poll(0);
+        // Address, function code, byte count, registers and CRC
+        size_t length = modbusLine.a.read(drain, 5 + 2 * MODBUS_REGISTERS, 0);
+        return length == 5 + 2 * MODBUS_REGISTERS ? 2 * MODBUS_REGISTERS : 0;
+    });
+
+    printf("Modbus requests: %u, CRC errors: %u\n", (unsigned)slave.requests(), (unsigned)slave.crcErrors());
+    return 0;
+}
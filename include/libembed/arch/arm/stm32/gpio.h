@@ -63,6 +63,25 @@ class embed::gpio::_GPIO_Pin_specific {
          * @brief Set the GPIO to be an analog pin.
          */
         void setAnalog();
+
+        /**
+         * @brief Set the GPIO to be a push-pull output driven directly through `BSRR`.
+         *
+         * Unlike @ref gpio::DigitalOutput, this can be used by drivers which toggle the pin
+         * from an interrupt handler.
+         *
+         * @param state The initial state of the output.
+         */
+        void setOutput(bool state);
+
+        /**
+         * @brief Set the GPIO to be an open-drain output with pull-up, driven directly through `BSRR`.
+         *
+         * The level of the line can still be read through `IDR`, e.g. by bit-banged buses.
+         *
+         * @param state The initial state of the output, `true` releasing the line.
+         */
+        void setOpenDrain(bool state);
 };
 
 class embed::gpio::_AnalogInput_Pin_specific {
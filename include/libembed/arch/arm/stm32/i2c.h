@@ -6,7 +6,9 @@
 
 #include <libembed/hal/i2c/types.h>
 #include <libembed/arch/ident.h>
+#include <libembed/util/coroutines.h>
 #include "stm32_hal.h"
+#include "gpio.h"
 
 #ifndef LIBEMBED_ARCH_ARM_STM32_I2C_H_
 #define LIBEMBED_ARCH_ARM_STM32_I2C_H_
@@ -19,9 +21,87 @@ namespace embed::arch::arm::stm32::i2c {
     using namespace embed::arch::arm::stm32::LIBEMBED_MCU_LINE::i2c;
 
     /**
-     * @brief STM32 implementation of a hardware UART interface.
+     * @brief STM32 implementation of a hardware I2C master.
+     *
+     * Transactions are executed by a state machine driven by the event and error interrupts of
+     * the interface, so they progress independently of the coroutine scheduler. The calling
+     * coroutine is suspended until the transaction has completed. Transfers of at least
+     * @ref LIBEMBED_CONFIG_STM32_I2C_DMA_THRESHOLD bytes are done by the DMA if its streams are
+     * available.
+     *
+     * The interface supports standard mode up to 100 kHz and fast mode up to 400 kHz. @ref begin()
+     * throws an exception for higher frequencies.
      */
     class HardwareI2C_Master : public HardwareI2C_Master_Base {
+        private:
+            //! States of the interrupt-driven transaction
+            typedef enum {
+                //! No transaction is running
+                STATE_IDLE,
+                //! Waiting for the (repeated) start condition to be sent
+                STATE_START,
+                //! Waiting for the address to be acknowledged
+                STATE_ADDRESS,
+                //! Transmitting data
+                STATE_TRANSMIT,
+                //! Receiving data
+                STATE_RECEIVE
+            } State;
+
+            //! DMA handle of the transmitter
+            DMA_HandleTypeDef txDmaHandle_ = {};
+            //! DMA handle of the receiver
+            DMA_HandleTypeDef rxDmaHandle_ = {};
+            //! Specifies if the DMA is used for transmitting
+            bool txDmaEnabled_ = false;
+            //! Specifies if the DMA is used for receiving
+            bool rxDmaEnabled_ = false;
+
+            //! Address of the running transaction
+            Address_7B address_ = 0;
+            //! Data of the write phase
+            const uint8_t* txData_ = nullptr;
+            size_t txLength_ = 0;
+            //! Buffer of the read phase
+            uint8_t* rxData_ = nullptr;
+            size_t rxLength_ = 0;
+            //! Direction of the current phase
+            Direction direction_ = WRITE;
+            //! Number of bytes of the current phase transferred so far
+            volatile size_t index_ = 0;
+            //! State of the running transaction
+            volatile State state_ = STATE_IDLE;
+            //! Result of the last transaction, valid once @ref completed_ has been set
+            volatile TransactionResult result_ = RESULT_OK;
+            //! Set by the interrupt handlers when the transaction has completed or failed
+            coroutines::Event completed_;
+
+            //! Checks whether a transfer of @p length bytes uses the DMA.
+            bool useDMA_(bool enabled, size_t length) const {
+                return enabled && length >= LIBEMBED_CONFIG_STM32_I2C_DMA_THRESHOLD && length >= 2;
+            }
+
+            //! Clears the ADDR flag, which releases the clock after the address has been acknowledged.
+            void clearAddressFlag_();
+
+            //! Configures the interface for a phase and requests a (repeated) start condition.
+            void startPhase_(Direction direction);
+
+            //! Terminates the running transaction. Must be called with interrupts disabled or from an interrupt handler.
+            void finish_(TransactionResult result);
+
+            //! Advances the transaction on an event interrupt.
+            void handleEvent_();
+
+            //! Aborts the transaction on an error interrupt.
+            void handleError_();
+
+            //! Callback of the HAL when a DMA transfer has completed or failed
+            static void dmaTransferComplete_(DMA_HandleTypeDef* handle);
+
+            friend void __i2c_event_irq_handler(I2C_TypeDef* i2c);
+            friend void __i2c_error_irq_handler(I2C_TypeDef* i2c);
+
         public:
             using HardwareI2C_Master_Base::HardwareI2C_Master_Base;
 
@@ -30,6 +110,246 @@ namespace embed::arch::arm::stm32::i2c {
             void stopMessage() override;
             AcknowledgementType sendByte(uint8_t data) override;
             uint8_t readByte(AcknowledgementType ackType = ACK) override;
+
+            /**
+             * @brief Enables or disables transmitting using the DMA.
+             *
+             * The DMA is enabled by @ref begin() if the DMA stream of the interface is not used
+             * by another peripheral, e.g. a UART.
+             *
+             * @param enabled Specifies whether the DMA should be used.
+             * @return Returns `true` if the DMA is used for transmitting after the call.
+             */
+            bool setTxDMAEnabled(bool enabled);
+
+            /**
+             * @brief Enables or disables receiving using the DMA.
+             *
+             * The DMA is enabled by @ref begin() if the DMA stream of the interface is not used
+             * by another peripheral, e.g. a UART.
+             *
+             * @param enabled Specifies whether the DMA should be used.
+             * @return Returns `true` if the DMA is used for receiving after the call.
+             */
+            bool setRxDMAEnabled(bool enabled);
+
+            TransactionResult write(Address_7B address, const uint8_t* data, size_t length, uint32_t timeout = LIBEMBED_CONFIG_I2C_DEFAULT_TIMEOUT) override;
+            TransactionResult read(Address_7B address, uint8_t* data, size_t length, uint32_t timeout = LIBEMBED_CONFIG_I2C_DEFAULT_TIMEOUT) override;
+            TransactionResult writeRead(Address_7B address, const uint8_t* txData, size_t txLength, uint8_t* rxData, size_t rxLength, uint32_t timeout = LIBEMBED_CONFIG_I2C_DEFAULT_TIMEOUT) override;
+    };
+
+    /**
+     * @brief STM32 implementation of a hardware I2C slave exposing a @ref RegisterFile.
+     *
+     * The slave is handled entirely by the interrupt handlers and the DMA, without a coroutine.
+     * When the master starts reading, the registers are copied into a snapshot buffer, which the
+     * DMA then transmits, so the master always reads a consistent state. The copy takes at most
+     * @ref LIBEMBED_CONFIG_STM32_I2C_SLAVE_BUFFER_SIZE bytes, so the clock is stretched for a few
+     * microseconds only. Without free DMA streams, the bytes are transferred by the interrupt
+     * handler instead.
+     *
+     * An interface can't be used by a slave and a master at the same time.
+     */
+    class HardwareI2C_Slave {
+        private:
+            //! DMA handle of the transmitter
+            DMA_HandleTypeDef txDmaHandle_ = {};
+            //! DMA handle of the receiver
+            DMA_HandleTypeDef rxDmaHandle_ = {};
+            //! Specifies if the DMA is used for transmitting
+            bool txDmaEnabled_ = false;
+            //! Specifies if the DMA is used for receiving
+            bool rxDmaEnabled_ = false;
+
+            //! Registers exposed to the master
+            RegisterFile* file_ = nullptr;
+            //! Register address written by the master
+            volatile size_t pointer_ = 0;
+
+            //! Snapshot of the registers transmitted to the master
+            uint8_t txBuffer_[LIBEMBED_CONFIG_STM32_I2C_SLAVE_BUFFER_SIZE];
+            //! Register address and data received from the master
+            uint8_t rxBuffer_[LIBEMBED_CONFIG_STM32_I2C_SLAVE_BUFFER_SIZE + 1];
+            //! Position in the buffer of the running transfer, if it isn't done by the DMA
+            volatile size_t index_ = 0;
+            volatile bool transmitting_ = false;
+            volatile bool receiving_ = false;
+
+            uint32_t reads_ = 0;
+            uint32_t writes_ = 0;
+            uint32_t errors_ = 0;
+
+            //! Starts transmitting a snapshot of the registers.
+            void startTransmit_();
+
+            //! Starts receiving a message.
+            void startReceive_();
+
+            //! Ends a transmission, after the master has answered the last byte with a NACK.
+            void finishTransmit_();
+
+            //! Ends a reception and applies the received data to the registers.
+            void finishReceive_();
+
+            //! Handles an event interrupt.
+            void handleEvent_();
+
+            //! Handles an error interrupt.
+            void handleError_();
+
+            //! Callback of the HAL when a DMA transfer has completed or failed
+            static void dmaTransferComplete_(DMA_HandleTypeDef* handle);
+
+            friend void __i2c_event_irq_handler(I2C_TypeDef* i2c);
+            friend void __i2c_error_irq_handler(I2C_TypeDef* i2c);
+
+        public:
+            //! Hardware I2C interface
+            const I2C_HardwareInterface& interface;
+
+            /**
+             * @brief Creates an I2C slave.
+             *
+             * @param interface The interface to use.
+             */
+            HardwareI2C_Slave(I2C_HardwareInterface& interface) : interface(interface) { }
+
+            /**
+             * @brief Starts responding to the master.
+             *
+             * @param address The 7-bit address of the slave.
+             * @param file The registers to expose. The number of registers should not exceed
+             * @ref LIBEMBED_CONFIG_STM32_I2C_SLAVE_BUFFER_SIZE.
+             */
+            void begin(Address_7B address, RegisterFile& file);
+
+            /**
+             * @brief Updates registers without the master seeing a partial update.
+             *
+             * @param address The address of the first register to update.
+             * @param data The new values.
+             * @param length The number of registers to update.
+             */
+            void update(size_t address, const uint8_t* data, size_t length);
+
+            /**
+             * @brief Reads registers without the master changing them in between.
+             *
+             * @param address The address of the first register to read.
+             * @param data The buffer to read into.
+             * @param length The number of registers to read.
+             */
+            void read(size_t address, uint8_t* data, size_t length);
+
+            //! Gets the number of messages read by the master.
+            uint32_t reads() const { return reads_; }
+
+            //! Gets the number of messages written by the master, excluding those only setting the register address.
+            uint32_t writes() const { return writes_; }
+
+            //! Gets the number of bus errors and messages discarded because they were out of range.
+            uint32_t errors() const { return errors_; }
+    };
+
+    /**
+     * @brief I2C master bit-banged on two GPIO pins, for buses on pins without an I2C interface.
+     *
+     * The pins are driven as open-drain outputs directly through `BSRR` and read through `IDR`.
+     * The clock edges are scheduled on the timestamps of @ref embed::clock::getTimestamp(), so the
+     * timing doesn't depend on the compiler or the flash wait states. With the cycle counter of
+     * the STM32F4, this reaches 400 kHz. On cores without a cycle counter (STM32G0), the
+     * timestamps have a resolution of 1 microsecond, which limits the clock to about 200 kHz.
+     *
+     * Slaves stretching the clock are waited for, and a lost arbitration is detected while
+     * sending. Interrupts only lengthen the current clock phase. Once a transaction has started, it
+     * doesn't yield, so it keeps the CPU busy for its whole duration.
+     */
+    class SoftwareI2C_Master : public I2C_Master_Base {
+        private:
+            //! Clock pin
+            gpio::GPIO_Pin& scl_;
+            //! Data pin
+            gpio::GPIO_Pin& sda_;
+            //! Lock serializing the calls
+            coroutines::Lock lock_;
+
+            //! Duration of the low phase of the clock in timestamp ticks
+            uint32_t lowTicks_ = 0;
+            //! Duration of the high phase of the clock in timestamp ticks
+            uint32_t highTicks_ = 0;
+            //! Maximum delay of a clock edge before the timing is resynchronized, in timestamp ticks
+            uint32_t slackTicks_ = 0;
+            //! Timestamp of the last clock edge
+            uint32_t edge_ = 0;
+
+            //! Tick at which the running transaction has started
+            uint32_t startTick_ = 0;
+            //! Timeout of the running transaction in milliseconds
+            uint32_t timeout_ = LIBEMBED_CONFIG_I2C_DEFAULT_TIMEOUT;
+            //! Specifies if a message has been started and not stopped yet
+            bool active_ = false;
+
+            //! Waits until the specified number of ticks has passed since the last clock edge.
+            void wait_(uint32_t ticks);
+
+            //! Releases the clock and waits for slaves stretching it.
+            TransactionResult releaseClock_();
+
+            //! Transfers a bit and replaces it by the level of the data line. The clock must be low.
+            TransactionResult transferBit_(bool& bit);
+
+            //! Sends a (repeated) start condition and the address byte.
+            TransactionResult start_(Address_7B address, Direction direction);
+
+            /**
+             * @brief Transfers a byte and its acknowledgement.
+             *
+             * Both are replaced by the levels of the bus, with @p nack being `true` for a NACK.
+             * Bits to be received are sent as released (1).
+             *
+             * @param data The byte to send, 0xFF for receiving.
+             * @param nack The acknowledgement to send, `true` for receiving it from the slave.
+             * @param direction @ref WRITE if the master sends the byte, to detect a lost arbitration.
+             */
+            TransactionResult transferByte_(uint8_t& data, bool& nack, Direction direction);
+
+            //! Sends a stop condition, if a message is active.
+            void stop_();
+
+            //! Releases the bus after a lost arbitration or a timeout.
+            void release_();
+
+        public:
+            /**
+             * @brief Creates a bit-banged I2C master.
+             *
+             * The pins are configured by @ref begin(). The bus needs pull-up resistors; the
+             * internal pull-ups are enabled as well, but are too weak for fast mode.
+             *
+             * @param scl The clock pin.
+             * @param sda The data pin.
+             */
+            SoftwareI2C_Master(gpio::GPIO_Pin& scl, gpio::GPIO_Pin& sda) : scl_(scl), sda_(sda) { }
+
+            /**
+             * @brief Configures the pins and the timing for the specified clock frequency.
+             *
+             * Standard mode uses a duty cycle of 1:1, fast mode (above 100 kHz) one of 2:1 like the
+             * hardware interfaces. If a slave holds the data line low, e.g. after a reset of the
+             * master in the middle of a transfer, it is clocked out of the transfer.
+             *
+             * @param freq The clock frequency, at most 400 kHz. Throws an exception otherwise.
+             */
+            void begin(ClockFrequency freq) override;
+
+            AcknowledgementType startMessage(Address_7B address, Direction direction) override;
+            void stopMessage() override;
+            AcknowledgementType sendByte(uint8_t data) override;
+            uint8_t readByte(AcknowledgementType ackType = ACK) override;
+
+            TransactionResult write(Address_7B address, const uint8_t* data, size_t length, uint32_t timeout = LIBEMBED_CONFIG_I2C_DEFAULT_TIMEOUT) override;
+            TransactionResult read(Address_7B address, uint8_t* data, size_t length, uint32_t timeout = LIBEMBED_CONFIG_I2C_DEFAULT_TIMEOUT) override;
+            TransactionResult writeRead(Address_7B address, const uint8_t* txData, size_t txLength, uint8_t* rxData, size_t rxLength, uint32_t timeout = LIBEMBED_CONFIG_I2C_DEFAULT_TIMEOUT) override;
     };
 }
 
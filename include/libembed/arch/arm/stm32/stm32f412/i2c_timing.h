@@ -0,0 +1,49 @@
+/**
+ * @file i2c_timing.h
+ * @author Gabriel Heinzer
+ * @brief Clock register computation of the STM32F412 I2C interfaces.
+ *
+ * These functions don't depend on the HAL, so they can be checked on the host (see the
+ * i2c-timing-check example).
+ */
+
+#include <stdint.h>
+
+#ifndef LIBEMBED_ARCH_ARM_STM32_STM32F412_I2C_TIMING_H_
+#define LIBEMBED_ARCH_ARM_STM32_STM32F412_I2C_TIMING_H_
+
+namespace embed::arch::arm::stm32::stm32f412::i2c {
+    //! Fast mode selection bit of CCR (F/S)
+    constexpr uint32_t CCR_FAST_MODE = 0x8000;
+    //! Fast mode duty cycle bit of CCR (0: low / high = 2, 1: low / high = 16 / 9)
+    constexpr uint32_t CCR_DUTY = 0x4000;
+    //! Clock control field of CCR
+    constexpr uint32_t CCR_CLOCK_CONTROL = 0x0FFF;
+
+    /**
+     * @brief Computes the clock control register for a bus frequency.
+     *
+     * In standard mode, SCL is high and low for CCR cycles of PCLK1 each. In fast mode, it is high
+     * for CCR cycles and low for 2 * CCR cycles (DUTY = 0), or high for 9 * CCR cycles and low for
+     * 16 * CCR cycles (DUTY = 1). The duty cycle getting closer to the requested frequency is used.
+     * CCR is rounded up, so the bus never runs faster than requested.
+     *
+     * @param pclk The frequency of PCLK1 in Hz.
+     * @param freq The frequency of SCL in Hz.
+     * @return Returns the value of CCR including F/S and DUTY, or 0 if the frequency can't be generated.
+     */
+    uint32_t clockControl(uint32_t pclk, uint32_t freq);
+
+    /**
+     * @brief Computes the maximum rise time register for a bus frequency.
+     *
+     * TRISE is the maximum rise time of SCL in cycles of PCLK1, plus one: 1000 ns in standard mode
+     * and 300 ns in fast mode.
+     *
+     * @param pclk The frequency of PCLK1 in Hz.
+     * @param freq The frequency of SCL in Hz.
+     */
+    uint32_t riseTime(uint32_t pclk, uint32_t freq);
+}
+
+#endif /* LIBEMBED_ARCH_ARM_STM32_STM32F412_I2C_TIMING_H_ */
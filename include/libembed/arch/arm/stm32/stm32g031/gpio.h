@@ -16,6 +16,6 @@
     function(C); \
     function(D)
 
-namespace embed::arch::arm::stm32::stm32f412::gpio {
+namespace embed::arch::arm::stm32::stm32g031::gpio {
     
 }
\ No newline at end of file
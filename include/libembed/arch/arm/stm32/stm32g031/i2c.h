@@ -0,0 +1,5 @@
+#include <libembed/hal/i2c/types.h>
+
+namespace embed::arch::arm::stm32::stm32g031::i2c {
+    using namespace embed::i2c;
+};
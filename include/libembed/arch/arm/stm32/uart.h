@@ -5,7 +5,10 @@
  */
 
 #include <libembed/hal/uart/types.h>
+#include <libembed/hal/gpio/types.h>
 #include <libembed/arch/ident.h>
+#include <libembed/util/ringbuffer.h>
+#include <libembed/util/coroutines.h>
 #include "stm32_hal.h"
 
 #ifndef LIBEMBED_ARCH_ARM_STM32_UART_H_
@@ -18,21 +21,385 @@ namespace embed::arch::arm::stm32::uart {
     using namespace embed::uart;
     using namespace embed::arch::arm::stm32::LIBEMBED_MCU_LINE::uart;
 
+    /**
+     * @brief UART oversampling mode enumerator.
+     *
+     * Oversampling by 16 tolerates more noise and clock deviation, oversampling by 8 doubles
+     * the maximum baudrate from PCLK / 16 to PCLK / 8.
+     */
+    typedef enum {
+        //! Oversampling by 16 if the baudrate can be reached with it, by 8 otherwise
+        OVERSAMPLING_AUTO,
+        //! Oversampling by 16
+        OVERSAMPLING_16,
+        //! Oversampling by 8
+        OVERSAMPLING_8
+    } OversamplingMode;
+
     /**
      * @brief STM32 implementation of a hardware UART interface.
+     *
+     * With a word length of 8 bits, data is transmitted by the DMA in the background:
+     * @ref write() copies the data into a transmit buffer and returns immediately as long as
+     * there is enough space in the buffer (@ref LIBEMBED_CONFIG_STM32_UART_TX_BUFFER_SIZE).
+     * If the buffer is full, it yields until the DMA has made room.
+     *
+     * Received data is continuously written to a receive buffer by a DMA in circular mode
+     * (@ref LIBEMBED_CONFIG_STM32_UART_RX_BUFFER_SIZE), so no data is lost while no coroutine
+     * is reading from the interface. The idle line, half transfer and transfer complete
+     * interrupts wake up coroutines waiting for data.
+     *
+     * The baudrate is checked against the peripheral clock: @ref begin() throws if the UART can't
+     * generate it within @ref LIBEMBED_CONFIG_STM32_UART_MAX_BAUDRATE_ERROR. Multi-megabaud
+     * rates require a peripheral clock which is a multiple of the baudrate, e.g. 6 Mbaud on
+     * an STM32F412 with PCLK1 at 48 MHz (oversampling by 8) or PCLK2 at 96 MHz. Use RTS/CTS
+     * flow control at such rates, so the sender pauses if the receiver falls behind.
      */
     class HardwareUART : public HardwareUART_Base {
         private:
             //! UART Handle for the STM32 HALs
             UART_HandleTypeDef uartHandle;
 
+            //! DMA handle of the transmitter
+            DMA_HandleTypeDef txDmaHandle_ = {};
+            //! Transmit buffer, streamed out by the DMA
+            util::RingBuffer<uint8_t, LIBEMBED_CONFIG_STM32_UART_TX_BUFFER_SIZE> txBuffer_;
+            //! Length of the running DMA transfer, or 0 if the DMA is idle
+            volatile size_t txTransferLength_ = 0;
+            //! Specifies if the DMA is used for transmitting
+            bool txDmaEnabled_ = false;
+            //! Set whenever a DMA transfer has completed
+            coroutines::Event txComplete_;
+
+            //! DMA handle of the receiver
+            DMA_HandleTypeDef rxDmaHandle_ = {};
+            //! Receive buffer, filled by the DMA in circular mode
+            util::RingBuffer<uint8_t, LIBEMBED_CONFIG_STM32_UART_RX_BUFFER_SIZE> rxBuffer_;
+            //! Position of the DMA in the receive buffer when it was last checked
+            size_t rxDmaPosition_ = 0;
+            //! Specifies if the DMA is used for receiving
+            bool rxDmaEnabled_ = false;
+            //! Set if received data has been lost
+            volatile bool rxOverrun_ = false;
+            //! Set whenever new data has been received
+            coroutines::Event rxReceived_;
+            //! Set if the line has been idle since the last byte was received
+            volatile bool rxIdle_ = false;
+            //! Specifies if the receiver timeout is used instead of the idle line detection
+            bool rxTimeoutEnabled_ = false;
+
+            //! RS-485 driver enable pin, or `nullptr` if RS-485 mode is disabled
+            embed::gpio::_GPIO_Pin_specific* dePin_ = nullptr;
+            //! Time from asserting DE to the start bit of the first frame, in sample times
+            uint8_t deAssertionTime_ = 0;
+            //! Time from the end of the last stop bit to deasserting DE, in sample times
+            uint8_t deDeassertionTime_ = 0;
+            //! Set while the driver enable pin is asserted by software
+            volatile bool deAsserted_ = false;
+            //! Set while the driver enable pin waits for the deassertion timer to be released
+            volatile bool deReleasePending_ = false;
+            //! Timestamp at which the driver enable pin is released
+            uint32_t deReleaseTime_ = 0;
+
+            /**
+             * @brief Starts a DMA transfer of the contiguous data at the beginning of the
+             * transmit buffer, unless a transfer is already running.
+             */
+            void startTxTransfer_();
+
+            /**
+             * @brief DMA transfer complete callback (called from the DMA interrupt).
+             */
+            static void txTransferComplete_(DMA_HandleTypeDef* handle);
+
+            /**
+             * @brief Adds the data written by the receive DMA since the last call to the receive
+             * buffer. Must be called with interrupts disabled.
+             */
+            void updateRxBuffer_();
+
+            /**
+             * @brief Updates the receive buffer from the consumer side and discards any data
+             * which has already been overwritten by the DMA.
+             */
+            void syncRxBuffer_();
+
+            /**
+             * @brief Waits for new data to be received.
+             *
+             * @param start Tick count (`HAL_GetTick()`) at which the wait operation started.
+             * @param timeout Timeout relative to @p start in milliseconds.
+             * @return Returns `false` if the timeout has elapsed.
+             */
+            bool waitForData_(uint32_t start, uint32_t timeout);
+
+            /**
+             * @brief Waits for a flag of the UART to be set.
+             *
+             * This polls the status register and yields while the flag is not set, so other
+             * coroutines keep running.
+             *
+             * @param flag The flag to wait for (`UART_FLAG_xxx`).
+             * @param start Tick count (`HAL_GetTick()`) at which the wait operation started.
+             * @param timeout Timeout relative to @p start in milliseconds.
+             * @return Returns `false` if the timeout has elapsed.
+             */
+            bool waitForFlag_(uint32_t flag, uint32_t start, uint32_t timeout);
+
+            /**
+             * @brief Waits for a frame to be received if the DMA is not used for receiving.
+             *
+             * @param start Tick count (`HAL_GetTick()`) at which the wait operation started.
+             * @param timeout Timeout relative to @p start in milliseconds.
+             * @return Returns `false` if the timeout has elapsed.
+             */
+            bool waitForRxFrame_(uint32_t start, uint32_t timeout);
+
+            /**
+             * @brief Gets the mask of the data bits of a frame, which depends on the word length and parity.
+             */
+            DataFrame frameMask_() const;
+
+            /**
+             * @brief Clears the parity bits of data taken from the receive buffer, which the DMA
+             * copies from the data register as they are.
+             */
+            void maskRxData_(uint8_t* data, size_t length) const;
+
+            /**
+             * @brief Checks whether frames have at most 8 data bits, so they fit in a byte.
+             */
+            bool byteFrames_() const;
+
+            /**
+             * @brief Asserts the RS-485 driver enable pin before a transmission if the UART can't
+             * drive it by itself, and cancels its pending release.
+             *
+             * This waits for the assertion time if the pin hasn't been asserted yet, so it must be
+             * called with interrupts enabled and outside of interrupt handlers.
+             */
+            void assertDriverEnable_();
+
+            /**
+             * @brief Enables the transmission complete interrupt releasing the RS-485 driver enable
+             * pin after the data handed to the UART. Must be called with interrupts disabled.
+             */
+            void armDriverRelease_();
+
+            /**
+             * @brief Schedules the release of the RS-485 driver enable pin once the last frame has
+             * been transmitted (called from the transmission complete interrupt).
+             */
+            void releaseDriverEnable_();
+
+            /**
+             * @brief Releases the driver enable pins whose deassertion time has elapsed and restarts
+             * the deassertion timer for the others (called from interrupt handlers).
+             */
+            static void updateDriverRelease_();
+
+            /**
+             * @brief Writes a frame to the data register, asserting the RS-485 driver enable pin first.
+             */
+            void writeDataRegister_(DataFrame data);
+
+            /**
+             * @brief Converts a number of sample times (1/16 or 1/8 bit) to timestamp ticks, rounding up.
+             */
+            uint32_t sampleTicks_(uint32_t count) const;
+
+            /**
+             * @brief Busy-waits for the specified number of sample times (1/16 or 1/8 bit).
+             */
+            void waitSampleTimes_(uint32_t count);
+
+            /**
+             * @brief Receive DMA half transfer and transfer complete callback (called from the DMA interrupt).
+             */
+            static void rxTransferProgress_(DMA_HandleTypeDef* handle);
+
+            friend void __uart_irq_handler(USART_TypeDef* uart);
+            friend void __uart_de_timer_irq_handler();
+
         public:
             using HardwareUART_Base::HardwareUART_Base;
+            using HardwareUART_Base::write;
+            using HardwareUART_Base::read;
 
             void begin(Baudrate baudrate = 9600, uint8_t wordLength = 8, ParityMode parityMode = PARITY_DISABLED, StopBitMode stopBitMode = STOPBIT_1) override;
 
+            /**
+             * @brief Initializes the UART interface with hardware flow control and the specified
+             * oversampling mode.
+             *
+             * The RTS and CTS pins are switched to the alternate function of the interface. Pass
+             * `nullptr` for pins which are configured by the application, e.g. because they use a
+             * different alternate function number.
+             *
+             * @param baudrate The baudrate to use for the interface.
+             * @param wordLength The word length to use for the interface in bits.
+             * @param parityMode The parity mode to use for the interface.
+             * @param stopBitMode The stop bit mode to use for the interface.
+             * @param flowControlMode The hardware flow control mode.
+             * @param oversamplingMode The oversampling mode.
+             * @param rtsPin The RTS pin, or `nullptr`.
+             * @param ctsPin The CTS pin, or `nullptr`.
+             */
+            void begin(Baudrate baudrate, uint8_t wordLength, ParityMode parityMode, StopBitMode stopBitMode, FlowControlMode flowControlMode,
+                OversamplingMode oversamplingMode = OVERSAMPLING_AUTO, embed::gpio::_GPIO_Pin_specific* rtsPin = nullptr, embed::gpio::_GPIO_Pin_specific* ctsPin = nullptr);
+
+            /**
+             * @brief Enables the RS-485 half-duplex mode.
+             *
+             * The driver enable (DE) output of the transceiver is asserted while data is being
+             * transmitted. On devices whose USART has a DE output (e.g. STM32G0), the pin is
+             * switched to the alternate function of the interface (the RTS pin) and driven by the
+             * hardware. On other devices (e.g. STM32F4), the pin is a GPIO output. It is asserted
+             * before the first frame, and released by a one-shot timer started by the transmission
+             * complete interrupt, so no interrupt handler waits for the deassertion time. The timer
+             * is selected by @ref LIBEMBED_CONFIG_STM32_RS485_TIMER, and the application must not
+             * use it once the UART has transmitted.
+             *
+             * The times are specified in sample times, i.e. 1/16 bit with oversampling by 16 and
+             * 1/8 bit with oversampling by 8, so the bus turns around within a fraction of a frame.
+             * The mode is applied by @ref begin(), so this must be called before.
+             *
+             * @param dePin The driver enable pin, or `nullptr` for disabling the RS-485 mode.
+             * @param assertionTime Time between asserting DE and the start bit (0 to 31).
+             * @param deassertionTime Time between the end of the last stop bit and deasserting DE (0 to 31).
+             */
+            void setRS485Mode(embed::gpio::_GPIO_Pin_specific* dePin, uint8_t assertionTime = 16, uint8_t deassertionTime = 16);
+
+            /**
+             * @brief Writes a single frame with the specified data to the UART interface.
+             *
+             * If the DMA is used for transmitting, the frame is appended to the transmit
+             * buffer and @p timeout is ignored. Otherwise, this yields until the transmitter
+             * can accept the frame.
+             *
+             * @param data Data to send to the interface.
+             * @param timeout Timeout for sending the data.
+             */
             void writeFrame(DataFrame data, uint32_t timeout = LIBEMBED_CONFIG_STM32_UART_DEFAULT_SEND_TIMEOUT) override;
             DataFrame recvFrame(uint32_t timeout = LIBEMBED_CONFIG_STM32_UART_DEFAULT_RECV_TIMEOUT) override;
+
+            /**
+             * @brief Sends a block of data to the UART interface.
+             *
+             * If the DMA is used for transmitting, this returns as soon as the data has been
+             * copied to the transmit buffer. Otherwise, it yields while waiting for the
+             * transmitter to accept the next byte.
+             *
+             * @param data Pointer to the data to send.
+             * @param length The number of bytes to send.
+             */
+            void write(const uint8_t* data, size_t length) override;
+            void flush() override;
+
+            /**
+             * @brief Enables or disables transmitting using the DMA.
+             *
+             * The DMA is enabled by @ref begin() if frames have at most 8 data bits (a word length of
+             * 8 bits, or 9 bits with parity) and the DMA stream of the interface is not used by another
+             * peripheral. Disabling it waits for the transmit
+             * buffer to be empty and releases the DMA stream.
+             *
+             * @param enabled Specifies whether the DMA should be used.
+             * @return Returns `true` if the DMA is used for transmitting after the call.
+             */
+            bool setTxDMAEnabled(bool enabled);
+
+            /**
+             * @brief Enables or disables receiving using the DMA.
+             *
+             * The DMA is enabled by @ref begin() if frames have at most 8 data bits (a word length of
+             * 8 bits, or 9 bits with parity) and the DMA stream of the interface is not used by another
+             * peripheral. Disabling it discards any data in
+             * the receive buffer and releases the DMA stream.
+             *
+             * @param enabled Specifies whether the DMA should be used.
+             * @return Returns `true` if the DMA is used for receiving after the call.
+             */
+            bool setRxDMAEnabled(bool enabled);
+
+            /**
+             * @brief Gets the number of bytes which can be read without waiting.
+             *
+             * @return Returns the number of bytes in the receive buffer.
+             */
+            size_t available() override;
+
+            /**
+             * @brief Receives a block of data from the UART interface.
+             *
+             * This yields until @p length bytes have been received or the timeout has elapsed.
+             * With a timeout of 0, only the data which is already in the receive buffer is read.
+             *
+             * @param data Pointer to the memory the data is copied to.
+             * @param length The number of bytes to receive.
+             * @param timeout The maximum time to wait for in milliseconds.
+             * @return Returns the number of bytes received.
+             */
+            size_t read(uint8_t* data, size_t length, uint32_t timeout = LIBEMBED_CONFIG_STM32_UART_DEFAULT_RECV_TIMEOUT) override;
+
+            /**
+             * @brief Reads until the specified delimiter has been received.
+             *
+             * This yields until the delimiter has been received, @p length bytes have been received
+             * or the timeout has elapsed. The delimiter is copied to @p data as well.
+             *
+             * @param delimiter The byte to wait for, e.g. `'\n'`.
+             * @param data Pointer to the memory the data is copied to.
+             * @param length The maximum number of bytes to read.
+             * @param timeout The maximum time to wait for in milliseconds.
+             * @return Returns the number of bytes read, or 0 if the timeout has elapsed. In
+             * this case, no data is removed from the receive buffer.
+             */
+            size_t readUntil(uint8_t delimiter, uint8_t* data, size_t length, uint32_t timeout = LIBEMBED_CONFIG_STM32_UART_DEFAULT_RECV_TIMEOUT);
+
+            /**
+             * @brief Receives a block of data terminated by an idle line, e.g. a Modbus RTU frame.
+             *
+             * The end of the block is detected by the idle line interrupt (one frame without a
+             * start bit), or by the receiver timeout if it has been configured using
+             * @ref setIdleTime(). This yields while waiting.
+             *
+             * @param data Pointer to the memory the data is copied to.
+             * @param length The maximum number of bytes to receive.
+             * @param timeout The maximum time to wait for the first byte in milliseconds.
+             * @return Returns the number of bytes received, or 0 if the timeout has elapsed.
+             */
+            size_t readUntilIdle(uint8_t* data, size_t length, uint32_t timeout = LIBEMBED_CONFIG_STM32_UART_DEFAULT_RECV_TIMEOUT) override;
+
+            /**
+             * @brief Sets the time the line must be idle for @ref readUntilIdle() to detect the end
+             * of a block.
+             *
+             * USARTs with a receiver timeout (e.g. USART1 of the STM32G0) use it for detecting the
+             * idle time exactly. Others detect an idle line after one frame.
+             *
+             * @param bits The requested idle time in bit times, or 0 for using the idle line detection.
+             * @return Returns the idle time actually used in bit times.
+             */
+            uint32_t setIdleTime(uint32_t bits) override;
+
+            /**
+             * @brief Gets a received byte without removing it from the receive buffer.
+             *
+             * @param offset Offset of the byte relative to the oldest byte in the buffer.
+             * @return Returns the byte, or -1 if fewer than @p offset + 1 bytes are available.
+             */
+            int peek(size_t offset = 0);
+
+            /**
+             * @brief Checks whether received data has been lost since the last call.
+             *
+             * Data is lost if the receive buffer isn't read fast enough or if the UART reports
+             * an overrun.
+             *
+             * @return Returns `true` if data has been lost.
+             */
+            bool overrun();
     };
 }
 
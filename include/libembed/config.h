@@ -31,6 +31,50 @@
     #define LIBEMBED_CONFIG_STM32_UART_DEFAULT_RECV_TIMEOUT 1000
     #endif /* LIBEMBED_CONFIG_STM32_UART_DEFAULT_SEND_TIMEOUT */
 
+    #ifndef LIBEMBED_CONFIG_I2C_DEFAULT_TIMEOUT
+    #define LIBEMBED_CONFIG_I2C_DEFAULT_TIMEOUT 100
+    #endif /* LIBEMBED_CONFIG_I2C_DEFAULT_TIMEOUT */
+
+    #ifndef LIBEMBED_CONFIG_I2C_REGMAP_BURST_SIZE
+    #define LIBEMBED_CONFIG_I2C_REGMAP_BURST_SIZE 16
+    #endif /* LIBEMBED_CONFIG_I2C_REGMAP_BURST_SIZE */
+
+    #ifndef LIBEMBED_CONFIG_STM32_UART_TX_BUFFER_SIZE
+    #define LIBEMBED_CONFIG_STM32_UART_TX_BUFFER_SIZE 256
+    #endif /* LIBEMBED_CONFIG_STM32_UART_TX_BUFFER_SIZE */
+
+    #ifndef LIBEMBED_CONFIG_STM32_UART_RX_BUFFER_SIZE
+    #define LIBEMBED_CONFIG_STM32_UART_RX_BUFFER_SIZE 256
+    #endif /* LIBEMBED_CONFIG_STM32_UART_RX_BUFFER_SIZE */
+
+    #ifndef LIBEMBED_CONFIG_STM32_UART_MAX_BAUDRATE_ERROR
+    #define LIBEMBED_CONFIG_STM32_UART_MAX_BAUDRATE_ERROR 20
+    #endif /* LIBEMBED_CONFIG_STM32_UART_MAX_BAUDRATE_ERROR */
+
+    #ifndef LIBEMBED_CONFIG_STM32_RS485_TIMER
+    #define LIBEMBED_CONFIG_STM32_RS485_TIMER 7
+    #endif /* LIBEMBED_CONFIG_STM32_RS485_TIMER */
+
+    #ifndef LIBEMBED_CONFIG_STM32_I2C_DMA_THRESHOLD
+    #define LIBEMBED_CONFIG_STM32_I2C_DMA_THRESHOLD 4
+    #endif /* LIBEMBED_CONFIG_STM32_I2C_DMA_THRESHOLD */
+
+    #ifndef LIBEMBED_CONFIG_STM32_I2C_SLAVE_BUFFER_SIZE
+    #define LIBEMBED_CONFIG_STM32_I2C_SLAVE_BUFFER_SIZE 64
+    #endif /* LIBEMBED_CONFIG_STM32_I2C_SLAVE_BUFFER_SIZE */
+
+    #ifndef LIBEMBED_CONFIG_VIRTUAL_UART_BUFFER_SIZE
+    #define LIBEMBED_CONFIG_VIRTUAL_UART_BUFFER_SIZE 1024
+    #endif /* LIBEMBED_CONFIG_VIRTUAL_UART_BUFFER_SIZE */
+
+    #ifndef LIBEMBED_CONFIG_FORMAT_CHUNK_SIZE
+    #define LIBEMBED_CONFIG_FORMAT_CHUNK_SIZE 32
+    #endif /* LIBEMBED_CONFIG_FORMAT_CHUNK_SIZE */
+
+    #ifndef LIBEMBED_CONFIG_FRAMING_READ_CHUNK_SIZE
+    #define LIBEMBED_CONFIG_FRAMING_READ_CHUNK_SIZE 32
+    #endif /* LIBEMBED_CONFIG_FRAMING_READ_CHUNK_SIZE */
+
     #ifndef LIBEMBED_CONFIG_ENABLE_DEBUGGING
     #define LIBEMBED_CONFIG_ENABLE_DEBUGGING false
     #endif /* LIBEMBED_CONFIG_ENABLE_DEBUGGING */
@@ -47,6 +91,34 @@
     #define LIBEMBED_CONFIG_DEBUG_FUNCTION_NAME_MAXLEN 20
     #endif /* LIBEMBED_CONFIG_DEBUG_FUNCTION_NAME_MAXLEN */
 
+    #ifndef LIBEMBED_CONFIG_DEBUG_BUFFER_SIZE
+    #define LIBEMBED_CONFIG_DEBUG_BUFFER_SIZE 256
+    #endif /* LIBEMBED_CONFIG_DEBUG_BUFFER_SIZE */
+
+    #ifndef LIBEMBED_CONFIG_DEBUG_MAX_STRING_LENGTH
+    #define LIBEMBED_CONFIG_DEBUG_MAX_STRING_LENGTH 24
+    #endif /* LIBEMBED_CONFIG_DEBUG_MAX_STRING_LENGTH */
+
+    #ifndef LIBEMBED_CONFIG_DEBUG_DRAIN_STACK_SIZE
+    #define LIBEMBED_CONFIG_DEBUG_DRAIN_STACK_SIZE 512
+    #endif /* LIBEMBED_CONFIG_DEBUG_DRAIN_STACK_SIZE */
+
+    #ifndef LIBEMBED_CONFIG_DEBUG_LINE_LENGTH
+    #define LIBEMBED_CONFIG_DEBUG_LINE_LENGTH 128
+    #endif /* LIBEMBED_CONFIG_DEBUG_LINE_LENGTH */
+
+    #ifndef LIBEMBED_CONFIG_DEBUG_MAX_SINKS
+    #define LIBEMBED_CONFIG_DEBUG_MAX_SINKS 4
+    #endif /* LIBEMBED_CONFIG_DEBUG_MAX_SINKS */
+
+    #ifndef LIBEMBED_CONFIG_DEBUG_CRASH_BUFFER_SIZE
+    #define LIBEMBED_CONFIG_DEBUG_CRASH_BUFFER_SIZE 0
+    #endif /* LIBEMBED_CONFIG_DEBUG_CRASH_BUFFER_SIZE */
+
+    #ifndef LIBEMBED_CONFIG_DEBUG_CRASH_BUFFER_SECTION
+    #define LIBEMBED_CONFIG_DEBUG_CRASH_BUFFER_SECTION ".noinit"
+    #endif /* LIBEMBED_CONFIG_DEBUG_CRASH_BUFFER_SECTION */
+
 #else
     // Doxygen should see all features, independent of the local configuration file
     
@@ -80,6 +152,119 @@
      */
     #define LIBEMBED_CONFIG_RECV_UART_DEFAULT_SEND_TIMEOUT 1000
 
+    /**
+     * @brief Default timeout for I2C transactions in milliseconds.
+     *
+     * The timeout applies to the whole transaction, including waiting for a busy bus.
+     *
+     * Default value: 100
+     */
+    #define LIBEMBED_CONFIG_I2C_DEFAULT_TIMEOUT 100
+
+    /**
+     * @brief Maximum number of registers an @ref embed::i2c::RegisterMap writes in one transaction.
+     *
+     * The register address and the data are assembled on the stack of the caller, so longer runs
+     * of staged registers are split into several transactions. At least 4, so a register is never
+     * split.
+     *
+     * Default value: 16
+     */
+    #define LIBEMBED_CONFIG_I2C_REGMAP_BURST_SIZE 16
+
+    /**
+     * @brief Size of the transmit buffer of each STM32 hardware UART in bytes.
+     *
+     * Data written to a UART is copied into this buffer and transmitted by the DMA
+     * in the background. Must be a power of two.
+     *
+     * Default value: 256
+     */
+    #define LIBEMBED_CONFIG_STM32_UART_TX_BUFFER_SIZE 256
+
+    /**
+     * @brief Size of the receive buffer of each STM32 hardware UART in bytes.
+     *
+     * The DMA continuously writes received data into this buffer. If the data isn't
+     * read before the DMA wraps around, the oldest data is lost. At 2 Mbaud, 256 bytes
+     * last for about 1.3 ms. Must be a power of two.
+     *
+     * Default value: 256
+     */
+    #define LIBEMBED_CONFIG_STM32_UART_RX_BUFFER_SIZE 256
+
+    /**
+     * @brief Maximum deviation of the generated baudrate from the requested one in tenths of
+     * a percent.
+     *
+     * The UART divides its kernel clock by an integer number of 1/16 bit times, so not every
+     * baudrate can be generated exactly. `HardwareUART::begin()` throws if the deviation is
+     * larger than this. The receivers on both ends tolerate a combined deviation of about 3 %.
+     *
+     * Default value: 20 (2 %)
+     */
+    #define LIBEMBED_CONFIG_STM32_UART_MAX_BAUDRATE_ERROR 20
+
+    /**
+     * @brief Number of the basic timer releasing the RS-485 driver enable pins of STM32 UARTs.
+     *
+     * On devices whose USART has no driver enable output (e.g. STM32F4), the pin is released by a
+     * one-shot timer started by the transmission complete interrupt. The timer and its interrupt
+     * are only used once a UART in RS-485 mode has transmitted. Either 6 (TIM6) or 7 (TIM7).
+     *
+     * Default value: 7
+     */
+    #define LIBEMBED_CONFIG_STM32_RS485_TIMER 7
+
+    /**
+     * @brief Minimum length of an STM32 I2C transfer in bytes for using the DMA.
+     *
+     * Shorter transfers are handled byte by byte by the interrupt handler, which has less overhead
+     * than setting up the DMA.
+     * Receiving by DMA requires at least 2 bytes, so smaller values behave like 2.
+     *
+     * Default value: 4
+     */
+    #define LIBEMBED_CONFIG_STM32_I2C_DMA_THRESHOLD 4
+
+    /**
+     * @brief Maximum number of bytes an STM32 I2C slave transfers in one message.
+     *
+     * The register file is copied into a buffer of this size when the master starts reading, so
+     * reads beyond it return 0xFF. Messages written by the master are received into a buffer of
+     * this size plus the register address.
+     *
+     * Default value: 64
+     */
+    #define LIBEMBED_CONFIG_STM32_I2C_SLAVE_BUFFER_SIZE 64
+
+    /**
+     * @brief Size of the receive buffer of each @ref embed::uart::VirtualUART port in frames.
+     *
+     * Frames written to a virtual line are received immediately, so this limits the amount of
+     * data which can be written before the other port reads it. Must be a power of two.
+     *
+     * Default value: 1024
+     */
+    #define LIBEMBED_CONFIG_VIRTUAL_UART_BUFFER_SIZE 1024
+
+    /**
+     * @brief Size of the stack buffer @ref embed::format::format_to() renders text into
+     * before handing it to a sink.
+     *
+     * Default value: 32
+     */
+    #define LIBEMBED_CONFIG_FORMAT_CHUNK_SIZE 32
+
+    /**
+     * @brief Maximum number of bytes @ref embed::framing::Link reads from the UART at once.
+     *
+     * The bytes are kept in a buffer of this size inside of each link until they are decoded.
+     *
+     * Default value: 32
+     */
+    #define LIBEMBED_CONFIG_FRAMING_READ_CHUNK_SIZE 32
+
     /**
      * @brief Enables debugging. Note that this may come with a significant
      * performance overhead.
@@ -115,6 +300,70 @@
      */
     #define LIBEMBED_CONFIG_DEBUG_FUNCTION_NAME_MAXLEN 20
 
+    /**
+     * @brief Size of the debug log buffer in 32-bit words.
+     *
+     * Log records are stored in this buffer until they are emitted by
+     * @ref embed::debug::flush(). Must be a power of two.
+     *
+     * Default value: 256
+     */
+    #define LIBEMBED_CONFIG_DEBUG_BUFFER_SIZE 256
+
+    /**
+     * @brief Maximum number of characters stored for a string argument of a log call.
+     *
+     * Longer strings are truncated.
+     *
+     * Default value: 24
+     */
+    #define LIBEMBED_CONFIG_DEBUG_MAX_STRING_LENGTH 24
+
+    /**
+     * @brief Stack size of the log drain coroutine in bytes.
+     *
+     * The drain coroutine calls the sink functions (see @ref embed::debug::addSink()),
+     * so this must be large enough for them.
+     *
+     * Default value: 512
+     */
+    #define LIBEMBED_CONFIG_DEBUG_DRAIN_STACK_SIZE 512
+
+    /**
+     * @brief Maximum length of a rendered log line in characters.
+     *
+     * Only used for sinks in the @ref embed::debug::OUTPUT_TEXT mode. Longer lines are truncated.
+     *
+     * Default value: 128
+     */
+    #define LIBEMBED_CONFIG_DEBUG_LINE_LENGTH 128
+
+    /**
+     * @brief Maximum number of sinks which can be registered using @ref embed::debug::addSink().
+     *
+     * Default value: 4
+     */
+    #define LIBEMBED_CONFIG_DEBUG_MAX_SINKS 4
+
+    /**
+     * @brief Size of the crash buffer (@ref embed::debug::crashBufferSink()) in bytes.
+     *
+     * The crash buffer is disabled if this is 0. Must be a power of two otherwise.
+     *
+     * Default value: 0
+     */
+    #define LIBEMBED_CONFIG_DEBUG_CRASH_BUFFER_SIZE 0
+
+    /**
+     * @brief Linker section the crash buffer is placed in.
+     *
+     * The startup code must neither zero nor initialize this section, so its contents
+     * survive a warm reset. Make sure that your linker script places it in RAM as `NOLOAD`.
+     *
+     * Default value: `".noinit"`
+     */
+    #define LIBEMBED_CONFIG_DEBUG_CRASH_BUFFER_SECTION ".noinit"
+
 #endif /* __DOXYGEN__ */
 
 #endif /* LIBEMBED_CONFIG_H_ */
\ No newline at end of file
@@ -7,6 +7,8 @@
 #ifndef LIBEMBED_HAL_CLOCK_TYPES_H_
 #define LIBEMBED_HAL_CLOCK_TYPES_H_
 
+#include <stdint.h>
+
 /**
  * @brief Hardware abstraction layer for clock control.
  * 
@@ -34,6 +36,25 @@ namespace embed::clock {
      * This may not be available on all platforms.
      */
     void setMaximumFrequency();
+
+    /**
+     * @brief Gets the value of a free-running high-resolution counter.
+     *
+     * On cores with a DWT cycle counter (Cortex-M3/M4/M7), this counts CPU cycles.
+     * Cortex-M0+ cores have no cycle counter, so a 32-bit hardware timer counting
+     * microseconds is used instead. The counter wraps around after 2^32 ticks, so
+     * always use unsigned subtraction for computing differences.
+     *
+     * @return Returns the current counter value.
+     */
+    uint32_t getTimestamp();
+
+    /**
+     * @brief Gets the frequency of the counter returned by @ref getTimestamp().
+     *
+     * @return Returns the number of timestamp ticks per second.
+     */
+    uint32_t getTimestampFrequency();
 };
 
 #endif /* LIBEMBED_HAL_CLOCK_TYPES_H_ */
\ No newline at end of file
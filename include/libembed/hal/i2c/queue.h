@@ -0,0 +1,154 @@
+/**
+ * @file queue.h
+ * @author Gabriel Heinzer
+ * @brief Prioritized queue of I2C transactions executed by a single bus driver.
+ *
+ * Instead of competing for the bus, the coroutines using the devices on a bus submit
+ * @ref embed::i2c::Transaction objects to the @ref embed::i2c::TransactionQueue of the bus. A
+ * single coroutine executes them back to back, highest priority first, and signals their
+ * completion. The queue doesn't allocate memory: transactions are linked into it and must
+ * stay valid until they have completed.
+ */
+
+#include <libembed/hal/i2c/types.h>
+#include <libembed/util/coroutines.h>
+#include <libembed/config.h>
+#include <stdint.h>
+#include <stddef.h>
+
+#ifndef LIBEMBED_HAL_I2C_QUEUE_H_
+#define LIBEMBED_HAL_I2C_QUEUE_H_
+
+namespace embed::i2c {
+    class TransactionQueue;
+
+    /**
+     * @brief Descriptor of a transaction submitted to a @ref TransactionQueue.
+     *
+     * The transaction writes @ref txLength bytes and then reads @ref rxLength bytes after a
+     * repeated start condition, like @ref I2C_Master_Base::writeRead(). Either phase may be empty.
+     */
+    class Transaction {
+        private:
+            //! Next transaction in the queue
+            Transaction* next_ = nullptr;
+
+            friend class TransactionQueue;
+
+        public:
+            //! Slave address
+            Address_7B address;
+            //! Data to write
+            const uint8_t* txData;
+            //! Number of bytes to write
+            size_t txLength;
+            //! Buffer to read into
+            uint8_t* rxData;
+            //! Number of bytes to read
+            size_t rxLength;
+            //! Priority, transactions with a higher priority are executed first
+            uint8_t priority;
+            //! Maximum duration of the transaction in milliseconds
+            uint32_t timeout = LIBEMBED_CONFIG_I2C_DEFAULT_TIMEOUT;
+
+            //! Result of the transaction, valid once @ref completed has been set
+            TransactionResult result = RESULT_OK;
+            //! Set when the transaction has been executed
+            coroutines::Event completed;
+
+            /**
+             * @brief Creates a transaction descriptor.
+             *
+             * @param address The slave address.
+             * @param txData The data to write.
+             * @param txLength The number of bytes to write.
+             * @param rxData The buffer to read into.
+             * @param rxLength The number of bytes to read.
+             * @param priority The priority of the transaction.
+             */
+            Transaction(Address_7B address, const uint8_t* txData, size_t txLength, uint8_t* rxData, size_t rxLength, uint8_t priority = 0)
+                : address(address), txData(txData), txLength(txLength), rxData(rxData), rxLength(rxLength), priority(priority) { }
+
+            /**
+             * @brief Waits for the transaction to complete.
+             *
+             * @return Returns the result of the transaction.
+             */
+            TransactionResult wait() {
+                completed.wait();
+                return result;
+            }
+    };
+
+    /**
+     * @brief Queue of the transactions on an I2C bus.
+     *
+     * Transactions with the same priority are executed in the order they have been submitted.
+     * The queue must only be used from coroutines, not from interrupt handlers.
+     *
+     * Example:
+     * ```cpp
+     * i2c::TransactionQueue queue(master);
+     * coroutines::Coroutine<256> busDriver{ [] { queue.run(); } };
+     *
+     * // In a coroutine polling a sensor
+     * uint8_t reg = 0x3B, data[14];
+     * i2c::Transaction transaction(0x68, &reg, 1, data, sizeof(data), 10);
+     * if(queue.execute(transaction) == i2c::RESULT_OK) { ... }
+     * ```
+     */
+    class TransactionQueue {
+        private:
+            I2C_Master_Base& master_;
+
+            //! First transaction in the queue, ordered by priority
+            Transaction* head_ = nullptr;
+
+        public:
+            /**
+             * @brief Creates a transaction queue.
+             *
+             * @param master The master of the bus. It must not be used directly while the queue is used.
+             */
+            TransactionQueue(I2C_Master_Base& master) : master_(master) { }
+
+            /**
+             * @brief Adds a transaction to the queue without waiting for it.
+             *
+             * The transaction must stay valid and must not be submitted again until its
+             * @ref Transaction::completed event has been set.
+             *
+             * @param transaction The transaction to add.
+             */
+            void submit(Transaction& transaction);
+
+            /**
+             * @brief Adds a transaction to the queue and waits for it to complete.
+             *
+             * @param transaction The transaction to execute.
+             * @return Returns the result of the transaction.
+             */
+            TransactionResult execute(Transaction& transaction);
+
+            /**
+             * @brief Executes the transaction with the highest priority, if any.
+             *
+             * @return Returns `true` if a transaction has been executed.
+             */
+            bool poll();
+
+            /**
+             * @brief Executes the submitted transactions forever, e.g. as the entry point of the
+             * bus driver coroutine.
+             *
+             * Queued transactions are executed back to back. The coroutine only yields while the
+             * queue is empty or the master waits for the bus.
+             */
+            [[noreturn]] void run();
+
+            //! Gets the number of transactions waiting in the queue.
+            size_t pending() const;
+    };
+}
+
+#endif /* LIBEMBED_HAL_I2C_QUEUE_H_ */
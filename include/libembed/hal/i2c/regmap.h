@@ -0,0 +1,395 @@
+/**
+ * @file regmap.h
+ * @author Gabriel Heinzer
+ * @brief Register maps for drivers of I2C devices with 8-bit register addresses.
+ *
+ * Registers and their fields are described at compile time by @ref embed::i2c::Register and
+ * @ref embed::i2c::Field types, so the accessors of a @ref embed::i2c::RegisterMap are typed and
+ * range-checked without any run-time descriptor. The map keeps a shadow copy of the registers,
+ * so read-modify-write cycles of cached and write-only registers don't read the device.
+ *
+ * Example:
+ * ```cpp
+ * typedef i2c::Register<0x20, 1, i2c::ACCESS_CACHED> CTRL1;
+ * typedef i2c::Field<CTRL1, 0xF0> CTRL1_ODR;
+ * typedef i2c::Register<0x28, 2, i2c::ACCESS_READ_ONLY> OUT_X;
+ *
+ * i2c::RegisterMap<0x40, false, 0x80> sensor(master, 0x19);
+ * sensor.writeField<CTRL1_ODR>(5);
+ * uint16_t x;
+ * sensor.read<OUT_X>(x);
+ * ```
+ */
+
+#include <libembed/hal/i2c/types.h>
+#include <stdint.h>
+#include <stddef.h>
+#include <type_traits>
+
+#ifndef LIBEMBED_HAL_I2C_REGMAP_H_
+#define LIBEMBED_HAL_I2C_REGMAP_H_
+
+namespace embed::i2c {
+    /**
+     * @brief Access policies of device registers.
+     */
+    typedef enum {
+        //! The register is read from the device on every access and can't be written (e.g. status or data registers)
+        ACCESS_READ_ONLY,
+        //! The register can't be read, the last value written is kept in the shadow copy
+        ACCESS_WRITE_ONLY,
+        //! The register is read from the device on every access (e.g. registers changed by the device)
+        ACCESS_READ_WRITE,
+        //! The register is read from the device once, later reads use the shadow copy (e.g. configuration registers)
+        ACCESS_CACHED
+    } RegisterAccess;
+
+    /**
+     * @brief Compile-time description of a device register.
+     *
+     * @tparam tmpl_address The address of the register.
+     * @tparam tmpl_width The width of the register in bytes (1 to 4).
+     * @tparam tmpl_access The access policy of the register.
+     */
+    template<uint8_t tmpl_address, uint8_t tmpl_width = 1, RegisterAccess tmpl_access = ACCESS_READ_WRITE>
+    struct Register {
+        static_assert(tmpl_width >= 1 && tmpl_width <= 4, "Registers must be 1 to 4 bytes wide.");
+
+        //! Address of the register
+        static constexpr uint8_t address = tmpl_address;
+        //! Width of the register in bytes
+        static constexpr uint8_t width = tmpl_width;
+        //! Access policy of the register
+        static constexpr RegisterAccess access = tmpl_access;
+
+        //! Type holding the value of the register
+        typedef typename std::conditional<tmpl_width == 1, uint8_t,
+            typename std::conditional<tmpl_width == 2, uint16_t, uint32_t>::type>::type Value;
+    };
+
+    /**
+     * @brief Compile-time description of a bit field of a device register.
+     *
+     * @tparam tmpl_register The @ref Register containing the field.
+     * @tparam tmpl_mask The bits of the field within the register. Must not be 0.
+     */
+    template<typename tmpl_register, uint32_t tmpl_mask>
+    struct Field {
+        static_assert(tmpl_mask != 0, "Fields must contain at least one bit.");
+
+        //! Register containing the field
+        typedef tmpl_register Register;
+        //! Bits of the field within the register
+        static constexpr uint32_t mask = tmpl_mask;
+        //! Position of the lowest bit of the field
+        static constexpr uint8_t shift = __builtin_ctz(tmpl_mask);
+    };
+
+    /**
+     * @brief Register map of an I2C device.
+     *
+     * Writes can either be done immediately, or staged with @ref stage() and @ref stageField()
+     * and sent by @ref flush(), which writes each run of adjacent staged registers in a single
+     * burst using the auto-increment feature of the device. Runs longer than
+     * @ref LIBEMBED_CONFIG_I2C_REGMAP_BURST_SIZE registers are split into several bursts.
+     *
+     * @note Writes to cached and write-only registers are skipped if the register is known to
+     * contain the value already.
+     *
+     * @tparam tmpl_size The number of register addresses of the device (at most 256).
+     * @tparam tmpl_bigEndian Whether multi-byte registers start with the most significant byte.
+     * @tparam tmpl_autoIncrement Bits set in the register address for multi-byte accesses, for
+     * devices which require them to enable the auto-increment (e.g. 0x80).
+     */
+    template<size_t tmpl_size, bool tmpl_bigEndian = true, uint8_t tmpl_autoIncrement = 0>
+    class RegisterMap {
+        static_assert(tmpl_size >= 1 && tmpl_size <= 256, "Register maps cover 1 to 256 addresses.");
+
+        private:
+            I2C_Master_Base& master_;
+            Address_7B address_;
+
+            //! Shadow copy of the registers
+            uint8_t shadow_[tmpl_size] = {};
+            //! Bitmap of the shadow bytes known to match the device
+            uint32_t valid_[(tmpl_size + 31) / 32] = {};
+            //! Bitmap of the shadow bytes staged for writing
+            uint32_t dirty_[(tmpl_size + 31) / 32] = {};
+
+            static bool test_(const uint32_t* bitmap, size_t index) { return bitmap[index / 32] & (1u << (index % 32)); }
+            static void set_(uint32_t* bitmap, size_t index) { bitmap[index / 32] |= 1u << (index % 32); }
+            static void clear_(uint32_t* bitmap, size_t index) { bitmap[index / 32] &= ~(1u << (index % 32)); }
+
+            //! Gets the address sent to the device for an access of @p length bytes.
+            static uint8_t busAddress_(uint8_t reg, size_t length) { return length > 1 ? reg | tmpl_autoIncrement : reg; }
+
+            template<typename R>
+            static constexpr void check_() {
+                static_assert(R::address + R::width <= tmpl_size, "The register is outside of the register map.");
+            }
+
+            //! Checks whether all bytes of a register are valid.
+            bool isValid_(uint8_t reg, uint8_t width) const {
+                for(uint8_t i = 0; i < width; i++) {
+                    if(!test_(valid_, reg + i)) return false;
+                }
+                return true;
+            }
+
+            //! Gets the value of a register from the shadow copy.
+            uint32_t fromShadow_(uint8_t reg, uint8_t width) const {
+                uint32_t value = 0;
+                for(uint8_t i = 0; i < width; i++) {
+                    uint8_t byte = shadow_[reg + (tmpl_bigEndian ? i : width - 1 - i)];
+                    value = value << 8 | byte;
+                }
+                return value;
+            }
+
+            //! Stores the value of a register in the shadow copy.
+            void toShadow_(uint8_t reg, uint8_t width, uint32_t value) {
+                for(uint8_t i = 0; i < width; i++) {
+                    shadow_[reg + (tmpl_bigEndian ? width - 1 - i : i)] = value & 0xFF;
+                    value >>= 8;
+                }
+            }
+
+            //! Maximum number of registers written in one transaction
+            static constexpr size_t burstSize_ = tmpl_size < LIBEMBED_CONFIG_I2C_REGMAP_BURST_SIZE ? tmpl_size : LIBEMBED_CONFIG_I2C_REGMAP_BURST_SIZE;
+            static_assert(LIBEMBED_CONFIG_I2C_REGMAP_BURST_SIZE >= 4, "Register map bursts must hold the widest register.");
+
+            //! Writes a range of the shadow copy to the device, in bursts of at most `burstSize_` registers.
+            TransactionResult writeShadow_(uint8_t reg, size_t length) {
+                size_t start = reg;
+                size_t end = start + length;
+                while(start < end) {
+                    size_t count = end - start < burstSize_ ? end - start : burstSize_;
+                    uint8_t burst[1 + burstSize_];
+                    burst[0] = busAddress_((uint8_t)start, count);
+                    for(size_t i = 0; i < count; i++) burst[1 + i] = shadow_[start + i];
+
+                    TransactionResult result = master_.write(address_, burst, 1 + count);
+                    if(result != RESULT_OK) {
+                        // The rest of the range isn't written either, so none of it is known to match
+                        for(size_t i = start; i < end; i++) clear_(valid_, i);
+                        return result;
+                    }
+                    for(size_t i = 0; i < count; i++) set_(valid_, start + i);
+                    start += count;
+                }
+                return RESULT_OK;
+            }
+
+        public:
+            /**
+             * @brief Creates a register map.
+             *
+             * @param master The master of the bus the device is connected to.
+             * @param address The address of the device.
+             */
+            RegisterMap(I2C_Master_Base& master, Address_7B address) : master_(master), address_(address) { }
+
+            /**
+             * @brief Reads a register.
+             *
+             * Cached registers are only read from the device if they aren't in the shadow copy
+             * yet, write-only registers never.
+             *
+             * @tparam R The @ref Register to read.
+             * @param value Receives the value of the register.
+             * @return Returns the result of the transaction, or `RESULT_OK` if the device hasn't been accessed.
+             */
+            template<typename R>
+            TransactionResult read(typename R::Value& value) {
+                check_<R>();
+                if(R::access == ACCESS_WRITE_ONLY || (R::access == ACCESS_CACHED && isValid_(R::address, R::width))) {
+                    value = fromShadow_(R::address, R::width);
+                    return RESULT_OK;
+                }
+
+                TransactionResult result = refresh(R::address, R::width);
+                value = fromShadow_(R::address, R::width);
+                return result;
+            }
+
+            /**
+             * @brief Writes a register immediately.
+             *
+             * @tparam R The @ref Register to write. Must not be read-only.
+             * @param value The value to write.
+             * @return Returns the result of the transaction, or `RESULT_OK` if the write has been skipped.
+             */
+            template<typename R>
+            TransactionResult write(typename R::Value value) {
+                check_<R>();
+                static_assert(R::access != ACCESS_READ_ONLY, "Read-only registers can't be written.");
+                if(R::access != ACCESS_READ_WRITE && isValid_(R::address, R::width) && fromShadow_(R::address, R::width) == value) {
+                    return RESULT_OK;
+                }
+
+                toShadow_(R::address, R::width, value);
+                for(uint8_t i = 0; i < R::width; i++) clear_(dirty_, R::address + i);
+                return writeShadow_(R::address, R::width);
+            }
+
+            /**
+             * @brief Reads a field of a register.
+             *
+             * @tparam F The @ref Field to read.
+             * @param value Receives the value of the field, shifted to bit 0.
+             * @return Returns the result of the transaction.
+             */
+            template<typename F>
+            TransactionResult readField(uint32_t& value) {
+                typename F::Register::Value reg;
+                TransactionResult result = read<typename F::Register>(reg);
+                value = (reg & F::mask) >> F::shift;
+                return result;
+            }
+
+            /**
+             * @brief Modifies a field of a register, leaving the other bits unchanged.
+             *
+             * For cached and write-only registers, the current value is taken from the shadow copy.
+             *
+             * @tparam F The @ref Field to write.
+             * @param value The value of the field, starting at bit 0.
+             * @return Returns the result of the transactions.
+             */
+            template<typename F>
+            TransactionResult writeField(uint32_t value) {
+                typedef typename F::Register R;
+                typename R::Value reg;
+                TransactionResult result = read<R>(reg);
+                if(result != RESULT_OK) return result;
+                return write<R>((reg & ~F::mask) | ((value << F::shift) & F::mask));
+            }
+
+            /**
+             * @brief Stages a register for writing by @ref flush().
+             *
+             * @tparam R The @ref Register to write. Must not be read-only.
+             * @param value The value to write.
+             */
+            template<typename R>
+            void stage(typename R::Value value) {
+                check_<R>();
+                static_assert(R::access != ACCESS_READ_ONLY, "Read-only registers can't be written.");
+                if(R::access != ACCESS_READ_WRITE && isValid_(R::address, R::width) && fromShadow_(R::address, R::width) == value) {
+                    return;
+                }
+
+                toShadow_(R::address, R::width, value);
+                for(uint8_t i = 0; i < R::width; i++) set_(dirty_, R::address + i);
+            }
+
+            /**
+             * @brief Stages the modification of a field for writing by @ref flush().
+             *
+             * @tparam F The @ref Field to write.
+             * @param value The value of the field, starting at bit 0.
+             * @return Returns the result of reading the register, if it has been necessary.
+             */
+            template<typename F>
+            TransactionResult stageField(uint32_t value) {
+                typedef typename F::Register R;
+                typename R::Value reg;
+
+                // Staged values are newer than the ones of the device
+                bool staged = true;
+                for(uint8_t i = 0; i < R::width; i++) staged = staged && test_(dirty_, R::address + i);
+                TransactionResult result = RESULT_OK;
+                if(staged) reg = fromShadow_(R::address, R::width);
+                else result = read<R>(reg);
+                if(result != RESULT_OK) return result;
+
+                stage<R>((reg & ~F::mask) | ((value << F::shift) & F::mask));
+                return RESULT_OK;
+            }
+
+            /**
+             * @brief Writes the staged registers.
+             *
+             * Each run of adjacent staged registers is written in a single transaction, or in several
+             * if it is longer than @ref LIBEMBED_CONFIG_I2C_REGMAP_BURST_SIZE registers.
+             *
+             * @return Returns the result of the first failed transaction, or `RESULT_OK`.
+             */
+            TransactionResult flush() {
+                TransactionResult result = RESULT_OK;
+                size_t i = 0;
+                while(i < tmpl_size) {
+                    if(!test_(dirty_, i)) {
+                        i++;
+                        continue;
+                    }
+
+                    size_t start = i;
+                    while(i < tmpl_size && test_(dirty_, i)) clear_(dirty_, i++);
+                    TransactionResult burst = writeShadow_(start, i - start);
+                    if(result == RESULT_OK) result = burst;
+                }
+                return result;
+            }
+
+            /**
+             * @brief Reads a block of adjacent registers into the shadow copy in a single transaction.
+             *
+             * Staged registers in the block are overwritten. The block must be within the map.
+             *
+             * @param reg The address of the first register.
+             * @param length The number of bytes to read.
+             * @return Returns the result of the transaction.
+             */
+            TransactionResult refresh(uint8_t reg, size_t length) {
+                if(reg + length > tmpl_size) return RESULT_BUS_ERROR;
+
+                uint8_t address = busAddress_(reg, length);
+                TransactionResult result = master_.writeRead(address_, &address, 1, shadow_ + reg, length);
+                for(size_t i = 0; i < length; i++) {
+                    clear_(dirty_, reg + i);
+                    if(result == RESULT_OK) set_(valid_, reg + i);
+                    else clear_(valid_, reg + i);
+                }
+                return result;
+            }
+
+            /**
+             * @brief Reads a block of adjacent registers in a single transaction, bypassing the shadow copy.
+             *
+             * This is meant for data which doesn't need to be cached, e.g. FIFOs or measurement results.
+             *
+             * @param reg The address of the first register.
+             * @param data The buffer to read into.
+             * @param length The number of bytes to read.
+             * @return Returns the result of the transaction.
+             */
+            TransactionResult readBlock(uint8_t reg, uint8_t* data, size_t length) {
+                uint8_t address = busAddress_(reg, length);
+                return master_.writeRead(address_, &address, 1, data, length);
+            }
+
+            /**
+             * @brief Sets the shadow copy of a register without accessing the device, e.g. to its reset value.
+             *
+             * @tparam R The @ref Register to set.
+             * @param value The value of the register.
+             */
+            template<typename R>
+            void preload(typename R::Value value) {
+                check_<R>();
+                toShadow_(R::address, R::width, value);
+                for(uint8_t i = 0; i < R::width; i++) set_(valid_, R::address + i);
+            }
+
+            /**
+             * @brief Discards the shadow copy, e.g. after resetting the device.
+             */
+            void invalidate() {
+                for(uint32_t& word : valid_) word = 0;
+                for(uint32_t& word : dirty_) word = 0;
+            }
+    };
+}
+
+#endif /* LIBEMBED_HAL_I2C_REGMAP_H_ */
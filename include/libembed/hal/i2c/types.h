@@ -5,6 +5,7 @@
  */
 
 #include <stdint.h>
+#include <stddef.h>
 #include <string>
 #include <libembed/config.h>
 
@@ -47,12 +48,83 @@ namespace embed::i2c {
         NACK
     } AcknowledgementType;
 
+    /**
+     * @brief Result of an I2C transaction.
+     */
+    typedef enum {
+        //! The transaction has completed
+        RESULT_OK,
+        //! The slave didn't acknowledge its address
+        RESULT_ADDRESS_NACK,
+        //! The slave didn't acknowledge a data byte
+        RESULT_DATA_NACK,
+        //! Another master has won the arbitration
+        RESULT_ARBITRATION_LOST,
+        //! A misplaced start or stop condition has been detected
+        RESULT_BUS_ERROR,
+        //! The transaction hasn't completed in time, e.g. because the bus was held by another master
+        RESULT_TIMEOUT
+    } TransactionResult;
+
+    /**
+     * @brief Statistics of the transactions executed by an I2C master.
+     */
+    struct BusStatistics {
+        //! Number of transactions completed successfully
+        uint32_t transactions;
+        //! Number of data bytes transferred by successful transactions
+        uint32_t bytes;
+        //! Number of transactions aborted because of a NACK
+        uint32_t nacks;
+        //! Number of transactions aborted because another master has won the arbitration
+        uint32_t arbitrationLosses;
+        //! Number of transactions aborted because of a bus error
+        uint32_t busErrors;
+        //! Number of transactions which haven't completed in time
+        uint32_t timeouts;
+    };
+
+    /**
+     * @brief Registers exposed by an I2C slave.
+     *
+     * The master writes the address of the first register to access, followed by the data to
+     * write. It reads starting at the last address written, after a repeated start condition or
+     * in a separate message.
+     */
+    struct RegisterFile {
+        //! Registers, owned by the application
+        uint8_t* registers;
+        //! Number of registers
+        size_t size;
+        //! Address of the first register the master may write, the ones before are read-only
+        size_t firstWritable;
+        /**
+         * @brief Function called after the master has written registers, or `nullptr`.
+         *
+         * It is called from the interrupt handler, so it must return quickly.
+         *
+         * @param address The address of the first register written.
+         * @param length The number of registers written.
+         */
+        void (*written)(size_t address, size_t length);
+    };
+
     /**
      * @brief Base class for master I2C interfaces.
      * 
+     * Prefer the transaction functions @ref write(), @ref read() and @ref writeRead() over
+     * composing messages from the byte-level functions.
+     * 
      * Do not use this directly, use one of the implementations of this class instead.
      */
     class I2C_Master_Base {
+        protected:
+            //! Statistics updated by the implementations of the transaction functions
+            BusStatistics statistics_ = {};
+
+            //! Counts a finished transaction in the statistics.
+            void countTransaction_(TransactionResult result, size_t bytes);
+
         public:
             /**
              * @brief Initializes the @ref I2C_Master_Base class.
@@ -117,11 +189,75 @@ namespace embed::i2c {
              * @return The received data.
              */
             virtual uint8_t readByte(AcknowledgementType ackType = ACK) = 0;
+
+            /**
+             * @brief Writes data to a slave in a single transaction.
+             *
+             * Hardware implementations hold the bus for the whole transaction, so other coroutines
+             * can't interleave their messages. A @p length of 0 only sends the address, e.g. for
+             * probing a device.
+             *
+             * @note The default implementation uses the byte-level functions. It can't detect
+             * errors other than NACKs and ignores @p timeout.
+             *
+             * @param address The slave address.
+             * @param data The data to write.
+             * @param length The number of bytes to write.
+             * @param timeout The maximum duration of the transaction in milliseconds.
+             * @return Returns the result of the transaction.
+             */
+            virtual TransactionResult write(Address_7B address, const uint8_t* data, size_t length, uint32_t timeout = LIBEMBED_CONFIG_I2C_DEFAULT_TIMEOUT);
+
+            /**
+             * @brief Reads data from a slave in a single transaction.
+             *
+             * The last byte is answered with a NACK, all others with an ACK.
+             *
+             * @note The default implementation uses the byte-level functions. It can't detect
+             * errors other than NACKs and ignores @p timeout.
+             *
+             * @param address The slave address.
+             * @param data The buffer to read into.
+             * @param length The number of bytes to read.
+             * @param timeout The maximum duration of the transaction in milliseconds.
+             * @return Returns the result of the transaction.
+             */
+            virtual TransactionResult read(Address_7B address, uint8_t* data, size_t length, uint32_t timeout = LIBEMBED_CONFIG_I2C_DEFAULT_TIMEOUT);
+
+            /**
+             * @brief Writes data to a slave and reads its response after a repeated start condition.
+             *
+             * This is the usual way of reading registers: @p txData contains the register address.
+             *
+             * @note The default implementation uses the byte-level functions. It can't detect
+             * errors other than NACKs and ignores @p timeout.
+             *
+             * @param address The slave address.
+             * @param txData The data to write.
+             * @param txLength The number of bytes to write.
+             * @param rxData The buffer to read into.
+             * @param rxLength The number of bytes to read.
+             * @param timeout The maximum duration of the transaction in milliseconds.
+             * @return Returns the result of the transaction.
+             */
+            virtual TransactionResult writeRead(Address_7B address, const uint8_t* txData, size_t txLength, uint8_t* rxData, size_t rxLength, uint32_t timeout = LIBEMBED_CONFIG_I2C_DEFAULT_TIMEOUT);
+
+            /**
+             * @brief Gets the statistics of the transactions executed by @ref write(), @ref read()
+             * and @ref writeRead().
+             */
+            const BusStatistics& statistics() const { return statistics_; }
+
+            //! Resets the statistics to zero.
+            void resetStatistics() { statistics_ = {}; }
     };
 
     /**
      * @brief Base class for hardware I2C interfaces.
      * 
+     * Calls are serialized per hardware interface, so coroutines using different buses
+     * don't wait for each other. All objects using the same interface share its lock.
+     * 
      * Do not use this directly, use one of the implementation of this class instead.
      */
     class HardwareI2C_Master_Base : public I2C_Master_Base {
@@ -141,6 +277,11 @@ namespace embed::i2c {
             using I2C_Master_Base::sendByte;
             using I2C_Master_Base::startMessage;
             using I2C_Master_Base::stopMessage;
+            using I2C_Master_Base::write;
+            using I2C_Master_Base::read;
+            using I2C_Master_Base::writeRead;
+            using I2C_Master_Base::statistics;
+            using I2C_Master_Base::resetStatistics;
     };
 }
 
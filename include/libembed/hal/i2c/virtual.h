@@ -0,0 +1,295 @@
+/**
+ * @file virtual.h
+ * @author Gabriel Heinzer
+ * @brief Simulated I2C bus with virtual slave devices.
+ *
+ * The virtual bus doesn't depend on any hardware, so it can be used in host builds, e.g. for
+ * testing device drivers and @ref embed::i2c::TransactionQueue code, or for benchmarking them.
+ * The bus is simulated in virtual time: every condition and byte advances the time of the bus
+ * by its duration at the configured clock frequency, so the bus load of a driver can be
+ * measured independently of the CPU it runs on.
+ */
+
+#include <libembed/hal/i2c/types.h>
+#include <libembed/config.h>
+#include <stdint.h>
+#include <stddef.h>
+
+#ifndef LIBEMBED_HAL_I2C_VIRTUAL_H_
+#define LIBEMBED_HAL_I2C_VIRTUAL_H_
+
+namespace embed::i2c {
+    class VirtualBus;
+
+    /**
+     * @brief Base class for slave devices attached to a @ref VirtualBus.
+     *
+     * Implementations model the protocol of a device on the byte level. Transfers are always
+     * framed by a call of @ref start() and a call of @ref stop(), a repeated start condition calls
+     * @ref start() again.
+     */
+    class VirtualDevice {
+        private:
+            //! Next device attached to the bus
+            VirtualDevice* next_ = nullptr;
+            //! Address the device is attached at
+            Address_7B address_ = 0;
+
+            friend class VirtualBus;
+
+        protected:
+            //! Bus the device is attached to, or `nullptr`
+            VirtualBus* bus_ = nullptr;
+
+        public:
+            virtual ~VirtualDevice() { }
+
+            /**
+             * @brief Called when the master has addressed the device.
+             *
+             * @param direction The direction of the transfer.
+             * @return Returns `true` to acknowledge the address.
+             */
+            virtual bool start(Direction direction) = 0;
+
+            /**
+             * @brief Called when the master has written a byte to the device.
+             *
+             * @return Returns `true` to acknowledge the byte.
+             */
+            virtual bool write(uint8_t data) = 0;
+
+            //! Called when the master reads a byte from the device.
+            virtual uint8_t read() = 0;
+
+            //! Called on the stop condition ending a transfer with the device.
+            virtual void stop() { }
+
+            //! Gets the address the device is attached at.
+            Address_7B address() const { return address_; }
+    };
+
+    /**
+     * @brief Virtual EEPROM, e.g. of the 24Cxx series.
+     *
+     * The master writes the memory address (most significant byte first), followed by the data to
+     * write. Writes wrap around within a page. After the stop condition, the EEPROM doesn't
+     * acknowledge its address for the duration of the write cycle, so drivers can be tested for
+     * acknowledge polling. Reads start at the current address and wrap around at the end of the
+     * memory.
+     */
+    class VirtualEEPROM : public VirtualDevice {
+        private:
+            uint8_t* memory_;
+            size_t size_;
+            size_t pageSize_;
+            uint8_t addressBytes_;
+            uint32_t writeTime_;
+
+            //! Current memory address
+            size_t pointer_ = 0;
+            //! Number of address bytes received in the current transfer
+            uint8_t addressReceived_ = 0;
+            //! Specifies if data has been written in the current transfer
+            bool written_ = false;
+            //! Time of the bus at which the write cycle completes
+            uint64_t busyUntil_ = 0;
+
+        public:
+            /**
+             * @brief Creates a virtual EEPROM.
+             *
+             * @param memory The memory of the EEPROM, owned by the application.
+             * @param size The size of the memory in bytes.
+             * @param pageSize The size of a page in bytes.
+             * @param addressBytes The number of bytes of a memory address (1 or 2).
+             * @param writeTime The duration of a write cycle in nanoseconds.
+             */
+            VirtualEEPROM(uint8_t* memory, size_t size, size_t pageSize = 32, uint8_t addressBytes = 2, uint32_t writeTime = 5000000)
+                : memory_(memory), size_(size), pageSize_(pageSize), addressBytes_(addressBytes), writeTime_(writeTime) { }
+
+            bool start(Direction direction) override;
+            bool write(uint8_t data) override;
+            uint8_t read() override;
+            void stop() override;
+    };
+
+    /**
+     * @brief Virtual device with 8-bit register addresses, e.g. a sensor.
+     *
+     * The device behaves like an @ref embed::arch::i2c::HardwareI2C_Slave exposing the same
+     * @ref RegisterFile: the first byte written sets the register address, the following bytes
+     * are written to the registers. Reads start at the last address written and auto-increment.
+     * Writes to read-only or missing registers are not acknowledged, reads beyond the last
+     * register return 0xFF. The application can change the registers between transactions, e.g.
+     * to simulate measurements.
+     */
+    class VirtualRegisterDevice : public VirtualDevice {
+        private:
+            RegisterFile& file_;
+
+            //! Current register address
+            size_t pointer_ = 0;
+            //! Specifies if the register address has been received in the current transfer
+            bool addressReceived_ = false;
+            //! Address of the first register written in the current transfer
+            size_t writtenAddress_ = 0;
+            //! Number of registers written in the current transfer
+            size_t writtenLength_ = 0;
+
+            //! Calls the @ref RegisterFile::written callback for the registers written.
+            void notify_();
+
+        public:
+            /**
+             * @brief Creates a virtual register device.
+             *
+             * @param file The registers of the device.
+             */
+            VirtualRegisterDevice(RegisterFile& file) : file_(file) { }
+
+            bool start(Direction direction) override;
+            bool write(uint8_t data) override;
+            uint8_t read() override;
+            void stop() override;
+    };
+
+    /**
+     * @brief Simulated I2C bus, implementing the master side of it.
+     *
+     * Devices are attached at their addresses without allocating memory, so they must stay valid
+     * while they are attached. Faults can be injected using @ref setFaults() and
+     * @ref setClockStretching(). The transaction functions report them like the hardware
+     * implementations and count them in the @ref statistics().
+     *
+     * Example:
+     * ```cpp
+     * uint8_t memory[4096];
+     * i2c::VirtualEEPROM eeprom(memory, sizeof(memory));
+     * i2c::VirtualBus bus;
+     * bus.begin(400000);
+     * bus.attach(eeprom, 0x50);
+     * bus.write(0x50, data, length);
+     * ```
+     */
+    class VirtualBus : public I2C_Master_Base {
+        private:
+            //! Devices attached to the bus
+            VirtualDevice* devices_ = nullptr;
+            //! Device addressed by the current message, or `nullptr`
+            VirtualDevice* current_ = nullptr;
+            //! Specifies if a message has been started and not stopped yet
+            bool active_ = false;
+
+            //! Virtual time of the bus in nanoseconds
+            uint64_t time_ = 0;
+            //! Duration of a clock period in nanoseconds, set by @ref begin()
+            uint32_t bitTime_ = 10000;
+
+            //! Duration the slaves stretch the clock after a byte, in nanoseconds
+            uint32_t stretchTime_ = 0;
+            //! Every n-th byte is followed by clock stretching, or 0
+            uint32_t stretchInterval_ = 0;
+            //! Every n-th byte is answered with a NACK, or 0
+            uint32_t nackInterval_ = 0;
+            //! Every n-th message loses the arbitration, or 0
+            uint32_t arbitrationInterval_ = 0;
+            //! State of the pseudo-random number generator selecting the faults
+            uint32_t random_ = 0x12345678;
+
+            //! Gets the next pseudo-random number (xorshift32).
+            uint32_t nextRandom_();
+
+            //! Checks if an injected fault with the specified interval occurs.
+            bool inject_(uint32_t interval);
+
+            //! Advances the time by a byte, its acknowledgement and any clock stretching.
+            void transferByte_();
+
+            //! Sends a (repeated) start condition and the address byte.
+            TransactionResult start_(Address_7B address, Direction direction);
+
+            //! Sends a byte to the current device.
+            TransactionResult send_(uint8_t data);
+
+            //! Receives a byte from the current device.
+            uint8_t receive_();
+
+            //! Sends a stop condition, if a message is active.
+            void stop_();
+
+        public:
+            using I2C_Master_Base::write;
+            using I2C_Master_Base::read;
+
+            /**
+             * @brief Configures the clock frequency, which only determines the timing of the bus.
+             */
+            void begin(ClockFrequency freq) override;
+
+            /**
+             * @brief Attaches a device to the bus.
+             *
+             * @param device The device to attach. It must not be attached to a bus yet.
+             * @param address The 7-bit address of the device.
+             */
+            void attach(VirtualDevice& device, Address_7B address);
+
+            /**
+             * @brief Detaches a device from the bus.
+             */
+            void detach(VirtualDevice& device);
+
+            AcknowledgementType startMessage(Address_7B address, Direction direction) override;
+            void stopMessage() override;
+            AcknowledgementType sendByte(uint8_t data) override;
+            uint8_t readByte(AcknowledgementType ackType = ACK) override;
+
+            /**
+             * @brief Executes a transaction on the virtual bus.
+             *
+             * If the time of the bus advances by more than @p timeout during the transaction, e.g.
+             * because of clock stretching, it is aborted with @ref RESULT_TIMEOUT.
+             */
+            TransactionResult writeRead(Address_7B address, const uint8_t* txData, size_t txLength, uint8_t* rxData, size_t rxLength, uint32_t timeout = LIBEMBED_CONFIG_I2C_DEFAULT_TIMEOUT) override;
+
+            /**
+             * @brief Injects faults into the messages on the bus.
+             *
+             * The bytes and messages affected are chosen pseudo-randomly with the specified average
+             * intervals. The byte-level functions report a lost arbitration as a NACK.
+             *
+             * @param nackInterval Every n-th byte written on average isn't acknowledged, or 0 for none.
+             * @param arbitrationInterval Every n-th message on average loses the arbitration to
+             * another master, or 0 for none.
+             * @param seed Seed of the pseudo-random number generator (must not be 0).
+             */
+            void setFaults(uint32_t nackInterval, uint32_t arbitrationInterval, uint32_t seed = 0x12345678);
+
+            /**
+             * @brief Makes the slaves stretch the clock after bytes.
+             *
+             * @param nanoseconds The duration the clock is held low.
+             * @param interval Every n-th byte on average is stretched, 1 for every byte or 0 for none.
+             */
+            void setClockStretching(uint32_t nanoseconds, uint32_t interval = 1);
+
+            /**
+             * @brief Gets the virtual time of the bus.
+             *
+             * @return Returns the time spent transferring data, including clock stretching, in
+             * nanoseconds.
+             */
+            uint64_t time() const { return time_; }
+
+            /**
+             * @brief Advances the virtual time of the bus, e.g. to simulate the time spent
+             * between transactions.
+             *
+             * @param nanoseconds The time to advance by.
+             */
+            void advance(uint64_t nanoseconds) { time_ += nanoseconds; }
+    };
+}
+
+#endif /* LIBEMBED_HAL_I2C_VIRTUAL_H_ */
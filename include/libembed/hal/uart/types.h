@@ -5,7 +5,8 @@
  */
 
 #include <stdint.h>
-#include <string>
+#include <stddef.h>
+#include <string_view>
 #include <libembed/config.h>
 
 #ifndef LIBEMBED_HAL_UART_TYPES_H_
@@ -52,6 +53,20 @@ namespace embed::uart {
         PARITY_ODD
     } ParityMode;
 
+    /**
+     * @brief UART hardware flow control mode enumerator.
+     */
+    typedef enum {
+        //! Flow control disabled
+        FLOWCONTROL_NONE,
+        //! RTS output only, signals the sender when the receiver can accept data
+        FLOWCONTROL_RTS,
+        //! CTS input only, the transmitter waits for CTS before sending a frame
+        FLOWCONTROL_CTS,
+        //! RTS output and CTS input
+        FLOWCONTROL_RTS_CTS
+    } FlowControlMode;
+
     /**
      * @brief Base class for UART interfaces.
      * 
@@ -66,9 +81,14 @@ namespace embed::uart {
 
             /**
              * @brief Initializes the UART interface with the specified parameters.
+             *
+             * The word length includes the parity bit, as on STM32 USARTs: a frame consists of a
+             * start bit, @p wordLength bits and the stop bits, and carries `wordLength - 1` data bits
+             * if parity is enabled. For example, 8 data bits with even parity (8E1) are configured
+             * with `begin(baudrate, 9, PARITY_EVEN)`.
              * 
              * @param baudrate The baudrate to use for the interface.
-             * @param wordLength The word length to use for the interface in bits.
+             * @param wordLength The word length to use for the interface in bits, including the parity bit.
              * @param parityMode The parity mode to use for the interface.
              * @param stopBitMode The stop bit mode to use for the interface.
              */
@@ -91,12 +111,82 @@ namespace embed::uart {
              */
             virtual DataFrame recvFrame(uint32_t timeout = LIBEMBED_CONFIG_STM32_UART_DEFAULT_RECV_TIMEOUT) = 0;
 
+            /**
+             * @brief Sends a block of data to the UART interface.
+             *
+             * The default implementation sends the data frame by frame using @ref writeFrame().
+             * Implementations may return before the data has been transmitted; use @ref flush()
+             * for waiting until the transmission is complete.
+             *
+             * @param data Pointer to the data to send.
+             * @param length The number of bytes to send.
+             */
+            virtual void write(const uint8_t* data, size_t length);
+
             /**
              * @brief Sends a string to the UART interface.
-             * 
+             *
+             * The string is sent as one block using @ref write(const uint8_t*, size_t) without
+             * being copied.
+             *
              * @param data The string to send to UART interface.
              */
-            void write(std::string data);
+            void write(std::string_view data) { write((const uint8_t*)data.data(), data.length()); }
+
+            /**
+             * @brief Receives a block of data from the UART interface.
+             *
+             * The default implementation receives the data frame by frame using @ref recvFrame(),
+             * which can't report a timeout, so it always returns @p length.
+             *
+             * @param data Pointer to the memory the data is copied to.
+             * @param length The number of bytes to receive.
+             * @param timeout The maximum time to wait for in milliseconds.
+             * @return Returns the number of bytes received before the timeout elapsed.
+             */
+            virtual size_t read(uint8_t* data, size_t length, uint32_t timeout = LIBEMBED_CONFIG_STM32_UART_DEFAULT_RECV_TIMEOUT);
+
+            /**
+             * @brief Receives a block of data terminated by an idle line, e.g. a Modbus RTU frame.
+             *
+             * This waits up to @p timeout for the first byte and then receives until the line has
+             * been idle for the idle time (see @ref setIdleTime()) or @p length bytes have been
+             * received. The default implementation can't detect an idle line, so it receives the
+             * first byte using @ref read() and then only the bytes reported by @ref available().
+             *
+             * @param data Pointer to the memory the data is copied to.
+             * @param length The maximum number of bytes to receive.
+             * @param timeout The maximum time to wait for the first byte in milliseconds.
+             * @return Returns the number of bytes received, or 0 if the timeout has elapsed.
+             */
+            virtual size_t readUntilIdle(uint8_t* data, size_t length, uint32_t timeout = LIBEMBED_CONFIG_STM32_UART_DEFAULT_RECV_TIMEOUT);
+
+            /**
+             * @brief Sets the time the line must be idle for @ref readUntilIdle() to detect the end
+             * of a block.
+             *
+             * Implementations which can't configure the idle time use a fixed one, e.g. one frame.
+             *
+             * @param bits The requested idle time in bit times.
+             * @return Returns the idle time actually used in bit times, or 0 if it is unknown.
+             */
+            virtual uint32_t setIdleTime(uint32_t bits);
+
+            /**
+             * @brief Gets the number of bytes which can be read without waiting.
+             *
+             * The default implementation returns 0, i.e. the number is unknown.
+             *
+             * @return Returns the number of received bytes which have not been read yet.
+             */
+            virtual size_t available();
+
+            /**
+             * @brief Waits until all data written to the interface has been transmitted.
+             *
+             * This function is coroutine-compatible, i.e. yields while waiting.
+             */
+            virtual void flush();
     };
 
     /**
@@ -116,6 +206,9 @@ namespace embed::uart {
              */
             HardwareUART_Base(uart::UART_HardwareInterface& interface);
 
+            using UART_Base::write;
+            using UART_Base::read;
+
             virtual void begin(Baudrate baudrate = 9600, uint8_t wordLength = 8, ParityMode parityMode = PARITY_DISABLED, StopBitMode stopBitMode = STOPBIT_1) = 0;
             virtual void writeFrame(DataFrame data, uint32_t timeout = LIBEMBED_CONFIG_STM32_UART_DEFAULT_SEND_TIMEOUT) = 0;
             virtual DataFrame recvFrame(uint32_t timeout = LIBEMBED_CONFIG_STM32_UART_DEFAULT_RECV_TIMEOUT) = 0;
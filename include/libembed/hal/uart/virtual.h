@@ -0,0 +1,195 @@
+/**
+ * @file virtual.h
+ * @author Gabriel Heinzer
+ * @brief Software UART ports connected by a simulated serial line.
+ *
+ * The virtual ports don't depend on any hardware, so they can be used in host builds, e.g. as
+ * a test double for protocol code or for benchmarking it. The line is simulated in virtual
+ * time: transmitting a frame advances the time of the line by one frame time at the configured
+ * baudrate, so the throughput of a protocol can be measured independently of the CPU it runs on.
+ */
+
+#include <libembed/hal/uart/types.h>
+#include <libembed/util/ringbuffer.h>
+#include <libembed/config.h>
+#include <stdint.h>
+#include <stddef.h>
+
+#ifndef LIBEMBED_HAL_UART_VIRTUAL_H_
+#define LIBEMBED_HAL_UART_VIRTUAL_H_
+
+namespace embed::uart {
+    class VirtualLine;
+
+    /**
+     * @brief Software UART port, one end of a @ref VirtualLine.
+     *
+     * Frames written to a port are received by the other port of the line. If the receive
+     * buffer of the other port (@ref LIBEMBED_CONFIG_VIRTUAL_UART_BUFFER_SIZE) is full, the frame
+     * is lost and counted as an overrun. Errors can be injected into the received frames using
+     * @ref setErrorRate().
+     */
+    class VirtualUART : public UART_Base {
+        private:
+            //! Line the port belongs to
+            VirtualLine& line_;
+            //! Port at the other end of the line
+            VirtualUART& peer_;
+
+            //! Received frames which have not been read yet
+            util::RingBuffer<DataFrame, LIBEMBED_CONFIG_VIRTUAL_UART_BUFFER_SIZE> rxBuffer_;
+
+            //! Duration of a frame in nanoseconds, set by @ref begin()
+            uint64_t frameTime_ = 0;
+            //! Mask of the data bits of a frame
+            DataFrame frameMask_ = 0xFF;
+
+            //! Every n-th received frame gets a bit error, or 0
+            uint32_t corruptInterval_ = 0;
+            //! Every n-th received frame is lost, or 0
+            uint32_t dropInterval_ = 0;
+            //! State of the pseudo-random number generator selecting the errors
+            uint32_t random_ = 0x12345678;
+
+            uint32_t transmitted_ = 0;
+            uint32_t received_ = 0;
+            uint32_t errors_ = 0;
+            uint32_t overruns_ = 0;
+
+            //! Gets the next pseudo-random number (xorshift32).
+            uint32_t nextRandom_();
+
+            //! Receives a frame from the peer.
+            void receive_(DataFrame data);
+
+        public:
+            /**
+             * @brief Creates a port. Use @ref VirtualLine instead of creating ports directly.
+             *
+             * @param line The line the port belongs to.
+             * @param peer The port at the other end of the line.
+             */
+            VirtualUART(VirtualLine& line, VirtualUART& peer) : line_(line), peer_(peer) { }
+
+            using UART_Base::write;
+            using UART_Base::read;
+
+            /**
+             * @brief Configures the port. Both ports of a line should use the same settings.
+             *
+             * The settings only determine the frame time and the number of data bits. As on the
+             * hardware UARTs, @p wordLength includes the parity bit.
+             */
+            void begin(Baudrate baudrate = 9600, uint8_t wordLength = 8, ParityMode parityMode = PARITY_DISABLED, StopBitMode stopBitMode = STOPBIT_1) override;
+
+            void writeFrame(DataFrame data, uint32_t timeout = LIBEMBED_CONFIG_STM32_UART_DEFAULT_SEND_TIMEOUT) override;
+
+            /**
+             * @brief Receives a single frame.
+             *
+             * @return Returns the received frame, or 0 if no frame is available. In this case,
+             * the time of the line advances by @p timeout.
+             */
+            DataFrame recvFrame(uint32_t timeout = LIBEMBED_CONFIG_STM32_UART_DEFAULT_RECV_TIMEOUT) override;
+
+            /**
+             * @brief Transmits a block of data.
+             *
+             * The data is received by the other port immediately, while the time of the line
+             * advances by the time required for transmitting it.
+             */
+            void write(const uint8_t* data, size_t length) override;
+
+            /**
+             * @brief Receives a block of data.
+             *
+             * As all data written to the line has already been received, this doesn't wait
+             * for more data. If fewer than @p length bytes are available, the time of the line
+             * advances by @p timeout instead.
+             *
+             * @return Returns the number of bytes received.
+             */
+            size_t read(uint8_t* data, size_t length, uint32_t timeout = LIBEMBED_CONFIG_STM32_UART_DEFAULT_RECV_TIMEOUT) override;
+
+            size_t available() override;
+
+            /**
+             * @brief Injects errors into the frames received by this port.
+             *
+             * The frames affected are chosen pseudo-randomly with the specified average intervals.
+             *
+             * @param corruptInterval Every n-th frame on average gets a single bit error, or 0 for none.
+             * @param dropInterval Every n-th frame on average is lost, or 0 for none.
+             * @param seed Seed of the pseudo-random number generator (must not be 0).
+             */
+            void setErrorRate(uint32_t corruptInterval, uint32_t dropInterval, uint32_t seed = 0x12345678);
+
+            //! Gets the number of frames transmitted by this port.
+            uint32_t transmitted() const { return transmitted_; }
+
+            //! Gets the number of frames received by this port, including corrupted and lost frames.
+            uint32_t received() const { return received_; }
+
+            //! Gets the number of frames received by this port which have been corrupted or lost.
+            uint32_t errors() const { return errors_; }
+
+            //! Gets the number of frames lost because the receive buffer of this port was full.
+            uint32_t overruns() const { return overruns_; }
+    };
+
+    /**
+     * @brief Simulated serial line connecting two @ref VirtualUART ports.
+     *
+     * Example:
+     * ```cpp
+     * uart::VirtualLine line;
+     * line.a.begin(115200);
+     * line.b.begin(115200);
+     * line.a.write("Hello");
+     * size_t length = line.b.read(buffer, 5);
+     * ```
+     */
+    class VirtualLine {
+        private:
+            //! Virtual time of the line in nanoseconds
+            uint64_t time_ = 0;
+
+        public:
+            //! First port of the line
+            VirtualUART a;
+            //! Second port of the line
+            VirtualUART b;
+
+            VirtualLine() : a(*this, b), b(*this, a) { }
+
+            VirtualLine(const VirtualLine&) = delete;
+            VirtualLine& operator=(const VirtualLine&) = delete;
+
+            /**
+             * @brief Gets the virtual time of the line.
+             *
+             * @return Returns the time spent transmitting and waiting in nanoseconds.
+             */
+            uint64_t time() const { return time_; }
+
+            /**
+             * @brief Advances the virtual time of the line.
+             *
+             * @param nanoseconds The time to advance by.
+             */
+            void advance(uint64_t nanoseconds) { time_ += nanoseconds; }
+
+            /**
+             * @brief Drives the timestamp counter of host builds by the virtual time of the line.
+             *
+             * Afterwards, @ref embed::clock::getTimestamp() returns the time of the line in
+             * nanoseconds, and every call advances it by 100 ns, the time of one iteration of a
+             * polling loop. Protocol code waiting for a gap on the line (e.g.
+             * @ref embed::modbus::Slave) thus spends virtual line time instead of real time. Without
+             * a line, host builds count the nanoseconds of the steady clock. Only available on the host.
+             */
+            void useAsClock();
+    };
+}
+
+#endif /* LIBEMBED_HAL_UART_VIRTUAL_H_ */
@@ -0,0 +1,283 @@
+/**
+ * @file framing.h
+ * @author Gabriel Heinzer
+ * @brief Packet framing (COBS or SLIP) with an optional CRC over any UART.
+ *
+ * Packets are delimited using Consistent Overhead Byte Stuffing (COBS, every packet is
+ * terminated by a zero byte) or SLIP (RFC 1055). A CRC-16 or CRC-32 can be appended to every
+ * packet. Encoding, decoding and the CRC calculation happen in the same pass over the data:
+ * the decoder writes every received byte straight into the packet buffer and updates the CRC
+ * on the way, and the packet is checked using the CRC residue once the delimiter arrives.
+ */
+
+#include <libembed/hal/uart/types.h>
+#include <libembed/config.h>
+#include <libembed/util/crc.h>
+#include <stdint.h>
+#include <stddef.h>
+
+#ifndef LIBEMBED_PROTOCOL_FRAMING_H_
+#define LIBEMBED_PROTOCOL_FRAMING_H_
+
+//! Packet framing over byte streams
+namespace embed::framing {
+    /**
+     * @brief Framing method.
+     */
+    typedef enum {
+        //! Consistent Overhead Byte Stuffing, packets are terminated by a zero byte
+        FRAMING_COBS,
+        //! Serial Line Internet Protocol (RFC 1055), packets are delimited by 0xC0
+        FRAMING_SLIP
+    } Framing;
+
+    /**
+     * @brief Checksum appended to every packet.
+     */
+    typedef enum {
+        //! No checksum
+        CHECKSUM_NONE,
+        //! @ref crc::CRC16, appended in big-endian byte order
+        CHECKSUM_CRC16,
+        //! @ref crc::CRC32, appended in little-endian byte order
+        CHECKSUM_CRC32
+    } Checksum;
+
+    /**
+     * @brief Result of feeding a byte to a @ref Decoder.
+     */
+    typedef enum {
+        //! The packet is not complete yet
+        DECODE_PENDING,
+        //! A valid packet has been received
+        DECODE_PACKET,
+        //! A packet with an invalid checksum has been received
+        DECODE_ERROR_CHECKSUM,
+        //! A malformed packet has been received
+        DECODE_ERROR_FRAMING,
+        //! A packet too large for the buffer has been received
+        DECODE_ERROR_OVERFLOW
+    } DecodeResult;
+
+    //! @internal CRC-16 or CRC-32 calculation selected at runtime
+    class __Checksum {
+        private:
+            Checksum type_;
+            crc::CRC16 crc16_;
+            crc::CRC32 crc32_;
+
+        public:
+            __Checksum(Checksum type) : type_(type) { }
+
+            void reset() {
+                crc16_.reset();
+                crc32_.reset();
+            }
+
+            void update(uint8_t byte) {
+                if(type_ == CHECKSUM_CRC16) crc16_.update(byte);
+                else if(type_ == CHECKSUM_CRC32) crc32_.update(byte);
+            }
+
+            //! Gets the bytes of the checksum in transmission order.
+            size_t bytes(uint8_t* data) const;
+
+            //! Checks the residue after the appended checksum has been added.
+            bool valid() const;
+
+            //! Gets the number of bytes of the checksum.
+            size_t size() const { return type_ == CHECKSUM_CRC16 ? crc::CRC16::SIZE : type_ == CHECKSUM_CRC32 ? crc::CRC32::SIZE : 0; }
+    };
+
+    /**
+     * @brief Streaming packet decoder.
+     *
+     * Bytes are decoded into a buffer provided by the user as they are fed to the decoder. The
+     * buffer must have room for the checksum as well.
+     */
+    class Decoder {
+        private:
+            uint8_t* buffer_;
+            size_t size_;
+            Framing framing_;
+            __Checksum checksum_;
+
+            //! Number of bytes decoded in the current packet
+            size_t length_ = 0;
+            //! Length of the last valid packet, excluding the checksum
+            size_t packetLength_ = 0;
+            //! Set if a byte has been received since the last delimiter
+            bool started_ = false;
+            //! Set if the current packet is malformed
+            bool invalid_ = false;
+            //! Set if the current packet didn't fit into the buffer
+            bool overflow_ = false;
+
+            //! COBS: number of data bytes remaining in the current block
+            uint8_t remaining_ = 0;
+            //! COBS: code of the current block, or 0 before the first block
+            uint8_t code_ = 0;
+            //! SLIP: set after an escape byte
+            bool escaped_ = false;
+
+            //! Adds a decoded byte to the packet.
+            void put_(uint8_t byte) {
+                if(length_ < size_) buffer_[length_++] = byte;
+                else overflow_ = true;
+                checksum_.update(byte);
+            }
+
+            //! Completes the current packet when the delimiter has been received.
+            DecodeResult finish_(bool valid);
+
+        public:
+            /**
+             * @brief Creates a decoder.
+             *
+             * @param buffer Buffer the packets are decoded into.
+             * @param size Size of the buffer, i.e. the maximum packet length plus the checksum length.
+             * @param framing The framing method.
+             * @param checksum The checksum appended to every packet.
+             */
+            Decoder(uint8_t* buffer, size_t size, Framing framing = FRAMING_COBS, Checksum checksum = CHECKSUM_CRC16)
+                : buffer_(buffer), size_(size), framing_(framing), checksum_(checksum) { }
+
+            /**
+             * @brief Decodes a received byte.
+             *
+             * @param byte The received byte.
+             * @return Returns @ref DECODE_PACKET once a valid packet has been received. The packet
+             * is valid until the next byte is fed to the decoder.
+             */
+            DecodeResult feed(uint8_t byte);
+
+            //! Discards the packet currently being received.
+            void reset();
+
+            //! Gets the last valid packet.
+            const uint8_t* data() const { return buffer_; }
+
+            //! Gets the length of the last valid packet, excluding the checksum.
+            size_t length() const { return packetLength_; }
+    };
+
+    /**
+     * @brief Streaming packet encoder writing to a UART.
+     *
+     * A packet can be written in several parts between @ref begin() and @ref end(), e.g. a header
+     * and a payload, without copying them into a contiguous buffer first.
+     */
+    class Encoder {
+        private:
+            uart::UART_Base& uart_;
+            Framing framing_;
+            __Checksum checksum_;
+
+            //! Encoded data not written to the UART yet; holds one complete COBS block
+            uint8_t buffer_[255];
+            //! Number of bytes in the buffer (for COBS, including the code byte at the beginning)
+            size_t length_ = 0;
+
+            //! Encodes a single byte.
+            void put_(uint8_t byte);
+
+            //! Writes the buffer to the UART.
+            void flush_();
+
+        public:
+            /**
+             * @brief Creates an encoder.
+             *
+             * @param uart The UART to write the packets to.
+             * @param framing The framing method.
+             * @param checksum The checksum appended to every packet.
+             */
+            Encoder(uart::UART_Base& uart, Framing framing = FRAMING_COBS, Checksum checksum = CHECKSUM_CRC16)
+                : uart_(uart), framing_(framing), checksum_(checksum) { }
+
+            //! Starts a new packet.
+            void begin();
+
+            /**
+             * @brief Adds data to the current packet.
+             *
+             * @param data Pointer to the data.
+             * @param length The number of bytes.
+             */
+            void write(const uint8_t* data, size_t length);
+
+            //! Appends the checksum and the delimiter and writes the rest of the packet to the UART.
+            void end();
+    };
+
+    /**
+     * @brief Bidirectional packet link over a UART.
+     *
+     * Received bytes are read from the UART in blocks of up to
+     * @ref LIBEMBED_CONFIG_FRAMING_READ_CHUNK_SIZE bytes and decoded into the packet buffer.
+     */
+    class Link {
+        private:
+            uart::UART_Base& uart_;
+            Decoder decoder_;
+            Encoder encoder_;
+
+            //! Bytes read from the UART which have not been decoded yet
+            uint8_t pending_[LIBEMBED_CONFIG_FRAMING_READ_CHUNK_SIZE];
+            size_t pendingStart_ = 0;
+            size_t pendingLength_ = 0;
+
+            uint32_t checksumErrors_ = 0;
+            uint32_t framingErrors_ = 0;
+
+        public:
+            /**
+             * @brief Creates a packet link.
+             *
+             * @param uart The UART to use.
+             * @param buffer Buffer the received packets are decoded into.
+             * @param size Size of the buffer, i.e. the maximum packet length plus the checksum length.
+             * @param framing The framing method.
+             * @param checksum The checksum appended to every packet.
+             */
+            Link(uart::UART_Base& uart, uint8_t* buffer, size_t size, Framing framing = FRAMING_COBS, Checksum checksum = CHECKSUM_CRC16)
+                : uart_(uart), decoder_(buffer, size, framing, checksum), encoder_(uart, framing, checksum) { }
+
+            /**
+             * @brief Sends a packet.
+             *
+             * @param data Pointer to the packet data.
+             * @param length The length of the packet.
+             */
+            void send(const uint8_t* data, size_t length);
+
+            /**
+             * @brief Gets the encoder for sending a packet in several parts.
+             */
+            Encoder& encoder() { return encoder_; }
+
+            /**
+             * @brief Waits for a valid packet.
+             *
+             * Packets with an invalid checksum or malformed packets are counted and discarded,
+             * empty packets are ignored.
+             * This function is coroutine-compatible if the UART is, i.e. yields while waiting.
+             *
+             * @param timeout The maximum time to wait for the next byte in milliseconds.
+             * @return Returns the length of the packet, or 0 if no byte has been received within
+             * @p timeout. The packet is available using @ref packet() until the next call.
+             */
+            size_t receive(uint32_t timeout = LIBEMBED_CONFIG_STM32_UART_DEFAULT_RECV_TIMEOUT);
+
+            //! Gets the last packet returned by @ref receive().
+            const uint8_t* packet() const { return decoder_.data(); }
+
+            //! Gets the number of packets discarded because of an invalid checksum.
+            uint32_t checksumErrors() const { return checksumErrors_; }
+
+            //! Gets the number of packets discarded because they were malformed or too large.
+            uint32_t framingErrors() const { return framingErrors_; }
+    };
+}
+
+#endif /* LIBEMBED_PROTOCOL_FRAMING_H_ */
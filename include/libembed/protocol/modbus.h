@@ -0,0 +1,164 @@
+/**
+ * @file modbus.h
+ * @author Gabriel Heinzer
+ * @brief Modbus RTU slave on top of any UART.
+ *
+ * Frames are delimited by the silence on the line, which is detected by the UART itself (see
+ * @ref embed::uart::UART_Base::readUntilIdle()) instead of a software timer. Requests are
+ * answered from a @ref embed::modbus::RegisterTable provided by the application.
+ */
+
+#include <libembed/hal/uart/types.h>
+#include <libembed/util/crc.h>
+#include <stdint.h>
+#include <stddef.h>
+
+#ifndef LIBEMBED_PROTOCOL_MODBUS_H_
+#define LIBEMBED_PROTOCOL_MODBUS_H_
+
+//! Modbus RTU
+namespace embed::modbus {
+    /**
+     * @brief Modbus function codes supported by the @ref Slave.
+     */
+    typedef enum {
+        //! Read holding registers
+        FUNCTION_READ_HOLDING_REGISTERS = 3,
+        //! Read input registers
+        FUNCTION_READ_INPUT_REGISTERS = 4,
+        //! Write single register
+        FUNCTION_WRITE_SINGLE_REGISTER = 6,
+        //! Write multiple registers
+        FUNCTION_WRITE_MULTIPLE_REGISTERS = 16
+    } FunctionCode;
+
+    /**
+     * @brief Modbus exception codes.
+     */
+    typedef enum {
+        //! No exception
+        EXCEPTION_NONE = 0,
+        //! The function code is not supported
+        EXCEPTION_ILLEGAL_FUNCTION = 1,
+        //! The register range is not available
+        EXCEPTION_ILLEGAL_DATA_ADDRESS = 2,
+        //! The request contains an invalid value, e.g. a register count out of range
+        EXCEPTION_ILLEGAL_DATA_VALUE = 3
+    } ExceptionCode;
+
+    /**
+     * @brief Registers exposed by a @ref Slave.
+     *
+     * Register addresses start at 0 for both tables.
+     */
+    struct RegisterTable {
+        //! Holding registers, read by function code 3 and written by 6 and 16
+        uint16_t* holdingRegisters;
+        //! Number of holding registers
+        uint16_t holdingRegisterCount;
+        //! Input registers, read by function code 4
+        const uint16_t* inputRegisters;
+        //! Number of input registers
+        uint16_t inputRegisterCount;
+        /**
+         * @brief Function called after holding registers have been written, or `nullptr`.
+         *
+         * It is called before the response is sent, so it must return quickly.
+         *
+         * @param address The address of the first register written.
+         * @param count The number of registers written.
+         */
+        void (*written)(uint16_t address, uint16_t count);
+    };
+
+    /**
+     * @brief Modbus RTU slave.
+     *
+     * The end of a request is detected when the UART reports an idle line. If the UART detects the
+     * idle line before the 3.5 character times of silence required by Modbus RTU have elapsed,
+     * the response is held back until then, so it starts within a few microseconds after the gap.
+     * Data received within 1.5 character times of silence is appended to the request, so masters
+     * may pause within a frame as allowed by Modbus RTU even if the UART detects the idle line
+     * after a single character (e.g. on STM32F4).
+     */
+    class Slave {
+        private:
+            uart::UART_Base& uart_;
+            uint8_t address_;
+            RegisterTable& table_;
+
+            //! Request or response (a Modbus RTU frame has at most 256 bytes)
+            uint8_t frame_[256];
+
+            //! Silence required after a request before responding, in timestamp ticks
+            uint32_t turnaroundTicks_ = 0;
+            //! Duration of a character, in timestamp ticks
+            uint32_t characterTicks_ = 0;
+            //! Time after the UART reported an idle line during which received data continues the frame, in timestamp ticks
+            uint32_t continuationTicks_ = 0;
+
+            uint32_t requests_ = 0;
+            uint32_t crcErrors_ = 0;
+            uint32_t exceptions_ = 0;
+
+            /**
+             * @brief Executes a request addressed to this slave.
+             *
+             * @param length The length of the request, excluding the CRC.
+             * @return Returns the length of the response, excluding the CRC.
+             */
+            size_t process_(size_t length);
+
+            //! Replaces the response by an exception response.
+            size_t exception_(ExceptionCode code);
+
+        public:
+            /**
+             * @brief Creates a Modbus RTU slave.
+             *
+             * @param uart The UART to use. It must be initialized by the application, e.g. in
+             * RS-485 mode.
+             * @param address The slave address (1 to 247).
+             * @param table The registers exposed by the slave.
+             */
+            Slave(uart::UART_Base& uart, uint8_t address, RegisterTable& table) : uart_(uart), address_(address), table_(table) { }
+
+            /**
+             * @brief Configures the frame timing for the baudrate of the UART.
+             *
+             * The inter-frame gap is 3.5 characters of 11 bits, or 1.75 ms above 19200 baud. Gaps
+             * within a frame may be up to 1.5 characters, or 0.75 ms above 19200 baud.
+             *
+             * @param baudrate The baudrate the UART has been initialized with.
+             */
+            void begin(uart::Baudrate baudrate);
+
+            /**
+             * @brief Waits for a request and answers it.
+             *
+             * Requests with an invalid CRC and requests for other slaves are ignored. Broadcast
+             * requests (address 0) are executed without sending a response.
+             * This function is coroutine-compatible if the UART is, i.e. yields while waiting.
+             *
+             * @param timeout The maximum time to wait for a request in milliseconds.
+             * @return Returns `true` if a request for this slave has been executed.
+             */
+            bool poll(uint32_t timeout = LIBEMBED_CONFIG_STM32_UART_DEFAULT_RECV_TIMEOUT);
+
+            /**
+             * @brief Answers requests forever, e.g. as the entry point of a coroutine.
+             */
+            [[noreturn]] void run();
+
+            //! Gets the number of requests executed.
+            uint32_t requests() const { return requests_; }
+
+            //! Gets the number of frames discarded because of an invalid CRC.
+            uint32_t crcErrors() const { return crcErrors_; }
+
+            //! Gets the number of exception responses sent.
+            uint32_t exceptions() const { return exceptions_; }
+    };
+}
+
+#endif /* LIBEMBED_PROTOCOL_MODBUS_H_ */
@@ -59,7 +59,8 @@
         struct Coroutine_Base;
 
         /**
-         * @brief Pointer to the current coroutine.
+         * @brief Pointer to the current coroutine, or `nullptr` outside of coroutines (e.g. in the
+         * scheduler).
          */
         extern Coroutine_Base* current;
 
@@ -208,6 +209,13 @@
                  * @brief The stack size of the coroutine.
                  */
                 const size_t stackSize;
+                /**
+                 * @brief Unique ID of the coroutine, starting at 1.
+                 *
+                 * The ID 0 is used for code running outside of any coroutine, e.g. in
+                 * the debug log.
+                 */
+                const uint16_t id;
                 /**
                  * @brief Specifies if the coroutine is currently active. This
                  * has nothing to do with the coroutine having yielded or not,
@@ -228,6 +236,12 @@
                  *  - @ref resume()
                  */
                 bool isPaused = false;
+                /**
+                 * @brief Specifies if the scheduler emits trace records when switching to and from
+                 * the coroutine. Disabled for the debug drain coroutine, whose scheduling would
+                 * otherwise produce records faster than it can emit them.
+                 */
+                bool isTraced = true;
                 
                 #if LIBEMBED_CONFIG_ENABLE_DEBUGGING
                     /**
@@ -395,6 +409,44 @@ namespace embed::coroutines {
              */
             void release_noyield();
     };
+
+    /**
+     * @brief Event flag a coroutine can wait for.
+     *
+     * The event can be set from an interrupt handler, e.g. for signalling the completion
+     * of a DMA transfer. This is also available if coroutines are disabled, in which case
+     * @ref wait() busy-waits.
+     */
+    class Event {
+        private:
+            //! Internal event state variable
+            volatile bool set_ = false;
+
+        public:
+            /**
+             * @brief Sets the event. This may be called from an interrupt handler.
+             */
+            void set() { set_ = true; }
+
+            /**
+             * @brief Clears the event without waiting for it.
+             */
+            void clear() { set_ = false; }
+
+            /**
+             * @brief Checks whether the event is set.
+             *
+             * @return Returns `true` if the event has been set and not been cleared yet.
+             */
+            bool isSet() const { return set_; }
+
+            /**
+             * @brief Waits for the event to be set and clears it.
+             *
+             * This yields the current coroutine while the event is not set.
+             */
+            void wait();
+    };
 }
 
 #endif /* COROUTINES_HPP_ */
\ No newline at end of file
@@ -0,0 +1,180 @@
+/**
+ * @file crc.h
+ * @author Gabriel Heinzer
+ * @brief Incremental table-driven CRC calculation.
+ */
+
+#include <stdint.h>
+#include <stddef.h>
+#include <array>
+
+#ifndef LIBEMBED_UTIL_CRC_H_
+#define LIBEMBED_UTIL_CRC_H_
+
+//! Cyclic redundancy checks
+namespace embed::crc {
+    //! @internal Lookup table of @ref CRC16 (256 entries, in flash)
+    extern const std::array<uint16_t, 256> __crc16Table;
+
+    //! @internal Lookup table of @ref CRC32 (256 entries, in flash)
+    extern const std::array<uint32_t, 256> __crc32Table;
+
+    //! @internal Lookup table of @ref CRC16Modbus (256 entries, in flash)
+    extern const std::array<uint16_t, 256> __crc16ModbusTable;
+
+    /**
+     * @brief Incremental CRC-16/CCITT-FALSE (polynomial 0x1021, initial value 0xFFFF, not reflected).
+     *
+     * If the CRC is appended to the data in big-endian byte order, the CRC over the data
+     * including the appended CRC is @ref RESIDUE. This allows checking a packet while it is
+     * being received, without knowing in advance where the data ends.
+     */
+    class CRC16 {
+        private:
+            //! Current CRC register value
+            uint16_t crc_ = 0xFFFF;
+
+        public:
+            //! CRC over data followed by its big-endian CRC
+            static constexpr uint16_t RESIDUE = 0x0000;
+
+            //! Number of bytes of the CRC
+            static constexpr size_t SIZE = 2;
+
+            //! Restarts the calculation.
+            void reset() { crc_ = 0xFFFF; }
+
+            //! Adds a single byte to the calculation.
+            void update(uint8_t byte) { crc_ = (crc_ << 8) ^ __crc16Table[(crc_ >> 8) ^ byte]; }
+
+            /**
+             * @brief Adds a block of data to the calculation.
+             *
+             * @param data Pointer to the data.
+             * @param length The number of bytes.
+             */
+            void update(const uint8_t* data, size_t length) {
+                while(length--) update(*data++);
+            }
+
+            //! Gets the CRC of the data added since the last reset.
+            uint16_t value() const { return crc_; }
+
+            /**
+             * @brief Calculates the CRC of a block of data.
+             *
+             * @param data Pointer to the data.
+             * @param length The number of bytes.
+             * @return Returns the CRC.
+             */
+            static uint16_t compute(const uint8_t* data, size_t length) {
+                CRC16 crc;
+                crc.update(data, length);
+                return crc.value();
+            }
+    };
+
+    /**
+     * @brief Incremental CRC-16/MODBUS (polynomial 0x8005, initial value 0xFFFF, reflected).
+     *
+     * Modbus RTU appends the CRC in little-endian byte order, so the CRC over a complete frame
+     * is @ref RESIDUE.
+     */
+    class CRC16Modbus {
+        private:
+            //! Current CRC register value
+            uint16_t crc_ = 0xFFFF;
+
+        public:
+            //! CRC over data followed by its little-endian CRC
+            static constexpr uint16_t RESIDUE = 0x0000;
+
+            //! Number of bytes of the CRC
+            static constexpr size_t SIZE = 2;
+
+            //! Restarts the calculation.
+            void reset() { crc_ = 0xFFFF; }
+
+            //! Adds a single byte to the calculation.
+            void update(uint8_t byte) { crc_ = (crc_ >> 8) ^ __crc16ModbusTable[(crc_ ^ byte) & 0xFF]; }
+
+            /**
+             * @brief Adds a block of data to the calculation.
+             *
+             * @param data Pointer to the data.
+             * @param length The number of bytes.
+             */
+            void update(const uint8_t* data, size_t length) {
+                while(length--) update(*data++);
+            }
+
+            //! Gets the CRC of the data added since the last reset.
+            uint16_t value() const { return crc_; }
+
+            /**
+             * @brief Calculates the CRC of a block of data.
+             *
+             * @param data Pointer to the data.
+             * @param length The number of bytes.
+             * @return Returns the CRC.
+             */
+            static uint16_t compute(const uint8_t* data, size_t length) {
+                CRC16Modbus crc;
+                crc.update(data, length);
+                return crc.value();
+            }
+    };
+
+    /**
+     * @brief Incremental CRC-32 as used by Ethernet and zlib (polynomial 0x04C11DB7, reflected).
+     *
+     * If the CRC is appended to the data in little-endian byte order, the CRC over the data
+     * including the appended CRC is @ref RESIDUE.
+     */
+    class CRC32 {
+        private:
+            //! Current CRC register value (not inverted)
+            uint32_t crc_ = 0xFFFFFFFF;
+
+        public:
+            //! CRC over data followed by its little-endian CRC
+            static constexpr uint32_t RESIDUE = 0x2144DF1C;
+
+            //! Number of bytes of the CRC
+            static constexpr size_t SIZE = 4;
+
+            //! Restarts the calculation.
+            void reset() { crc_ = 0xFFFFFFFF; }
+
+            //! Adds a single byte to the calculation.
+            void update(uint8_t byte) { crc_ = (crc_ >> 8) ^ __crc32Table[(crc_ ^ byte) & 0xFF]; }
+
+            /**
+             * @brief Adds a block of data to the calculation.
+             *
+             * @param data Pointer to the data.
+             * @param length The number of bytes.
+             */
+            void update(const uint8_t* data, size_t length) {
+                while(length--) update(*data++);
+            }
+
+            //! Gets the CRC of the data added since the last reset.
+            uint32_t value() const { return ~crc_; }
+
+            /**
+             * @brief Calculates the CRC of a block of data.
+             *
+             * @param data Pointer to the data.
+             * @param length The number of bytes.
+             * @return Returns the CRC.
+             */
+            static uint32_t compute(const uint8_t* data, size_t length) {
+                CRC32 crc;
+                crc.update(data, length);
+                return crc.value();
+            }
+    };
+}
+
+#endif /* LIBEMBED_UTIL_CRC_H_ */
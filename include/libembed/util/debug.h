@@ -1,52 +1,565 @@
 /**
  * @file debug.h
  * @author Gabriel Heinzer
- * @brief Debugging utility with no performance overhead when disabling debugging.
+ * @brief Deferred binary logging utility with no performance overhead when disabling debugging.
+ *
+ * Log calls do not format any text. Instead, every call site owns a constant
+ * @ref embed::debug::LogSite descriptor which stays in flash, and only the address of that
+ * descriptor together with a timestamp, the current coroutine ID (0 outside of coroutines) and the raw argument values
+ * is written into a RAM ring buffer. Text is only rendered when the buffer is emitted to the
+ * sinks registered using @ref embed::debug::addSink(), or not at all for sinks in the
+ * @ref embed::debug::OUTPUT_BINARY mode, where the records can be turned back into text on the
+ * host using `scripts/libembed_decode_log.py` and the firmware ELF file.
+ *
+ * Format strings use `{}` placeholders with optional Python-style format specifications,
+ * e.g. `libembed_debug_info("Sample {} = {:04x}", index, value);`. Structured values can be
+ * attached using @ref embed::debug::field(), e.g.
+ * `libembed_debug_info("ADC sample", debug::field("channel", channel), debug::field("raw", raw));`.
+ *
+ * Levels can be filtered at compile time (@ref LIBEMBED_CONFIG_ENABLE_DEBUGLEVEL_INFO,
+ * @ref LIBEMBED_CONFIG_ENABLE_DEBUGLEVEL_TRACE), in which case the log calls compile to nothing,
+ * and at runtime per module (@ref embed::debug::setLevelMask()). The arguments of a log call
+ * are only evaluated if its level is enabled for its module.
  */
 
 #include <libembed/config.h>
 #include <libembed/util/macros.h>
 #include <string>
+#include <string.h>
+#include <stdint.h>
+#include <stddef.h>
+#include <type_traits>
 
 #ifndef LIBEMBED_DEBUG_H_
 #define LIBEMBED_DEBUG_H_
 
 #if LIBEMBED_CONFIG_ENABLE_DEBUGGING
 
+#ifndef LIBEMBED_DEBUG_MODULE
+    /**
+     * @brief Module the log calls in the current translation unit are assigned to.
+     *
+     * Redefine this after the includes of a source file to assign its log calls to another
+     * @ref embed::debug::Module. Defaults to @ref embed::debug::MODULE_USER.
+     */
+    #define LIBEMBED_DEBUG_MODULE embed::debug::MODULE_USER
+#endif
+
 #if LIBEMBED_CONFIG_ENABLE_DEBUGLEVEL_INFO == true
-    #define libembed_debug_info(message) embed::debug::info(message, __func__);
+    #define libembed_debug_info(format, ...) __libembed_debug_log(embed::debug::LEVEL_INFO, format, ##__VA_ARGS__)
 #else
-    #define libembed_debug_info(message)
+    #define libembed_debug_info(format, ...) do { } while(0)
 #endif
 #if LIBEMBED_CONFIG_ENABLE_DEBUGLEVEL_TRACE == true
-    #define libembed_debug_trace(message) embed::debug::trace(message, __func__);
+    #define libembed_debug_trace(format, ...) __libembed_debug_log(embed::debug::LEVEL_TRACE, format, ##__VA_ARGS__)
 #else
-    #define libembed_debug_trace(message)
+    #define libembed_debug_trace(format, ...) do { } while(0)
 #endif
 
+/**
+ * @internal
+ * @brief Creates the constant descriptor of a log call site and writes a record to the log buffer.
+ *
+ * The descriptor is a function-local `static const` object, so it is placed in flash together
+ * with the format string, the function name and the argument type list.
+ *
+ * If the level is disabled for the module at runtime, this costs a single branch and
+ * the arguments are not evaluated.
+ */
+#define __libembed_debug_log(level, format, ...) \
+    do { \
+        if(!(embed::debug::__disabledLevels[LIBEMBED_DEBUG_MODULE] & (1 << (level)))) { \
+            static const embed::debug::LogSite __libembed_debug_site = { \
+                format, __func__, \
+                decltype(embed::debug::__argumentTypeList(__VA_ARGS__))::types, \
+                level, LIBEMBED_DEBUG_MODULE \
+            }; \
+            embed::debug::__log(&__libembed_debug_site, ##__VA_ARGS__); \
+        } \
+    } while(0)
+
 namespace embed::debug {
-    extern void (*writeStringPtr)(std::string);
+    //! Debug levels
+    typedef enum {
+        //! Informational messages
+        LEVEL_INFO = 0,
+        //! Detailed tracing messages
+        LEVEL_TRACE = 1
+    } Level;
+
+    /**
+     * @brief Modules log calls can be assigned to using @ref LIBEMBED_DEBUG_MODULE.
+     *
+     * Each module has its own runtime level mask.
+     */
+    typedef enum {
+        //! User code (default)
+        MODULE_USER = 0,
+        //! The debug subsystem itself
+        MODULE_DEBUG = 1,
+        //! Coroutine scheduler
+        MODULE_COROUTINES = 2,
+        //! Exception handling
+        MODULE_EXCEPTIONS = 3,
+        //! Board support packages
+        MODULE_BSP = 4,
+        //! UART HAL
+        MODULE_UART = 5,
+        //! I2C HAL
+        MODULE_I2C = 6,
+        //! Number of modules
+        MODULE_COUNT
+    } Module;
+
+    /**
+     * @brief Bit mask of enabled levels, where bit `n` corresponds to the @ref Level with the value `n`.
+     */
+    typedef uint8_t LevelMask;
+
+    //! Level mask disabling all levels
+    constexpr LevelMask LEVELMASK_NONE = 0;
+    //! Level mask enabling all levels
+    constexpr LevelMask LEVELMASK_ALL = 0xFF;
+
+    /**
+     * @internal
+     * @brief Inverted runtime level masks of all modules. Use @ref setLevelMask() to modify them.
+     */
+    extern LevelMask __disabledLevels[MODULE_COUNT];
+
+    /**
+     * @brief Sets the levels which are logged at runtime for a module.
+     *
+     * All levels are enabled by default. Levels which are disabled at compile time can not be
+     * enabled at runtime.
+     *
+     * @param module The module to configure.
+     * @param mask The enabled levels, e.g. `1 << LEVEL_INFO`.
+     */
+    void setLevelMask(Module module, LevelMask mask);
+
+    /**
+     * @brief Sets the levels which are logged at runtime for all modules.
+     *
+     * @param mask The enabled levels, e.g. `1 << LEVEL_INFO`.
+     */
+    void setLevelMask(LevelMask mask);
+
+    /**
+     * @brief Checks whether a level is enabled at runtime for a module.
+     *
+     * @param module The module to check.
+     * @param level The level to check.
+     * @return Returns `true` if log calls with the @p level in the @p module are recorded.
+     */
+    inline bool isEnabled(Module module, Level level) { return !(__disabledLevels[module] & (1 << level)); }
+
+    /**
+     * @brief Type tags describing how an argument is stored in a log record.
+     *
+     * @note These values are part of the binary log format and are interpreted by
+     * `scripts/libembed_decode_log.py`. Do not change them without updating the decoder.
+     */
+    typedef enum : uint8_t {
+        //! Terminates the argument type list
+        ARG_END = 0,
+        //! Unsigned integer with up to 32 bits (one word)
+        ARG_UNSIGNED = 1,
+        //! Signed integer with up to 32 bits (one word)
+        ARG_SIGNED = 2,
+        //! Unsigned 64-bit integer (two words, low word first)
+        ARG_UNSIGNED64 = 3,
+        //! Signed 64-bit integer (two words, low word first)
+        ARG_SIGNED64 = 4,
+        //! Character (one word)
+        ARG_CHAR = 5,
+        //! Boolean (one word)
+        ARG_BOOL = 6,
+        //! Pointer (one word)
+        ARG_POINTER = 7,
+        //! String (one word with the length in bytes, followed by the padded characters)
+        ARG_STRING = 8,
+        //! Single-precision floating point number (one word)
+        ARG_FLOAT = 9,
+        //! Double-precision floating point number (two words)
+        ARG_DOUBLE = 10,
+        /**
+         * Flag marking a key/value field created by @ref field(). The argument is stored as the
+         * address of the key, followed by the value as described by the remaining bits.
+         */
+        ARG_FIELD = 0x80
+    } ArgumentType;
+
+    /**
+     * @brief Named value attached to a log record. Create this using @ref field().
+     *
+     * @tparam T The type of the value.
+     */
+    template<typename T>
+    struct Field {
+        //! Name of the field. Must be a string literal, as only its address is recorded.
+        const char* key;
+        //! Value of the field. Only referenced until the log call returns.
+        const T& value;
+    };
+
+    /**
+     * @brief Creates a key/value field which can be passed to a log call in addition to the
+     * format arguments.
+     *
+     * Fields are stored in binary form like all other arguments and are rendered as
+     * `key=value` after the message.
+     *
+     * @param key Name of the field. Must be a string literal.
+     * @param value Value of the field. Any type supported as a log argument can be used.
+     * @return Returns the field to pass to the log call.
+     */
+    template<typename T>
+    constexpr Field<T> field(const char* key, const T& value) { return { key, value }; }
+
+    /**
+     * @brief Constant descriptor of a log call site.
+     *
+     * One of these is created for every log call by @ref libembed_debug_info and
+     * @ref libembed_debug_trace. Its address identifies the call site in a log record.
+     *
+     * @note The layout of this structure is part of the binary log format.
+     */
+    struct LogSite {
+        //! Format string with `{}` placeholders
+        const char* format;
+        //! Name of the function containing the log call
+        const char* function;
+        //! @ref ARG_END terminated list of @ref ArgumentType values
+        const uint8_t* argumentTypes;
+        //! Level of the log call, one of @ref Level
+        uint8_t level;
+        //! Module of the log call, one of @ref Module
+        uint8_t module;
+    };
+
+    /**
+     * @brief Function receiving the emitted log, e.g. a UART write function.
+     *
+     * @param data Pointer to the emitted data.
+     * @param length Length of the emitted data in bytes.
+     */
+    typedef void (*SinkFunction)(const uint8_t* data, size_t length);
+
+    //! Representation of the log emitted to a sink
+    typedef enum {
+        /**
+         * One line of text per record, formatted as
+         * `[LEVEL]\t[module]\t@timestamp\t#coroutine\tfunction()   message key=value`.
+         */
+        OUTPUT_TEXT,
+        /**
+         * The raw records as stored in the log buffer, to be decoded on the host
+         * using `scripts/libembed_decode_log.py`.
+         */
+        OUTPUT_BINARY
+    } OutputMode;
+
+    /**
+     * @brief Registers a sink the emitted log records are written to.
+     *
+     * Every record is handed to all sinks whose level mask contains the level of the record.
+     * A record is rendered at most once, no matter how many sinks use @ref OUTPUT_TEXT.
+     * If the sink is already registered, its mode and level mask are updated.
+     *
+     * The BSPs register the virtual COM port as a sink when initializing it.
+     *
+     * @param write The function the records are written to.
+     * @param mode The representation of the records written to the sink.
+     * @param levels The levels written to the sink, e.g. `1 << LEVEL_INFO`. Note that records are
+     * only created if their level is enabled for their module (see @ref setLevelMask()).
+     * @return Returns `false` if the maximum number of sinks has already been registered.
+     *
+     * @see
+     *  - @ref LIBEMBED_CONFIG_DEBUG_MAX_SINKS
+     */
+    bool addSink(SinkFunction write, OutputMode mode = OUTPUT_TEXT, LevelMask levels = LEVELMASK_ALL);
+
+    /**
+     * @brief Unregisters a sink registered using @ref addSink().
+     *
+     * @param write The function of the sink.
+     */
+    void removeSink(SinkFunction write);
+
+    #if LIBEMBED_CONFIG_DEBUG_CRASH_BUFFER_SIZE > 0 || defined(__DOXYGEN__)
+        /**
+         * @brief Sink writing to the crash buffer, a RAM ring buffer which is retained across warm resets.
+         *
+         * Register this using @ref addSink() to keep the last records before a crash or watchdog reset,
+         * and emit them on the next boot using @ref dumpCrashBuffer(). Only records which have been
+         * emitted reach the crash buffer, so call @ref flush() in your fault handlers.
+         *
+         * @see
+         *  - @ref LIBEMBED_CONFIG_DEBUG_CRASH_BUFFER_SIZE
+         *  - @ref LIBEMBED_CONFIG_DEBUG_CRASH_BUFFER_SECTION
+         */
+        void crashBufferSink(const uint8_t* data, size_t length);
+
+        /**
+         * @brief Writes the contents of the crash buffer to a sink function and clears the crash buffer.
+         *
+         * Call this on boot before any records are emitted to @ref crashBufferSink(). The data is written
+         * in the @ref OutputMode the crash buffer sink was registered with before the reset.
+         *
+         * @param write The function the contents are written to, e.g. a UART write function.
+         * @return Returns `false` if the crash buffer did not contain any data, e.g. after a power-on reset.
+         */
+        bool dumpCrashBuffer(SinkFunction write);
+    #endif
+
+    //! Behaviour of a log call if its record does not fit into the log buffer
+    typedef enum {
+        //! Discard the new record
+        OVERFLOW_DROP_NEWEST,
+        //! Discard the oldest records until the new record fits
+        OVERFLOW_DROP_OLDEST,
+        //! Emit the oldest records from the calling context until the new record fits
+        OVERFLOW_BLOCK
+    } OverflowPolicy;
+
+    /**
+     * @brief Emits all buffered log records to the sinks.
+     *
+     * This blocks until the whole buffer has been handed to the sinks. If
+     * coroutines are enabled, use @ref startDrainCoroutine() instead so that the
+     * log is emitted in the background.
+     *
+     * @see
+     *  - @ref LIBEMBED_CONFIG_DEBUG_BUFFER_SIZE
+     */
+    void flush();
+
+    #if LIBEMBED_CONFIG_ENABLE_COROUTINES == true || defined(__DOXYGEN__)
+        /**
+         * @brief Starts the log drain coroutine.
+         *
+         * The drain coroutine emits the buffered records in the background and yields
+         * after every block of records, so log calls never wait for the sinks.
+         * Dropped records are reported in the log once there is space again.
+         *
+         * The BSPs start this automatically when initializing the virtual COM port.
+         *
+         * @see
+         *  - @ref LIBEMBED_CONFIG_DEBUG_DRAIN_STACK_SIZE
+         */
+        void startDrainCoroutine();
+    #endif
+
+    /**
+     * @brief Sets the behaviour of log calls if the log buffer is full.
+     *
+     * The default policy is @ref OVERFLOW_DROP_NEWEST.
+     *
+     * @param policy The overflow policy to use.
+     */
+    void setOverflowPolicy(OverflowPolicy policy);
+
+    /**
+     * @brief Gets the number of records which were dropped because the log buffer was full.
+     *
+     * @return Returns the total number of dropped records since startup.
+     */
+    uint32_t droppedRecords();
+
+    /**
+     * @internal
+     * @brief Fills in the timestamp and the coroutine ID of a serialized record and
+     * copies it into the log buffer.
+     *
+     * @param record Pointer to the record words.
+     * @param length Length of the record in words.
+     */
+    void __commit(uint32_t* record, size_t length);
+
+    //! Number of words used for storing an address (call site or field key) in a record
+    constexpr size_t __pointerWords = (sizeof(const LogSite*) + sizeof(uint32_t) - 1) / sizeof(uint32_t);
+
+    //! Number of words of the record header (call site, timestamp and coroutine ID)
+    constexpr size_t __headerWords = __pointerWords + 2;
+
+    //! Maximum number of words used for storing a string argument
+    constexpr size_t __maxStringWords = 1 + (LIBEMBED_CONFIG_DEBUG_MAX_STRING_LENGTH + sizeof(uint32_t) - 1) / sizeof(uint32_t);
+
+    //! Maximum length of a single record in words
+    constexpr size_t __maxRecordWords = 32;
+
+    //! @internal Checks whether @p T is a @ref Field.
+    template<typename T>
+    struct __isField : std::false_type {};
+
+    template<typename T>
+    struct __isField<Field<T>> : std::true_type {};
+
+    /**
+     * @internal
+     * @brief Gets the @ref ArgumentType used for storing an argument of type @p T.
+     *
+     * @tparam T The decayed argument type.
+     */
+    template<typename T>
+    constexpr uint8_t __argumentType() {
+        if constexpr(__isField<T>::value) return ARG_FIELD | __argumentType<std::decay_t<decltype(T::value)>>();
+        else if constexpr(std::is_same_v<T, bool>) return ARG_BOOL;
+        else if constexpr(std::is_same_v<T, char>) return ARG_CHAR;
+        else if constexpr(std::is_same_v<T, const char*> || std::is_same_v<T, char*> || std::is_same_v<T, std::string>) return ARG_STRING;
+        else if constexpr(std::is_enum_v<T>) return __argumentType<std::underlying_type_t<T>>();
+        else if constexpr(std::is_integral_v<T> && sizeof(T) <= sizeof(uint32_t)) return std::is_signed_v<T> ? ARG_SIGNED : ARG_UNSIGNED;
+        else if constexpr(std::is_integral_v<T>) return std::is_signed_v<T> ? ARG_SIGNED64 : ARG_UNSIGNED64;
+        else if constexpr(std::is_same_v<T, float>) return ARG_FLOAT;
+        else if constexpr(std::is_same_v<T, double>) return ARG_DOUBLE;
+        else if constexpr(std::is_pointer_v<T>) return ARG_POINTER;
+        else {
+            static_assert(sizeof(T) == 0, "This argument type is not supported by the debug log.");
+            return ARG_END;
+        }
+    }
+
+    /**
+     * @internal
+     * @brief Compile-time list of the argument types of a log call.
+     *
+     * @tparam T The decayed argument types.
+     */
+    template<typename... T>
+    struct ArgumentTypeList {
+        //! @ref ARG_END terminated list of the argument types
+        static constexpr uint8_t types[] = { __argumentType<T>()..., ARG_END };
+    };
+
+    /**
+     * @internal
+     * @brief Helper for deducing the @ref ArgumentTypeList of a log call. Only used in
+     * unevaluated contexts, so the arguments are never evaluated twice.
+     */
+    template<typename... T>
+    ArgumentTypeList<std::decay_t<T>...> __argumentTypeList(const T&... args);
+
+    /**
+     * @internal
+     * @brief Gets the maximum number of words an argument of type @p T uses in a record.
+     */
+    template<typename T>
+    constexpr size_t __argumentWords() {
+        constexpr uint8_t type = __argumentType<std::decay_t<T>>();
+        if constexpr(type & ARG_FIELD) return __pointerWords + __argumentWords<decltype(T::value)>();
+        else if constexpr(type == ARG_STRING) return __maxStringWords;
+        else if constexpr(type == ARG_UNSIGNED64 || type == ARG_SIGNED64 || type == ARG_DOUBLE) return 2;
+        else return 1;
+    }
+
+    /**
+     * @internal
+     * @brief Serializes a string argument into a record.
+     *
+     * @param pos Write position in the record. Advanced past the argument.
+     * @param data Pointer to the characters.
+     * @param length Number of characters.
+     */
+    inline void __serializeString(uint32_t*& pos, const char* data, size_t length) {
+        if(length > LIBEMBED_CONFIG_DEBUG_MAX_STRING_LENGTH) length = LIBEMBED_CONFIG_DEBUG_MAX_STRING_LENGTH;
+        size_t words = (length + sizeof(uint32_t) - 1) / sizeof(uint32_t);
+        *pos++ = length;
+        if(words) pos[words - 1] = 0; // Don't leak stack contents through the padding
+        memcpy(pos, data, length);
+        pos += words;
+    }
+
+    /**
+     * @internal
+     * @brief Serializes a single argument into a record.
+     *
+     * @param pos Write position in the record. Advanced past the argument.
+     * @param arg The argument to serialize.
+     */
+    template<typename T>
+    inline void __serialize(uint32_t*& pos, const T& arg) {
+        constexpr uint8_t type = __argumentType<std::decay_t<T>>();
+        if constexpr(type & ARG_FIELD) {
+            memcpy(pos, &arg.key, sizeof(arg.key));
+            pos += __pointerWords;
+            __serialize(pos, arg.value);
+        } else if constexpr(type == ARG_STRING) {
+            if constexpr(std::is_same_v<std::decay_t<T>, std::string>) {
+                __serializeString(pos, arg.data(), arg.length());
+            } else if constexpr(std::is_array_v<T>) {
+                __serializeString(pos, arg, strnlen(arg, LIBEMBED_CONFIG_DEBUG_MAX_STRING_LENGTH));
+            } else {
+                __serializeString(pos, arg, arg ? strnlen(arg, LIBEMBED_CONFIG_DEBUG_MAX_STRING_LENGTH) : 0);
+            }
+        } else if constexpr(type == ARG_POINTER) {
+            *pos++ = (uint32_t)(uintptr_t)arg;
+        } else if constexpr(type == ARG_FLOAT || type == ARG_DOUBLE) {
+            memcpy(pos, &arg, sizeof(arg));
+            pos += sizeof(arg) / sizeof(uint32_t);
+        } else if constexpr(type == ARG_UNSIGNED64 || type == ARG_SIGNED64) {
+            uint64_t value = (uint64_t)arg;
+            *pos++ = (uint32_t)value;
+            *pos++ = (uint32_t)(value >> 32);
+        } else if constexpr(type == ARG_SIGNED) {
+            *pos++ = (uint32_t)(int32_t)arg;
+        } else {
+            *pos++ = (uint32_t)arg;
+        }
+    }
+
+    /**
+     * @internal
+     * @brief Serializes a log record and writes it to the log buffer.
+     *
+     * Use @ref libembed_debug_info or @ref libembed_debug_trace instead of calling this directly.
+     *
+     * A record consists of the address of the @p site descriptor, the timestamp and the
+     * coroutine ID (both filled in by @ref __commit()), followed by the arguments as described
+     * by @ref ArgumentType. The record is built on the stack, so the log buffer is only
+     * touched once per call.
+     *
+     * @param site The call site descriptor.
+     * @param args The arguments of the log call.
+     */
+    template<typename... T>
+    inline void __log(const LogSite* site, const T&... args) {
+        constexpr size_t maxLength = __headerWords + (__argumentWords<T>() + ... + 0);
+        static_assert(maxLength <= __maxRecordWords, "Too many arguments for a single log call.");
 
-    void info(std::string message, std::string functionName);
-    void trace(std::string message, std::string functionName);
+        uint32_t record[maxLength];
+        uint32_t* pos = record;
+        memcpy(pos, &site, sizeof(site));
+        pos += __headerWords;
+        (__serialize(pos, args), ...);
+        __commit(record, pos - record);
+    }
 };
 
 #else
 
 /**
- * @brief Prints a debug message with the level `INFO`.
- * 
- * @param message The message to print.
+ * @brief Logs a message with the level `INFO`.
+ *
+ * Only the call site, a timestamp and the raw argument values are recorded; the text is
+ * rendered when the log is emitted. Use `{}` as a placeholder for each argument and
+ * @ref embed::debug::field() for key/value fields.
+ *
+ * @param format The format string. Must be a string literal.
  */
-#define libembed_debug_info(message)
+#define libembed_debug_info(format, ...) do { } while(0)
 
 /**
- * @brief Prints a debug message with the level `TRACE`.
- * 
- * @param message The message to print.
+ * @brief Logs a message with the level `TRACE`.
+ *
+ * Only the call site, a timestamp and the raw argument values are recorded; the text is
+ * rendered when the log is emitted. Use `{}` as a placeholder for each argument and
+ * @ref embed::debug::field() for key/value fields.
+ *
+ * @param format The format string. Must be a string literal.
  */
-#define libembed_debug_trace(message)
+#define libembed_debug_trace(format, ...) do { } while(0)
 
 #endif /* LIBEMBED_CONFIG_ENABLE_DEBUGGING */
 
-#endif /* LIBEMBED_DEBUG_H_ */
\ No newline at end of file
+#endif /* LIBEMBED_DEBUG_H_ */
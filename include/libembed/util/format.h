@@ -0,0 +1,331 @@
+/**
+ * @file format.h
+ * @author Gabriel Heinzer
+ * @brief Type-safe text formatting without heap allocations.
+ *
+ * @ref embed::format::format_to() renders a format string with `{}` placeholders and optional
+ * Python-style format specifications (`[[fill]align][sign][#][0][width][.precision][type]`)
+ * directly into a byte sink, e.g.
+ * `format::format_to(board::UART_VCP, "x={} y={:04x}\r\n", x, y);`. The same renderer is used
+ * by the debug log (see @ref debug.h).
+ *
+ * The arguments are converted into an array of @ref embed::format::Argument values, so only
+ * a small wrapper is instantiated per call and the renderer itself is shared by all calls.
+ * Text is rendered into a small buffer on the stack (@ref LIBEMBED_CONFIG_FORMAT_CHUNK_SIZE)
+ * which is handed to the sink whenever it is full.
+ */
+
+#include <libembed/config.h>
+#include <string>
+#include <string_view>
+#include <string.h>
+#include <stdint.h>
+#include <stddef.h>
+#include <type_traits>
+
+#ifndef LIBEMBED_UTIL_FORMAT_H_
+#define LIBEMBED_UTIL_FORMAT_H_
+
+//! Type-safe text formatting
+namespace embed::format {
+    /**
+     * @brief Type of a formatting argument.
+     */
+    typedef enum {
+        //! Unsigned integer
+        TYPE_UNSIGNED,
+        //! Signed integer
+        TYPE_SIGNED,
+        //! Character
+        TYPE_CHAR,
+        //! Boolean, printed as `True` or `False`
+        TYPE_BOOL,
+        //! Pointer, printed in hexadecimal notation
+        TYPE_POINTER,
+        //! String with a known length
+        TYPE_STRING,
+        //! Floating point value
+        TYPE_FLOAT,
+        //! Binary fixed-point value, see @ref fixed()
+        TYPE_FIXED
+    } ArgumentType;
+
+    /**
+     * @brief Formatting argument with its type erased.
+     */
+    struct Argument {
+        //! Type of the argument
+        ArgumentType type;
+        //! Number of fractional bits of @ref TYPE_FIXED arguments
+        uint8_t fractionalBits;
+        union {
+            //! Value of integer, character, boolean, pointer and fixed-point arguments
+            uint64_t integer;
+            //! Value of floating point arguments
+            double real;
+            //! Characters of string arguments (not terminated)
+            const char* string;
+        };
+        //! Length of string arguments
+        size_t length;
+    };
+
+    /**
+     * @brief Binary fixed-point value, created using @ref fixed().
+     */
+    struct Fixed {
+        //! Raw value, i.e. the value multiplied by 2 ^ @ref fractionalBits
+        int64_t raw;
+        //! Number of fractional bits
+        uint8_t fractionalBits;
+    };
+
+    /**
+     * @brief Formats a binary fixed-point value without using floating point arithmetic.
+     *
+     * E.g. `fixed(value, 16)` for a Q15.16 value. Like floating point values, the value is
+     * printed with up to six decimals unless the format specification contains a precision.
+     *
+     * @param raw The raw value, i.e. the value multiplied by 2 ^ @p fractionalBits.
+     * @param fractionalBits The number of fractional bits (at most 32).
+     */
+    constexpr Fixed fixed(int64_t raw, uint8_t fractionalBits) { return { raw, fractionalBits }; }
+
+    /**
+     * @brief Parsed Python-style format specification (`[[fill]align][sign][#][0][width][.precision][type]`).
+     */
+    struct Spec {
+        //! Fill character
+        char fill = ' ';
+        //! `<`, `>`, `^` or 0 for the default alignment of the argument type
+        char align = 0;
+        //! `+`, ` ` or 0 for only showing the sign of negative numbers
+        char sign = 0;
+        //! Specifies if the base prefix (e.g. `0x`) is shown
+        bool alternate = false;
+        //! Specifies if numbers are padded with zeros
+        bool zeroPad = false;
+        //! Minimum width of the field
+        size_t width = 0;
+        //! Precision, or -1 if not specified
+        int precision = -1;
+        //! Presentation type, or 0 if not specified
+        char type = 0;
+    };
+
+    /**
+     * @brief Output the formatted text is written to.
+     *
+     * Characters are collected in a buffer. If a flush function is set, the buffer is handed to
+     * it whenever it is full. Otherwise, characters not fitting into the buffer are discarded.
+     */
+    class Output {
+        public:
+            /**
+             * @brief Function receiving the rendered text.
+             *
+             * @param context The context passed to the constructor.
+             * @param data Pointer to the characters.
+             * @param length The number of characters.
+             */
+            typedef void (*FlushFunction)(void* context, const char* data, size_t length);
+
+        private:
+            //! Buffer the characters are collected in
+            char* buffer_;
+            //! Size of the buffer
+            size_t size_;
+            //! Number of characters in the buffer
+            size_t used_ = 0;
+            //! Number of characters written in total
+            size_t total_ = 0;
+            //! Function the buffer is handed to, or `nullptr`
+            FlushFunction flush_;
+            //! Context passed to the flush function
+            void* context_;
+
+        public:
+            /**
+             * @brief Creates an output.
+             *
+             * @param buffer Buffer the characters are collected in.
+             * @param size Size of the buffer.
+             * @param flush Function the buffer is handed to whenever it is full, or `nullptr` for
+             * discarding the characters not fitting into the buffer.
+             * @param context Context passed to @p flush.
+             */
+            Output(char* buffer, size_t size, FlushFunction flush = nullptr, void* context = nullptr)
+                : buffer_(buffer), size_(size), flush_(flush), context_(context) { }
+
+            //! Writes a single character.
+            void put(char c) {
+                if(used_ == size_) flush();
+                if(used_ < size_) buffer_[used_++] = c;
+                total_++;
+            }
+
+            //! Writes @p length characters.
+            void put(const char* data, size_t length);
+
+            //! Writes a zero-terminated string.
+            void put(const char* string) { put(string, strlen(string)); }
+
+            //! Writes @p count copies of a character.
+            void repeat(char c, size_t count);
+
+            /**
+             * @brief Hands the buffered characters to the flush function. Does nothing if there is no
+             * flush function.
+             */
+            void flush();
+
+            /**
+             * @brief Gets the number of characters written, including discarded characters.
+             */
+            size_t length() const { return total_; }
+
+            /**
+             * @brief Gets the number of characters currently in the buffer.
+             */
+            size_t buffered() const { return used_; }
+    };
+
+    /**
+     * @internal
+     * @brief Converts a formatting argument into an @ref Argument.
+     */
+    template<typename T>
+    inline Argument __argument(const T& value) {
+        typedef std::decay_t<T> Type;
+        Argument argument = {};
+        if constexpr(std::is_same_v<Type, bool>) {
+            argument.type = TYPE_BOOL;
+            argument.integer = value;
+        } else if constexpr(std::is_same_v<Type, char>) {
+            argument.type = TYPE_CHAR;
+            argument.integer = (uint8_t)value;
+        } else if constexpr(std::is_array_v<T> && std::is_same_v<std::remove_cv_t<std::remove_extent_t<T>>, char>) {
+            // String literals can't be null
+            argument.type = TYPE_STRING;
+            argument.string = value;
+            argument.length = strlen(value);
+        } else if constexpr(std::is_same_v<Type, const char*> || std::is_same_v<Type, char*>) {
+            argument.type = TYPE_STRING;
+            argument.string = value ? value : "(null)";
+            argument.length = strlen(argument.string);
+        } else if constexpr(std::is_same_v<Type, std::string> || std::is_same_v<Type, std::string_view>) {
+            argument.type = TYPE_STRING;
+            argument.string = value.data();
+            argument.length = value.length();
+        } else if constexpr(std::is_same_v<Type, Fixed>) {
+            argument.type = TYPE_FIXED;
+            argument.integer = (uint64_t)value.raw;
+            argument.fractionalBits = value.fractionalBits;
+        } else if constexpr(std::is_enum_v<Type>) {
+            return __argument((std::underlying_type_t<Type>)value);
+        } else if constexpr(std::is_integral_v<Type>) {
+            argument.type = std::is_signed_v<Type> ? TYPE_SIGNED : TYPE_UNSIGNED;
+            argument.integer = std::is_signed_v<Type> ? (uint64_t)(int64_t)value : (uint64_t)value;
+        } else if constexpr(std::is_floating_point_v<Type>) {
+            argument.type = TYPE_FLOAT;
+            argument.real = value;
+        } else if constexpr(std::is_pointer_v<Type>) {
+            argument.type = TYPE_POINTER;
+            argument.integer = (uintptr_t)value;
+        } else {
+            static_assert(sizeof(T) == 0, "This argument type is not supported by the formatter.");
+        }
+        return argument;
+    }
+
+    /**
+     * @internal
+     * @brief Parses a replacement field of a format string.
+     *
+     * @param format Pointer to the character following the opening brace.
+     * @param spec The parsed format specification.
+     * @return Returns a pointer to the character following the closing brace, or `nullptr`
+     * if the replacement field is malformed.
+     */
+    const char* __parseSpec(const char* format, Spec& spec);
+
+    /**
+     * @internal
+     * @brief Renders a single argument according to its format specification.
+     */
+    void __formatArgument(Output& output, const Argument& argument, const Spec& spec);
+
+    /**
+     * @internal
+     * @brief Renders a format string with type-erased arguments.
+     *
+     * Placeholders without a corresponding argument are rendered as `{?}`.
+     *
+     * @param output The output to write to.
+     * @param format The format string.
+     * @param arguments The arguments.
+     * @param count The number of arguments.
+     */
+    void __vformat(Output& output, const char* format, const Argument* arguments, size_t count);
+
+    /**
+     * @brief Renders a format string into an @ref Output.
+     *
+     * @param output The output to write to.
+     * @param format The format string.
+     * @param args The arguments.
+     * @return Returns the number of characters rendered.
+     */
+    template<typename... T>
+    size_t format_to(Output& output, const char* format, const T&... args) {
+        // One more element than required, so the array is never empty
+        const Argument arguments[] = { __argument(args)..., Argument() };
+        size_t start = output.length();
+        __vformat(output, format, arguments, sizeof...(T));
+        return output.length() - start;
+    }
+
+    /**
+     * @brief Renders a format string into a character buffer, like `snprintf()`.
+     *
+     * The text is truncated if it doesn't fit into the buffer and always zero-terminated.
+     *
+     * @param buffer The buffer to write to.
+     * @param size The size of the buffer, including the terminating zero.
+     * @param format The format string.
+     * @param args The arguments.
+     * @return Returns the number of characters the complete text has, excluding the terminating zero.
+     */
+    template<typename... T>
+    size_t format_to(char* buffer, size_t size, const char* format, const T&... args) {
+        if(size == 0) return 0;
+        Output output(buffer, size - 1);
+        format_to(output, format, args...);
+        buffer[output.buffered()] = '\0';
+        return output.length();
+    }
+
+    /**
+     * @brief Renders a format string into a byte sink, e.g. a UART.
+     *
+     * The text is rendered in chunks of @ref LIBEMBED_CONFIG_FORMAT_CHUNK_SIZE characters which
+     * are passed to the `write(const uint8_t* data, size_t length)` member function of the sink.
+     *
+     * @param sink The sink to write to.
+     * @param format The format string.
+     * @param args The arguments.
+     * @return Returns the number of characters rendered.
+     */
+    template<typename Sink, typename... T>
+    size_t format_to(Sink& sink, const char* format, const T&... args) {
+        char buffer[LIBEMBED_CONFIG_FORMAT_CHUNK_SIZE];
+        Output output(buffer, sizeof(buffer), [](void* context, const char* data, size_t length) {
+            ((Sink*)context)->write((const uint8_t*)data, length);
+        }, &sink);
+        format_to(output, format, args...);
+        output.flush();
+        return output.length();
+    }
+}
+
+#endif /* LIBEMBED_UTIL_FORMAT_H_ */
@@ -0,0 +1,206 @@
+/**
+ * @file ringbuffer.h
+ * @author Gabriel Heinzer
+ * @brief Lock-free single-producer, single-consumer ring buffer.
+ */
+
+#include <stdint.h>
+#include <stddef.h>
+
+#ifndef LIBEMBED_UTIL_RINGBUFFER_H_
+#define LIBEMBED_UTIL_RINGBUFFER_H_
+
+namespace embed::util {
+    /**
+     * @brief Fixed-size ring buffer for exactly one producer and one consumer.
+     *
+     * The producer only modifies the head index and the consumer only modifies
+     * the tail index, so the producer and the consumer may run in different contexts
+     * (e.g. a coroutine and an interrupt handler) without any additional locking.
+     *
+     * The indices are free-running and are only wrapped when accessing the storage,
+     * which is why @p size must be a power of two.
+     *
+     * @tparam T The type of the elements stored in the buffer.
+     * @tparam size The number of elements the buffer can hold. Must be a power of two.
+     */
+    template<typename T, size_t size>
+    class RingBuffer {
+        static_assert(size != 0 && (size & (size - 1)) == 0, "The ring buffer size must be a power of two.");
+
+        protected:
+            //! Internal storage of the buffer
+            T buffer_[size];
+            //! Index of the next element to write (only modified by the producer)
+            volatile size_t head_ = 0;
+            //! Index of the next element to read (only modified by the consumer)
+            volatile size_t tail_ = 0;
+
+        public:
+            /**
+             * @brief Gets the total number of elements the buffer can hold.
+             *
+             * @return Returns the capacity of the buffer.
+             */
+            static constexpr size_t capacity() { return size; }
+
+            /**
+             * @brief Gets the number of elements which can currently be read.
+             *
+             * @return Returns the number of elements stored in the buffer.
+             */
+            size_t available() const { return head_ - tail_; }
+
+            /**
+             * @brief Gets the number of elements which can currently be written.
+             *
+             * @return Returns the number of free elements in the buffer.
+             */
+            size_t free() const { return size - available(); }
+
+            //! Returns `true` if the buffer does not contain any elements.
+            bool empty() const { return head_ == tail_; }
+
+            //! Returns `true` if no further elements can be written to the buffer.
+            bool full() const { return available() == size; }
+
+            /**
+             * @brief Writes a single element to the buffer.
+             *
+             * @param element The element to write.
+             * @return Returns `false` if the buffer was full and the element was discarded.
+             */
+            bool push(const T& element) {
+                size_t head = head_;
+                if(head - tail_ == size) return false;
+                buffer_[head & (size - 1)] = element;
+                head_ = head + 1;
+                return true;
+            }
+
+            /**
+             * @brief Reads a single element from the buffer.
+             *
+             * @param element Reference to the variable the element is stored to.
+             * @return Returns `false` if the buffer was empty.
+             */
+            bool pop(T& element) {
+                size_t tail = tail_;
+                if(head_ == tail) return false;
+                element = buffer_[tail & (size - 1)];
+                tail_ = tail + 1;
+                return true;
+            }
+
+            /**
+             * @brief Gets an element without removing it from the buffer.
+             *
+             * @param offset Offset of the element relative to the oldest element. Must be
+             * lower than @ref available().
+             * @return Returns a reference to the element.
+             */
+            const T& peek(size_t offset = 0) const {
+                return buffer_[(tail_ + offset) & (size - 1)];
+            }
+
+            /**
+             * @brief Writes as many elements as possible to the buffer.
+             *
+             * @param data Pointer to the elements to write.
+             * @param length The number of elements to write.
+             * @return Returns the number of elements actually written.
+             */
+            size_t write(const T* data, size_t length) {
+                size_t head = head_;
+                size_t count = size - (head - tail_);
+                if(length < count) count = length;
+                for(size_t i = 0; i < count; i++) {
+                    buffer_[(head + i) & (size - 1)] = data[i];
+                }
+                head_ = head + count;
+                return count;
+            }
+
+            /**
+             * @brief Reads as many elements as possible from the buffer.
+             *
+             * @param data Pointer to the memory the elements are copied to.
+             * @param length The maximum number of elements to read.
+             * @return Returns the number of elements actually read.
+             */
+            size_t read(T* data, size_t length) {
+                size_t tail = tail_;
+                size_t count = head_ - tail;
+                if(length < count) count = length;
+                for(size_t i = 0; i < count; i++) {
+                    data[i] = buffer_[(tail + i) & (size - 1)];
+                }
+                tail_ = tail + count;
+                return count;
+            }
+
+            /**
+             * @brief Gets the longest block of readable elements which is contiguous in memory.
+             *
+             * This is useful for handing the buffer contents to a DMA or any other bulk consumer
+             * without copying. Call @ref consume() once the elements have been processed.
+             *
+             * @param length Set to the number of contiguous elements available at the returned pointer.
+             * @return Returns a pointer to the oldest element in the buffer.
+             */
+            const T* readPointer(size_t& length) const {
+                size_t tail = tail_;
+                size_t index = tail & (size - 1);
+                length = head_ - tail;
+                if(length > size - index) length = size - index;
+                return &buffer_[index];
+            }
+
+            /**
+             * @brief Removes elements from the buffer without reading them.
+             *
+             * @param length The number of elements to remove. Must not exceed @ref available().
+             */
+            void consume(size_t length) { tail_ = tail_ + length; }
+
+            /**
+             * @brief Gets the internal storage of the buffer.
+             *
+             * This allows a producer which can't call @ref write(), e.g. a DMA in circular mode,
+             * to write to the buffer directly. Call @ref produce() once elements have been written.
+             *
+             * @return Returns a pointer to the @ref capacity() elements of the buffer.
+             */
+            T* storage() { return buffer_; }
+
+            /**
+             * @brief Adds elements which have been written to the storage directly.
+             *
+             * @param length The number of elements written after the newest element, wrapping
+             * around at the end of the storage.
+             *
+             * @note This modifies the head index, so it must only be called by the producer.
+             */
+            void produce(size_t length) { head_ = head_ + length; }
+
+            /**
+             * @brief Removes all elements from the buffer.
+             *
+             * @note This modifies the tail index, so it must only be called by the consumer.
+             */
+            void clear() { tail_ = head_; }
+
+            /**
+             * @brief Removes all elements and moves both indices to the beginning of the storage.
+             *
+             * @note This modifies both indices, so neither the producer nor the consumer may
+             * access the buffer concurrently.
+             */
+            void reset() {
+                head_ = 0;
+                tail_ = 0;
+            }
+    };
+}
+
+#endif /* LIBEMBED_UTIL_RINGBUFFER_H_ */
@@ -0,0 +1,307 @@
+#!/usr/bin/env python3
+"""Decoder for the deferred binary debug log of libembed (see libembed/util/debug.h).
+
+In the binary output mode (embed::debug::OUTPUT_BINARY), the device only emits the address of
+the constant call site descriptor, a timestamp and the current coroutine ID followed by the raw
+argument values. This script looks the descriptors, format strings, function names and field
+keys up in the firmware ELF file and prints the reconstructed messages.
+
+Usage:
+    libembed_decode_log.py firmware.elf [input] [--baudrate 115200] [--timestamp-frequency HZ]
+
+`input` can be a file containing the captured log, a serial port (requires pyserial) or
+omitted to read from stdin.
+"""
+
+import argparse
+import os
+import struct
+import sys
+
+# Argument type tags, see embed::debug::ArgumentType
+ARG_END = 0
+ARG_UNSIGNED = 1
+ARG_SIGNED = 2
+ARG_UNSIGNED64 = 3
+ARG_SIGNED64 = 4
+ARG_CHAR = 5
+ARG_BOOL = 6
+ARG_POINTER = 7
+ARG_STRING = 8
+ARG_FLOAT = 9
+ARG_DOUBLE = 10
+ARG_FIELD = 0x80
+
+LEVEL_NAMES = {0: "INFO", 1: "TRACE"}
+
+# See embed::debug::Module
+MODULE_NAMES = {0: "user", 1: "debug", 2: "coroutines", 3: "exceptions", 4: "bsp", 5: "uart", 6: "i2c"}
+
+PT_LOAD = 1
+
+
+class ElfImage:
+    """Read-only view of the loadable segments of a little-endian ELF file."""
+
+    def __init__(self, path):
+        with open(path, "rb") as file:
+            data = file.read()
+
+        if data[:4] != b"\x7fELF":
+            raise ValueError(f"{path} is not an ELF file")
+        if data[5] != 1:
+            raise ValueError("Only little-endian ELF files are supported")
+
+        self.is64 = data[4] == 2
+        self.pointer_size = 8 if self.is64 else 4
+
+        if self.is64:
+            phoff, = struct.unpack_from("<Q", data, 0x20)
+            phentsize, phnum = struct.unpack_from("<HH", data, 0x36)
+        else:
+            phoff, = struct.unpack_from("<I", data, 0x1C)
+            phentsize, phnum = struct.unpack_from("<HH", data, 0x2A)
+
+        self.segments = []
+        for index in range(phnum):
+            offset = phoff + index * phentsize
+            if self.is64:
+                p_type, _, p_offset, p_vaddr, _, p_filesz = struct.unpack_from("<IIQQQQ", data, offset)
+            else:
+                p_type, p_offset, p_vaddr, _, p_filesz = struct.unpack_from("<IIIII", data, offset)
+            if p_type == PT_LOAD and p_filesz > 0:
+                self.segments.append((p_vaddr, data[p_offset:p_offset + p_filesz]))
+
+    def read(self, address, length):
+        for start, content in self.segments:
+            if start <= address and address + length <= start + len(content):
+                return content[address - start:address - start + length]
+        return None
+
+    def read_pointer(self, address):
+        raw = self.read(address, self.pointer_size)
+        if raw is None:
+            return None
+        return struct.unpack("<Q" if self.is64 else "<I", raw)[0]
+
+    def read_bytes(self, address, limit=512):
+        """Reads a zero-terminated byte string."""
+        for start, content in self.segments:
+            if start <= address < start + len(content):
+                offset = address - start
+                end = content.find(b"\0", offset, offset + limit)
+                if end < 0:
+                    return None
+                return content[offset:end]
+        return None
+
+    def read_string(self, address, limit=512):
+        raw = self.read_bytes(address, limit)
+        return None if raw is None else raw.decode("utf-8", errors="replace")
+
+
+class LogSite:
+    """Decoded embed::debug::LogSite descriptor."""
+
+    def __init__(self, format, function, argument_types, level, module):
+        self.format = format
+        self.function = function
+        self.argument_types = argument_types
+        self.level = level
+        self.module = module
+
+
+class Pointer(int):
+    """Integer which is printed in hexadecimal notation by default."""
+
+    def __format__(self, spec):
+        return format(int(self), spec) if spec else f"0x{int(self):08x}"
+
+
+class Decoder:
+    """Incremental decoder turning the raw log stream into messages."""
+
+    def __init__(self, elf, function_width=20, timestamp_frequency=None):
+        self.elf = elf
+        self.function_width = function_width
+        self.timestamp_frequency = timestamp_frequency
+        self.site_size = elf.pointer_size
+        # Call site, timestamp and coroutine ID
+        self.header_size = self.site_size + 8
+        self.sites = {}
+        self.buffer = bytearray()
+        self.skipped = 0
+
+    def load_site(self, address):
+        if address in self.sites:
+            return self.sites[address]
+        if address % 4 != 0:
+            return None
+
+        pointer_size = self.elf.pointer_size
+        format_ptr = self.elf.read_pointer(address)
+        function_ptr = self.elf.read_pointer(address + pointer_size)
+        types_ptr = self.elf.read_pointer(address + 2 * pointer_size)
+        level_module = self.elf.read(address + 3 * pointer_size, 2)
+        if None in (format_ptr, function_ptr, types_ptr, level_module):
+            return None
+        level, module = level_module
+        if level not in LEVEL_NAMES or module not in MODULE_NAMES:
+            return None
+
+        format = self.elf.read_string(format_ptr)
+        function = self.elf.read_string(function_ptr)
+        types = self.elf.read_bytes(types_ptr, limit=64)
+        if format is None or function is None or types is None:
+            return None
+        argument_types = list(types)
+        if any(t & ~ARG_FIELD > ARG_DOUBLE for t in argument_types):
+            return None
+
+        site = LogSite(format, function, argument_types, level, module)
+        self.sites[address] = site
+        return site
+
+    def parse_arguments(self, site, data, offset):
+        """Parses the arguments of a record.
+
+        Returns (arguments, fields, end offset) or None if the record is incomplete. Fields are
+        returned as (key, value) tuples and are not part of the positional arguments.
+        """
+        arguments = []
+        fields = []
+        for type in site.argument_types:
+            key = None
+            if type & ARG_FIELD:
+                if offset + self.site_size > len(data):
+                    return None
+                key_ptr = int.from_bytes(data[offset:offset + self.site_size], "little")
+                key = self.elf.read_string(key_ptr) or f"<0x{key_ptr:x}>"
+                offset += self.site_size
+                type &= ~ARG_FIELD
+                # Parse the value as the only argument of the field
+                value_site = LogSite("", "", [type], 0, 0)
+                result = self.parse_arguments(value_site, data, offset)
+                if result is None:
+                    return None
+                (value,), _, offset = result
+                fields.append((key, value))
+                continue
+
+            words = 2 if type in (ARG_UNSIGNED64, ARG_SIGNED64, ARG_DOUBLE) else 1
+            if offset + 4 * words > len(data):
+                return None
+            raw = bytes(data[offset:offset + 4 * words])
+            offset += 4 * words
+
+            if type == ARG_UNSIGNED:
+                arguments.append(struct.unpack("<I", raw)[0])
+            elif type == ARG_SIGNED:
+                arguments.append(struct.unpack("<i", raw)[0])
+            elif type == ARG_UNSIGNED64:
+                arguments.append(struct.unpack("<Q", raw)[0])
+            elif type == ARG_SIGNED64:
+                arguments.append(struct.unpack("<q", raw)[0])
+            elif type == ARG_CHAR:
+                arguments.append(chr(raw[0]))
+            elif type == ARG_BOOL:
+                arguments.append(raw[0] != 0)
+            elif type == ARG_POINTER:
+                arguments.append(Pointer(struct.unpack("<I", raw)[0]))
+            elif type == ARG_FLOAT:
+                arguments.append(struct.unpack("<f", raw)[0])
+            elif type == ARG_DOUBLE:
+                arguments.append(struct.unpack("<d", raw)[0])
+            elif type == ARG_STRING:
+                length = struct.unpack("<I", raw)[0]
+                padded = (length + 3) & ~3
+                if offset + padded > len(data):
+                    return None
+                arguments.append(bytes(data[offset:offset + length]).decode("utf-8", errors="replace"))
+                offset += padded
+        return arguments, fields, offset
+
+    def render(self, site, timestamp, coroutine, arguments, fields):
+        try:
+            message = site.format.format(*arguments)
+        except (IndexError, ValueError, KeyError):
+            message = f"{site.format} {arguments!r}"
+        message += "".join(f" {key}={value}" for key, value in fields)
+        if self.timestamp_frequency:
+            timestamp = f"{timestamp / self.timestamp_frequency:.6f}"
+        function = site.function + "()"
+        padding = " " * max(1, self.function_width + 2 - len(function))
+        return (f"[{LEVEL_NAMES[site.level]}]\t[{MODULE_NAMES[site.module]}]\t@{timestamp}\t#{coroutine}\t"
+                f"{function}{padding}{message}")
+
+    def feed(self, data):
+        """Adds raw bytes and yields all messages which could be decoded."""
+        self.buffer += data
+        while len(self.buffer) >= self.header_size:
+            address = int.from_bytes(self.buffer[:self.site_size], "little")
+            site = self.load_site(address)
+            if site is None:
+                # Not a call site; we are out of sync, so try again at the next byte
+                del self.buffer[0]
+                self.skipped += 1
+                continue
+
+            timestamp, coroutine = struct.unpack_from("<II", self.buffer, self.site_size)
+            result = self.parse_arguments(site, self.buffer, self.header_size)
+            if result is None:
+                break
+            arguments, fields, end = result
+            del self.buffer[:end]
+
+            if self.skipped:
+                yield f"<{self.skipped} bytes skipped while resynchronizing>"
+                self.skipped = 0
+            yield self.render(site, timestamp, coroutine, arguments, fields)
+
+
+def open_input(path, baudrate):
+    if path is None:
+        return sys.stdin.buffer
+    if os.path.isfile(path):
+        return open(path, "rb")
+    try:
+        import serial
+    except ImportError:
+        sys.exit("Reading from a serial port requires pyserial (pip install pyserial).")
+    return serial.Serial(path, baudrate, timeout=0.1)
+
+
+def main():
+    parser = argparse.ArgumentParser(description="Decodes the deferred binary debug log of libembed.")
+    parser.add_argument("elf", help="Firmware ELF file the log was produced by")
+    parser.add_argument("input", nargs="?", help="Log capture file or serial port (default: stdin)")
+    parser.add_argument("--baudrate", type=int, default=115200, help="Baudrate of the serial port")
+    parser.add_argument("--function-width", type=int, default=20,
+                        help="Column width of the function names (LIBEMBED_CONFIG_DEBUG_FUNCTION_NAME_MAXLEN)")
+    parser.add_argument("--timestamp-frequency", type=float,
+                        help="Frequency of the timestamps in Hz (embed::clock::getTimestampFrequency()) "
+                             "for printing them in seconds instead of ticks")
+    arguments = parser.parse_args()
+
+    decoder = Decoder(ElfImage(arguments.elf), arguments.function_width, arguments.timestamp_frequency)
+    stream = open_input(arguments.input, arguments.baudrate)
+    is_serial = hasattr(stream, "in_waiting")
+
+    try:
+        while True:
+            if is_serial:
+                data = stream.read(max(1, stream.in_waiting))
+                if not data:
+                    continue
+            else:
+                data = stream.read1(256) if hasattr(stream, "read1") else stream.read(256)
+                if not data:
+                    break
+            for line in decoder.feed(data):
+                print(line, flush=True)
+    except KeyboardInterrupt:
+        pass
+
+
+if __name__ == "__main__":
+    main()
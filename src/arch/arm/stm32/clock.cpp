@@ -9,6 +9,24 @@ using namespace embed;
 
 void clock::init() {
     HAL_Init();
+
+    #if defined(DWT)
+        // Enable the DWT cycle counter used for timestamps
+        CoreDebug->DEMCR |= CoreDebug_DEMCR_TRCENA_Msk;
+        DWT->CYCCNT = 0;
+        DWT->CTRL |= DWT_CTRL_CYCCNTENA_Msk;
+    #else
+        // No cycle counter available (Cortex-M0+), so TIM2 is used as a free-running
+        // 32-bit microsecond counter. The timer clock is doubled if the APB prescaler is not 1.
+        uint32_t timerClock = HAL_RCC_GetPCLK1Freq();
+        if(RCC->CFGR & RCC_CFGR_PPRE_2) timerClock *= 2;
+
+        __HAL_RCC_TIM2_CLK_ENABLE();
+        TIM2->PSC = timerClock / 1000000 - 1;
+        TIM2->ARR = 0xFFFFFFFF;
+        TIM2->EGR = TIM_EGR_UG; // Load the prescaler
+        TIM2->CR1 = TIM_CR1_CEN;
+    #endif
 }
 
 void clock::delay(unsigned int milliseconds) {
@@ -16,6 +34,22 @@ void clock::delay(unsigned int milliseconds) {
     while(HAL_GetTick() < endTick) yield;
 }
 
+uint32_t clock::getTimestamp() {
+    #if defined(DWT)
+        return DWT->CYCCNT;
+    #else
+        return TIM2->CNT;
+    #endif
+}
+
+uint32_t clock::getTimestampFrequency() {
+    #if defined(DWT)
+        return SystemCoreClock;
+    #else
+        return 1000000;
+    #endif
+}
+
 extern "C" void SysTick_Handler() { HAL_IncTick(); }
 
 #endif
\ No newline at end of file
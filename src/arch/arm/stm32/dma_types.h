@@ -0,0 +1,37 @@
+#include <libembed/arch/arm/stm32/stm32_hal.h>
+
+#ifndef LIBEMBED_ARCH_ARM_STM32_DMA_TYPES_H_
+#define LIBEMBED_ARCH_ARM_STM32_DMA_TYPES_H_
+
+namespace embed::arch::arm::stm32::dma {
+    //! DMA stream (STM32F4) or channel (STM32G0) together with the peripheral request it serves
+    struct __DMA_Request {
+        //! Stream or channel registers
+        decltype(DMA_HandleTypeDef::Instance) instance;
+        //! Channel selection (STM32F4) or DMAMUX request (STM32G0)
+        uint32_t request;
+    };
+
+    /**
+     * @brief Claims a DMA stream, initializes it and enables its interrupt.
+     *
+     * The transfer parameters in `handle.Init` must be set before calling this; the
+     * instance and the request are set from @p request. The interrupt handler of the stream is
+     * installed with @ref nvic::__nvic_set_handler(), and dispatches to `HAL_DMA_IRQHandler()`
+     * with @p handle until it is released.
+     *
+     * @param handle The HAL handle to use for the stream.
+     * @param request The stream and the request to use.
+     * @return Returns `false` if the stream is already claimed by another handle.
+     */
+    bool __dma_claim(DMA_HandleTypeDef& handle, const __DMA_Request& request);
+
+    /**
+     * @brief Aborts any transfer of a claimed DMA stream and releases it.
+     *
+     * @param handle The handle passed to @ref __dma_claim().
+     */
+    void __dma_release(DMA_HandleTypeDef& handle);
+}
+
+#endif /* LIBEMBED_ARCH_ARM_STM32_DMA_TYPES_H_ */
@@ -38,6 +38,32 @@ void embed::gpio::_GPIO_Pin_specific::setAnalog() {
     HAL_GPIO_Init(port, &initStruct);
 }
 
+void embed::gpio::_GPIO_Pin_specific::setOutput(bool state) {
+    __enable_clocks();
+    port->BSRR = state ? pin : pin << 16;
+
+    GPIO_InitTypeDef initStruct;
+    initStruct.Pin = pin;
+    initStruct.Mode = GPIO_MODE_OUTPUT_PP;
+    initStruct.Speed = GPIO_SPEED_FREQ_VERY_HIGH;
+    initStruct.Pull = GPIO_NOPULL;
+
+    HAL_GPIO_Init(port, &initStruct);
+}
+
+void embed::gpio::_GPIO_Pin_specific::setOpenDrain(bool state) {
+    __enable_clocks();
+    port->BSRR = state ? pin : pin << 16;
+
+    GPIO_InitTypeDef initStruct;
+    initStruct.Pin = pin;
+    initStruct.Mode = GPIO_MODE_OUTPUT_OD;
+    initStruct.Speed = GPIO_SPEED_FREQ_VERY_HIGH;
+    initStruct.Pull = GPIO_PULLUP;
+
+    HAL_GPIO_Init(port, &initStruct);
+}
+
 // *** gpio::DigitalOutput ***
 void gpio::DigitalOutput::init_specific_() {
     __enable_clocks();
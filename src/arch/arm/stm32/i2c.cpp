@@ -0,0 +1,251 @@
+#include <libembed/arch/arm/stm32/i2c.h>
+#include <libembed/arch/arm/stm32/gpio.h>
+#include <libembed/arch/arm/stm32/stm32_hal.h>
+#include <libembed/util/exceptions.h>
+#include <libembed/util/coroutines.h>
+#include <libembed/hal/clock/types.h>
+
+#if LIBEMBED_PLATFORM == ststm32
+
+using namespace embed::arch::arm::stm32;
+
+// The pins are open-drain outputs: setting them releases the line, which is then pulled high
+static inline void releaseLine_(const gpio::GPIO_Pin& pin) { pin.port->BSRR = pin.pin; }
+static inline void pullLine_(const gpio::GPIO_Pin& pin) { pin.port->BSRR = pin.pin << 16; }
+static inline bool readLine_(const gpio::GPIO_Pin& pin) { return pin.port->IDR & pin.pin; }
+
+//! Converts a duration in nanoseconds to timestamp ticks, rounded up.
+static uint32_t ticks_(uint32_t nanoseconds, uint32_t frequency) {
+    return (uint32_t)(((uint64_t)nanoseconds * frequency + 999999999) / 1000000000);
+}
+
+// *** i2c::SoftwareI2C_Master ***
+
+void i2c::SoftwareI2C_Master::begin(ClockFrequency freq) {
+    if(freq == 0 || freq > 400000) {
+        exceptions::throw_exception(exceptions::unsupported_on_this_device("Unsupported I2C clock frequency."));
+    }
+
+    scl_.setOpenDrain(true);
+    sda_.setOpenDrain(true);
+
+    // Fast mode requires a low phase of at least 1.3 us, so it uses a duty cycle of 2:1
+    uint32_t periodNs = 1000000000 / freq;
+    uint32_t lowNs = freq > 100000 ? periodNs * 2 / 3 : periodNs / 2;
+
+    // A wait may end up to a tick early, which matters for coarse timestamps only
+    uint32_t frequency = clock::getTimestampFrequency();
+    uint32_t extra = frequency < 10000000 ? 1 : 0;
+    lowTicks_ = ticks_(lowNs, frequency) + extra;
+    highTicks_ = ticks_(periodNs - lowNs, frequency) + extra;
+    slackTicks_ = frequency / 10000000;
+
+    // A slave holding the data line low is still sending a byte, which is clocked out
+    startTick_ = HAL_GetTick();
+    timeout_ = LIBEMBED_CONFIG_I2C_DEFAULT_TIMEOUT;
+    if(!readLine_(sda_)) {
+        for(int i = 0; i < 9 && !readLine_(sda_); i++) {
+            pullLine_(scl_);
+            wait_(lowTicks_);
+            if(releaseClock_() != RESULT_OK) break;
+            wait_(highTicks_);
+        }
+        pullLine_(scl_);
+        active_ = true;
+        stop_();
+    }
+}
+
+void i2c::SoftwareI2C_Master::wait_(uint32_t ticks) {
+    // If the edge has been delayed, e.g. by an interrupt or a slave stretching the clock, the
+    // phase is timed from when it actually started
+    uint32_t now = clock::getTimestamp();
+    if((int32_t)(now - edge_) > (int32_t)slackTicks_) edge_ = now;
+    edge_ += ticks;
+    while((int32_t)(clock::getTimestamp() - edge_) < 0);
+}
+
+i2c::TransactionResult i2c::SoftwareI2C_Master::releaseClock_() {
+    releaseLine_(scl_);
+
+    // Slaves may hold the clock low until they are ready
+    while(!readLine_(scl_)) {
+        if(HAL_GetTick() - startTick_ > timeout_) return RESULT_TIMEOUT;
+    }
+    return RESULT_OK;
+}
+
+i2c::TransactionResult i2c::SoftwareI2C_Master::transferBit_(bool& bit) {
+    if(bit) releaseLine_(sda_);
+    else pullLine_(sda_);
+    wait_(lowTicks_);
+
+    TransactionResult result = releaseClock_();
+    if(result != RESULT_OK) return result;
+    wait_(highTicks_);
+
+    // The data line is sampled at the end of the high phase
+    bit = readLine_(sda_);
+    pullLine_(scl_);
+    return RESULT_OK;
+}
+
+i2c::TransactionResult i2c::SoftwareI2C_Master::transferByte_(uint8_t& data, bool& nack, Direction direction) {
+    uint8_t received = 0;
+    for(int i = 7; i >= 0; i--) {
+        bool sent = data & (1 << i);
+        bool bit = sent;
+        TransactionResult result = transferBit_(bit);
+        if(result != RESULT_OK) return result;
+
+        // Another master pulling the data line low while it's released has won the arbitration
+        if(direction == WRITE && sent && !bit) return RESULT_ARBITRATION_LOST;
+        received = (received << 1) | bit;
+    }
+
+    data = received;
+    return transferBit_(nack);
+}
+
+i2c::TransactionResult i2c::SoftwareI2C_Master::start_(Address_7B address, Direction direction) {
+    if(active_) {
+        // A repeated start condition releases the data line while the clock is low first
+        releaseLine_(sda_);
+        wait_(lowTicks_);
+        TransactionResult result = releaseClock_();
+        if(result != RESULT_OK) return result;
+        wait_(highTicks_);
+    } else {
+        // Wait for other masters to release the bus
+        while(!readLine_(scl_) || !readLine_(sda_)) {
+            if(HAL_GetTick() - startTick_ > timeout_) return RESULT_TIMEOUT;
+            yield;
+        }
+    }
+
+    // The data line falls while the clock is high
+    if(!readLine_(sda_)) return RESULT_ARBITRATION_LOST;
+    pullLine_(sda_);
+    active_ = true;
+    wait_(highTicks_);
+    pullLine_(scl_);
+
+    uint8_t data = (address << 1) | direction;
+    bool nack = true;
+    TransactionResult result = transferByte_(data, nack, WRITE);
+    if(result != RESULT_OK) return result;
+    return nack ? RESULT_ADDRESS_NACK : RESULT_OK;
+}
+
+void i2c::SoftwareI2C_Master::stop_() {
+    if(!active_) return;
+
+    // The data line rises while the clock is high
+    pullLine_(sda_);
+    wait_(lowTicks_);
+    if(releaseClock_() != RESULT_OK) {
+        release_();
+        return;
+    }
+    wait_(highTicks_);
+    releaseLine_(sda_);
+    active_ = false;
+
+    // Bus free time before the next start condition
+    wait_(lowTicks_);
+}
+
+void i2c::SoftwareI2C_Master::release_() {
+    releaseLine_(sda_);
+    releaseLine_(scl_);
+    active_ = false;
+}
+
+i2c::AcknowledgementType i2c::SoftwareI2C_Master::startMessage(Address_7B address, Direction direction) {
+    lock_.acquire();
+    startTick_ = HAL_GetTick();
+    timeout_ = LIBEMBED_CONFIG_I2C_DEFAULT_TIMEOUT;
+
+    TransactionResult result = start_(address, direction);
+    if(result == RESULT_ARBITRATION_LOST || result == RESULT_TIMEOUT) release_();
+
+    lock_.release();
+    return result == RESULT_OK ? ACK : NACK;
+}
+
+void i2c::SoftwareI2C_Master::stopMessage() {
+    lock_.acquire();
+    stop_();
+    lock_.release();
+}
+
+i2c::AcknowledgementType i2c::SoftwareI2C_Master::sendByte(uint8_t data) {
+    lock_.acquire();
+    startTick_ = HAL_GetTick();
+
+    bool nack = true;
+    TransactionResult result = transferByte_(data, nack, WRITE);
+    if(result != RESULT_OK) release_();
+
+    lock_.release();
+    return result == RESULT_OK && !nack ? ACK : NACK;
+}
+
+uint8_t i2c::SoftwareI2C_Master::readByte(AcknowledgementType ackType) {
+    lock_.acquire();
+    startTick_ = HAL_GetTick();
+
+    uint8_t data = 0xFF;
+    bool nack = ackType == NACK;
+    if(transferByte_(data, nack, READ) != RESULT_OK) release_();
+
+    lock_.release();
+    return data;
+}
+
+i2c::TransactionResult i2c::SoftwareI2C_Master::write(Address_7B address, const uint8_t* data, size_t length, uint32_t timeout) {
+    return writeRead(address, data, length, nullptr, 0, timeout);
+}
+
+i2c::TransactionResult i2c::SoftwareI2C_Master::read(Address_7B address, uint8_t* data, size_t length, uint32_t timeout) {
+    return writeRead(address, nullptr, 0, data, length, timeout);
+}
+
+i2c::TransactionResult i2c::SoftwareI2C_Master::writeRead(Address_7B address, const uint8_t* txData, size_t txLength, uint8_t* rxData, size_t rxLength, uint32_t timeout) {
+    lock_.acquire();
+    startTick_ = HAL_GetTick();
+    timeout_ = timeout;
+    TransactionResult result = RESULT_OK;
+
+    // A read without a write phase starts with the read address right away
+    if(txLength > 0 || rxLength == 0) {
+        result = start_(address, WRITE);
+        for(size_t i = 0; i < txLength && result == RESULT_OK; i++) {
+            uint8_t data = txData[i];
+            bool nack = true;
+            result = transferByte_(data, nack, WRITE);
+            if(result == RESULT_OK && nack) result = RESULT_DATA_NACK;
+        }
+    }
+
+    if(result == RESULT_OK && rxLength > 0) {
+        result = start_(address, READ);
+        for(size_t i = 0; i < rxLength && result == RESULT_OK; i++) {
+            // The last byte is answered with a NACK
+            uint8_t data = 0xFF;
+            bool nack = i + 1 == rxLength;
+            result = transferByte_(data, nack, READ);
+            rxData[i] = data;
+        }
+    }
+
+    // After a lost arbitration, the bus belongs to the other master
+    if(result == RESULT_ARBITRATION_LOST || result == RESULT_TIMEOUT) release_();
+    else stop_();
+
+    countTransaction_(result, txLength + rxLength);
+    lock_.release();
+    return result;
+}
+
+#endif /* LIBEMBED_PLATFORM == ststm32 */
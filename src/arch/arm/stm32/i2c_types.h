@@ -1,8 +1,36 @@
 #include <libembed/arch/arm/stm32/stm32_hal.h>
 #include <libembed/hal/gpio.h>
+#include <libembed/util/coroutines.h>
+#include "dma_types.h"
+
+namespace embed::arch::arm::stm32::i2c {
+    /**
+     * @brief Handles the event interrupt of an I2C interface. Called by the handlers installed for the interfaces.
+     */
+    void __i2c_event_irq_handler(I2C_TypeDef* i2c);
+
+    /**
+     * @brief Handles the error interrupt of an I2C interface. Called by the handlers installed for the interfaces.
+     */
+    void __i2c_error_irq_handler(I2C_TypeDef* i2c);
+}
 
 namespace embed::i2c {
     struct __I2C_HardwareInterface {
         I2C_TypeDef* interface;
+        //! Lock of the bus, so transactions on different buses don't block each other
+        mutable coroutines::Lock lock;
+        //! Event interrupt of the interface
+        IRQn_Type eventIrq;
+        //! Error interrupt of the interface
+        IRQn_Type errorIrq;
+        //! Handler of the event interrupt, installed by `begin()`
+        void (*eventIrqHandler)();
+        //! Handler of the error interrupt, installed by `begin()`
+        void (*errorIrqHandler)();
+        //! DMA stream used for transmitting
+        embed::arch::arm::stm32::dma::__DMA_Request txDma;
+        //! DMA stream used for receiving
+        embed::arch::arm::stm32::dma::__DMA_Request rxDma;
     };
-}
\ No newline at end of file
+}
@@ -0,0 +1,38 @@
+#include <libembed/arch/arm/stm32/stm32_hal.h>
+#include <libembed/arch/ident.h>
+#include "nvic_types.h"
+
+#if STM32
+
+using namespace embed::arch::arm::stm32;
+
+// The table holds the 16 system exceptions followed by the interrupts. VTOR requires it to be
+// aligned to its size rounded up to a power of two.
+#if STM32F412xx
+    #define NVIC_VECTOR_COUNT (16 + 97)
+    #define NVIC_VECTOR_ALIGNMENT 512
+#elif STM32G031xx
+    #define NVIC_VECTOR_COUNT (16 + 32)
+    #define NVIC_VECTOR_ALIGNMENT 256
+#endif
+
+alignas(NVIC_VECTOR_ALIGNMENT) static void (*vectors_[NVIC_VECTOR_COUNT])();
+
+void nvic::__nvic_set_handler(IRQn_Type irq, void (*handler)()) {
+    uint32_t primask = __get_PRIMASK();
+    __disable_irq();
+
+    if(SCB->VTOR != (uint32_t)vectors_) {
+        // The boot table is usually at address 0, so it is copied through a volatile pointer
+        const volatile uint32_t* table = (const volatile uint32_t*)SCB->VTOR;
+        for(int i = 0; i < NVIC_VECTOR_COUNT; i++) vectors_[i] = (void (*)())table[i];
+        SCB->VTOR = (uint32_t)vectors_;
+    }
+    vectors_[16 + irq] = handler;
+    // The next exception must fetch the new vector
+    __DSB();
+
+    __set_PRIMASK(primask);
+}
+
+#endif
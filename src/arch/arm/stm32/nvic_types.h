@@ -0,0 +1,22 @@
+#include <libembed/arch/arm/stm32/stm32_hal.h>
+
+#ifndef LIBEMBED_ARCH_ARM_STM32_NVIC_TYPES_H_
+#define LIBEMBED_ARCH_ARM_STM32_NVIC_TYPES_H_
+
+namespace embed::arch::arm::stm32::nvic {
+    /**
+     * @brief Installs the handler of an interrupt at runtime.
+     *
+     * The library doesn't define any `IRQHandler()` functions for peripherals, so the application
+     * (or code generated by STM32CubeMX) can handle all interrupts the library doesn't use. Instead,
+     * the drivers install their handlers when they start using an interrupt. On the first call, the
+     * vector table is copied to RAM and `SCB->VTOR` is pointed at the copy; an application relocating
+     * the vector table itself must do so before starting any driver of the library.
+     *
+     * @param irq The interrupt to handle.
+     * @param handler The function to call for the interrupt.
+     */
+    void __nvic_set_handler(IRQn_Type irq, void (*handler)());
+}
+
+#endif /* LIBEMBED_ARCH_ARM_STM32_NVIC_TYPES_H_ */
@@ -0,0 +1,80 @@
+#include <libembed/arch/arm/stm32/stm32_hal.h>
+#include <libembed/arch/ident.h>
+#include "../dma_types.h"
+#include "../nvic_types.h"
+
+#if STM32F412xx
+
+using namespace embed::arch::arm::stm32;
+
+#define DMA_STREAM_COUNT 16
+
+static DMA_Stream_TypeDef* const streams_[DMA_STREAM_COUNT] = {
+    DMA1_Stream0, DMA1_Stream1, DMA1_Stream2, DMA1_Stream3, DMA1_Stream4, DMA1_Stream5, DMA1_Stream6, DMA1_Stream7,
+    DMA2_Stream0, DMA2_Stream1, DMA2_Stream2, DMA2_Stream3, DMA2_Stream4, DMA2_Stream5, DMA2_Stream6, DMA2_Stream7
+};
+
+static const IRQn_Type irqs_[DMA_STREAM_COUNT] = {
+    DMA1_Stream0_IRQn, DMA1_Stream1_IRQn, DMA1_Stream2_IRQn, DMA1_Stream3_IRQn,
+    DMA1_Stream4_IRQn, DMA1_Stream5_IRQn, DMA1_Stream6_IRQn, DMA1_Stream7_IRQn,
+    DMA2_Stream0_IRQn, DMA2_Stream1_IRQn, DMA2_Stream2_IRQn, DMA2_Stream3_IRQn,
+    DMA2_Stream4_IRQn, DMA2_Stream5_IRQn, DMA2_Stream6_IRQn, DMA2_Stream7_IRQn
+};
+
+// Handles of the claimed streams, used for dispatching the interrupts
+static DMA_HandleTypeDef* handles_[DMA_STREAM_COUNT];
+
+static void dispatch_(int index) {
+    if(handles_[index]) HAL_DMA_IRQHandler(handles_[index]);
+}
+
+template<int index>
+static void streamIrqHandler_() {
+    dispatch_(index);
+}
+
+// Installed when a stream is claimed, so the application can handle the streams the library doesn't use
+static void (* const irqHandlers_[DMA_STREAM_COUNT])() = {
+    streamIrqHandler_<0>, streamIrqHandler_<1>, streamIrqHandler_<2>, streamIrqHandler_<3>,
+    streamIrqHandler_<4>, streamIrqHandler_<5>, streamIrqHandler_<6>, streamIrqHandler_<7>,
+    streamIrqHandler_<8>, streamIrqHandler_<9>, streamIrqHandler_<10>, streamIrqHandler_<11>,
+    streamIrqHandler_<12>, streamIrqHandler_<13>, streamIrqHandler_<14>, streamIrqHandler_<15>
+};
+
+static int streamIndex_(DMA_Stream_TypeDef* stream) {
+    for(int i = 0; i < DMA_STREAM_COUNT; i++) {
+        if(streams_[i] == stream) return i;
+    }
+    return -1;
+}
+
+bool dma::__dma_claim(DMA_HandleTypeDef& handle, const __DMA_Request& request) {
+    int index = streamIndex_(request.instance);
+    if(index < 0 || (handles_[index] && handles_[index] != &handle)) return false;
+
+    __HAL_RCC_DMA1_CLK_ENABLE();
+    __HAL_RCC_DMA2_CLK_ENABLE();
+
+    handle.Instance = request.instance;
+    handle.Init.Channel = request.request;
+    handle.Init.FIFOMode = DMA_FIFOMODE_DISABLE;
+    if(HAL_DMA_Init(&handle) != HAL_OK) return false;
+
+    handles_[index] = &handle;
+    nvic::__nvic_set_handler(irqs_[index], irqHandlers_[index]);
+    HAL_NVIC_SetPriority(irqs_[index], 0, 0);
+    HAL_NVIC_EnableIRQ(irqs_[index]);
+    return true;
+}
+
+void dma::__dma_release(DMA_HandleTypeDef& handle) {
+    int index = streamIndex_(handle.Instance);
+    if(index < 0 || handles_[index] != &handle) return;
+
+    HAL_NVIC_DisableIRQ(irqs_[index]);
+    HAL_DMA_Abort(&handle);
+    HAL_DMA_DeInit(&handle);
+    handles_[index] = nullptr;
+}
+
+#endif /* STM32F412xx */
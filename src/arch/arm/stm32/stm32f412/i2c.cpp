@@ -1,20 +1,94 @@
 #include <libembed/hal/i2c/types.h>
 #include <libembed/util/coroutines.h>
+#include <libembed/util/exceptions.h>
 #include <libembed/arch/arch.h>
 #include <libembed/arch/arm/stm32/stm32_hal.h>
 #include <libembed/arch/ident.h>
 #include <libembed/arch/arm/stm32/i2c.h>
+#include <libembed/arch/arm/stm32/stm32f412/i2c_timing.h>
 #include "../i2c_types.h"
+#include "../nvic_types.h"
+#include <string.h>
 
 #if STM32F412xx
 
-using namespace embed::arch::stm32;
+using namespace embed::arch::arm::stm32;
+
+// Installed by begin(), so the application can handle the interfaces the library doesn't use
+static void i2c1EventIrqHandler_() { i2c::__i2c_event_irq_handler(I2C1); }
+static void i2c1ErrorIrqHandler_() { i2c::__i2c_error_irq_handler(I2C1); }
+static void i2c2EventIrqHandler_() { i2c::__i2c_event_irq_handler(I2C2); }
+static void i2c2ErrorIrqHandler_() { i2c::__i2c_error_irq_handler(I2C2); }
+static void i2c3EventIrqHandler_() { i2c::__i2c_event_irq_handler(I2C3); }
+static void i2c3ErrorIrqHandler_() { i2c::__i2c_error_irq_handler(I2C3); }
+
+// I2C1 and I2C2 share the transmit stream, I2C3 receives on the same stream as USART3. The interface
+// enabling its DMA later falls back to polling.
+i2c::I2C_HardwareInterface i2c::I2C_1 = {
+    .interface = I2C1,
+    .eventIrq = I2C1_EV_IRQn,
+    .errorIrq = I2C1_ER_IRQn,
+    .eventIrqHandler = i2c1EventIrqHandler_,
+    .errorIrqHandler = i2c1ErrorIrqHandler_,
+    .txDma = { DMA1_Stream7, DMA_CHANNEL_1 },
+    .rxDma = { DMA1_Stream0, DMA_CHANNEL_1 }
+};
+i2c::I2C_HardwareInterface i2c::I2C_2 = {
+    .interface = I2C2,
+    .eventIrq = I2C2_EV_IRQn,
+    .errorIrq = I2C2_ER_IRQn,
+    .eventIrqHandler = i2c2EventIrqHandler_,
+    .errorIrqHandler = i2c2ErrorIrqHandler_,
+    .txDma = { DMA1_Stream7, DMA_CHANNEL_7 },
+    .rxDma = { DMA1_Stream2, DMA_CHANNEL_7 }
+};
+i2c::I2C_HardwareInterface i2c::I2C_3 = {
+    .interface = I2C3,
+    .eventIrq = I2C3_EV_IRQn,
+    .errorIrq = I2C3_ER_IRQn,
+    .eventIrqHandler = i2c3EventIrqHandler_,
+    .errorIrqHandler = i2c3ErrorIrqHandler_,
+    .txDma = { DMA1_Stream4, DMA_CHANNEL_3 },
+    .rxDma = { DMA1_Stream1, DMA_CHANNEL_1 }
+};
+
+// Master running a transaction on I2C1 to I2C3, which handles the interrupts of the interface
+static i2c::HardwareI2C_Master* volatile active_[3];
 
-i2c::I2C_HardwareInterface i2c::I2C_1 = { .interface = I2C1 };
-i2c::I2C_HardwareInterface i2c::I2C_2 = { .interface = I2C2 };
-i2c::I2C_HardwareInterface i2c::I2C_3 = { .interface = I2C3 };
+// Slave using I2C1 to I2C3, which handles the interrupts instead of a master
+static i2c::HardwareI2C_Slave* volatile slaves_[3];
+
+static int interfaceIndex_(I2C_TypeDef* instance) {
+    return instance == I2C1 ? 0 : instance == I2C2 ? 1 : 2;
+}
+
+//! Claims a DMA stream for byte transfers from or to the data register of an interface.
+static bool claimDMA_(DMA_HandleTypeDef& handle, const dma::__DMA_Request& request, uint32_t direction, void* parent, void (*callback)(DMA_HandleTypeDef*)) {
+    handle.Init.Direction = direction;
+    handle.Init.PeriphInc = DMA_PINC_DISABLE;
+    handle.Init.MemInc = DMA_MINC_ENABLE;
+    handle.Init.PeriphDataAlignment = DMA_PDATAALIGN_BYTE;
+    handle.Init.MemDataAlignment = DMA_MDATAALIGN_BYTE;
+    handle.Init.Mode = DMA_NORMAL;
+    // Received data must be read before the next byte arrives
+    handle.Init.Priority = direction == DMA_PERIPH_TO_MEMORY ? DMA_PRIORITY_HIGH : DMA_PRIORITY_LOW;
+    if(!dma::__dma_claim(handle, request)) return false;
+
+    handle.Parent = parent;
+    handle.XferCpltCallback = callback;
+    handle.XferErrorCallback = callback;
+    return true;
+}
 
-static embed::coroutines::Lock i2cLock;
+//! Installs the handlers of the event and error interrupts of an interface and enables them.
+static void enableInterrupts_(const i2c::I2C_HardwareInterface& interface) {
+    nvic::__nvic_set_handler(interface.eventIrq, interface.eventIrqHandler);
+    nvic::__nvic_set_handler(interface.errorIrq, interface.errorIrqHandler);
+    HAL_NVIC_SetPriority(interface.eventIrq, 0, 0);
+    HAL_NVIC_EnableIRQ(interface.eventIrq);
+    HAL_NVIC_SetPriority(interface.errorIrq, 0, 0);
+    HAL_NVIC_EnableIRQ(interface.errorIrq);
+}
 
 static void i2c_enable_clocks_() {
     __HAL_RCC_I2C1_CLK_ENABLE();
@@ -22,28 +96,70 @@ static void i2c_enable_clocks_() {
     __HAL_RCC_I2C3_CLK_ENABLE();
 }
 
+// The clock register computation doesn't use the HAL definitions, so it can be checked on the host
+static_assert(stm32f412::i2c::CCR_FAST_MODE == I2C_CCR_FS && stm32f412::i2c::CCR_DUTY == I2C_CCR_DUTY
+    && stm32f412::i2c::CCR_CLOCK_CONTROL == I2C_CCR_CCR, "I2C clock register bits don't match the HAL");
+
 void i2c::HardwareI2C_Master::begin(i2c::ClockFrequency freq) {
     i2c_enable_clocks_();
+    I2C_TypeDef* i2c = interface.interface;
 
-    double fpclk1 = HAL_RCC_GetPCLK1Freq();
-    double ttarget = 1.0 / freq;
-    double tpclk1 = 1.0 / fpclk1;
-    double triseValue = (0.000001 / tpclk1) + 1.0;
-    double CCRval = ttarget / tpclk1;
-
-    // Set the clock rate and the IF to standard speed mode
-    interface.interface->CCR = CCRval;
-    interface.interface->TRISE = triseValue;
+    // The interface requires PCLK1 to be between 2 and 50 MHz
+    uint32_t pclk = HAL_RCC_GetPCLK1Freq();
+    uint32_t ccr = stm32f412::i2c::clockControl(pclk, freq);
+    if(pclk < 2000000 || pclk > 50000000 || ccr == 0) {
+        exceptions::throw_exception(exceptions::unsupported_on_this_device("Unsupported I2C clock frequency."));
+    }
 
-    // Configure the clock frequency the interface requires
-    interface.interface->CR2 = HAL_RCC_GetPCLK1Freq() / 1000000;
+    // CCR and TRISE can only be written while the interface is disabled
+    CLEAR_BIT(i2c->CR1, I2C_CR1_PE);
+    i2c->CR2 = pclk / 1000000;
+    i2c->CCR = ccr;
+    i2c->TRISE = stm32f412::i2c::riseTime(pclk, freq);
 
     // Enable the I2C peripheral
-    SET_BIT(interface.interface->CR1, I2C_CR1_PE);
+    SET_BIT(i2c->CR1, I2C_CR1_PE);
+
+    enableInterrupts_(interface);
+
+    setTxDMAEnabled(true);
+    setRxDMAEnabled(true);
 };
 
+bool i2c::HardwareI2C_Master::setTxDMAEnabled(bool enabled) {
+    if(enabled == txDmaEnabled_) return txDmaEnabled_;
+
+    if(!enabled) {
+        interface.lock.acquire();
+        dma::__dma_release(txDmaHandle_);
+        txDmaEnabled_ = false;
+        interface.lock.release();
+        return false;
+    }
+
+    if(!claimDMA_(txDmaHandle_, interface.txDma, DMA_MEMORY_TO_PERIPH, this, dmaTransferComplete_)) return false;
+    txDmaEnabled_ = true;
+    return true;
+}
+
+bool i2c::HardwareI2C_Master::setRxDMAEnabled(bool enabled) {
+    if(enabled == rxDmaEnabled_) return rxDmaEnabled_;
+
+    if(!enabled) {
+        interface.lock.acquire();
+        dma::__dma_release(rxDmaHandle_);
+        rxDmaEnabled_ = false;
+        interface.lock.release();
+        return false;
+    }
+
+    if(!claimDMA_(rxDmaHandle_, interface.rxDma, DMA_PERIPH_TO_MEMORY, this, dmaTransferComplete_)) return false;
+    rxDmaEnabled_ = true;
+    return true;
+}
+
 i2c::AcknowledgementType i2c::HardwareI2C_Master::startMessage(i2c::Address_7B address, i2c::Direction direction) {
-    i2cLock.acquire();
+    interface.lock.acquire();
 
     // Send a start condition
     SET_BIT(interface.interface->CR1, I2C_CR1_START);
@@ -74,24 +190,24 @@ i2c::AcknowledgementType i2c::HardwareI2C_Master::startMessage(i2c::Address_7B a
     dummy = interface.interface->SR1 | interface.interface->SR2;
     while(READ_BIT(interface.interface->SR1, I2C_SR1_ADDR)) { yield; }
 
-    i2cLock.release();
+    interface.lock.release();
 
     return ackType;
 };
 
 void i2c::HardwareI2C_Master::stopMessage() {
-    i2cLock.acquire();
+    interface.lock.acquire();
 
     SET_BIT(interface.interface->CR1, I2C_CR1_STOP);
 
     // Wait for the BUSY bit to be set to 0
-    while(READ_BIT(interface.interface->SR1, I2C_SR2_BUSY)) { yield; }
+    while(READ_BIT(interface.interface->SR2, I2C_SR2_BUSY)) { yield; }
 
-    i2cLock.release();
+    interface.lock.release();
 };
 
 i2c::AcknowledgementType i2c::HardwareI2C_Master::sendByte(uint8_t data) {
-    i2cLock.acquire();
+    interface.lock.acquire();
 
     // Wait for the transmitter to be ready
     while(!READ_BIT(interface.interface->SR1, I2C_SR1_TXE)) { yield; }
@@ -111,19 +227,460 @@ i2c::AcknowledgementType i2c::HardwareI2C_Master::sendByte(uint8_t data) {
         yield;
     }
 
-    i2cLock.release();
+    interface.lock.release();
 
     return ackType;
 };
 
 uint8_t i2c::HardwareI2C_Master::readByte(i2c::AcknowledgementType ackType) {
-    i2cLock.acquire();
+    interface.lock.acquire();
+
+    // The acknowledgement is sent at the end of the byte being received
+    if(ackType == ACK) SET_BIT(interface.interface->CR1, I2C_CR1_ACK);
+    else CLEAR_BIT(interface.interface->CR1, I2C_CR1_ACK);
 
     while(!READ_BIT(interface.interface->SR1, I2C_SR1_RXNE)) { yield; };
+    uint8_t data = interface.interface->DR;
 
-    i2cLock.release();
+    interface.lock.release();
 
-    return interface.interface->DR;
+    return data;
 };
 
-#endif
\ No newline at end of file
+// *** Transactions ***
+
+void i2c::HardwareI2C_Master::clearAddressFlag_() {
+    // ADDR is cleared by reading SR1 followed by SR2
+    volatile uint32_t dummy = interface.interface->SR1;
+    dummy = interface.interface->SR2;
+    (void)dummy;
+}
+
+void i2c::HardwareI2C_Master::startPhase_(Direction direction) {
+    I2C_TypeDef* i2c = interface.interface;
+    direction_ = direction;
+    index_ = 0;
+    CLEAR_BIT(i2c->CR2, I2C_CR2_DMAEN | I2C_CR2_LAST | I2C_CR2_ITBUFEN);
+
+    // The acknowledgement of the received bytes must be configured before the address is sent
+    if(direction == READ) {
+        if(useDMA_(rxDmaEnabled_, rxLength_)) {
+            // LAST makes the interface answer the last byte of the DMA transfer with a NACK
+            SET_BIT(i2c->CR1, I2C_CR1_ACK);
+            CLEAR_BIT(i2c->CR1, I2C_CR1_POS);
+            SET_BIT(i2c->CR2, I2C_CR2_DMAEN | I2C_CR2_LAST);
+        } else if(rxLength_ == 1) {
+            CLEAR_BIT(i2c->CR1, I2C_CR1_ACK | I2C_CR1_POS);
+        } else if(rxLength_ == 2) {
+            // POS makes the ACK bit apply to the second byte, so it can be cleared while the first
+            // one is still being received
+            SET_BIT(i2c->CR1, I2C_CR1_ACK | I2C_CR1_POS);
+        } else {
+            SET_BIT(i2c->CR1, I2C_CR1_ACK);
+            CLEAR_BIT(i2c->CR1, I2C_CR1_POS);
+        }
+    }
+
+    state_ = STATE_START;
+    SET_BIT(i2c->CR1, I2C_CR1_START);
+}
+
+void i2c::HardwareI2C_Master::finish_(TransactionResult result) {
+    I2C_TypeDef* i2c = interface.interface;
+    if(state_ == STATE_IDLE) return;
+
+    CLEAR_BIT(i2c->CR2, I2C_CR2_ITEVTEN | I2C_CR2_ITBUFEN | I2C_CR2_ITERREN | I2C_CR2_DMAEN | I2C_CR2_LAST);
+    CLEAR_BIT(i2c->CR1, I2C_CR1_POS);
+
+    if(result != RESULT_OK) {
+        if(txDmaEnabled_) HAL_DMA_Abort(&txDmaHandle_);
+        if(rxDmaEnabled_) HAL_DMA_Abort(&rxDmaHandle_);
+
+        if(result == RESULT_ARBITRATION_LOST) {
+            // The interface has already switched to slave mode and must not send a stop condition
+            CLEAR_BIT(i2c->SR1, I2C_SR1_ARLO);
+        } else {
+            SET_BIT(i2c->CR1, I2C_CR1_STOP);
+            CLEAR_BIT(i2c->SR1, I2C_SR1_AF | I2C_SR1_BERR);
+        }
+    }
+
+    state_ = STATE_IDLE;
+    result_ = result;
+    completed_.set();
+}
+
+void i2c::HardwareI2C_Master::handleEvent_() {
+    I2C_TypeDef* i2c = interface.interface;
+    uint32_t sr1 = i2c->SR1;
+
+    switch(state_) {
+        case STATE_START:
+            // SB is cleared by reading SR1 followed by writing DR
+            if(sr1 & I2C_SR1_SB) {
+                i2c->DR = address_ << 1 | direction_;
+                state_ = STATE_ADDRESS;
+            }
+            break;
+
+        case STATE_ADDRESS:
+            if(!(sr1 & I2C_SR1_ADDR)) break;
+
+            if(direction_ == WRITE) {
+                state_ = STATE_TRANSMIT;
+                if(useDMA_(txDmaEnabled_, txLength_)) {
+                    // The DMA writes the data, BTF is set after the last byte
+                    index_ = txLength_;
+                    HAL_DMA_Start_IT(&txDmaHandle_, (uint32_t)txData_, (uint32_t)&i2c->DR, txLength_);
+                    SET_BIT(i2c->CR2, I2C_CR2_DMAEN);
+                } else if(txLength_ > 0) {
+                    SET_BIT(i2c->CR2, I2C_CR2_ITBUFEN);
+                }
+                clearAddressFlag_();
+
+                // Without data, BTF is never set
+                if(txLength_ == 0) {
+                    SET_BIT(i2c->CR1, I2C_CR1_STOP);
+                    finish_(RESULT_OK);
+                }
+                break;
+            }
+
+            // The sequences follow the reference manual (RM0402, 24.3.3)
+            state_ = STATE_RECEIVE;
+            if(useDMA_(rxDmaEnabled_, rxLength_)) {
+                HAL_DMA_Start_IT(&rxDmaHandle_, (uint32_t)&i2c->DR, (uint32_t)rxData_, rxLength_);
+                clearAddressFlag_();
+            } else if(rxLength_ == 1) {
+                // The stop condition must be requested before the byte has been received
+                clearAddressFlag_();
+                SET_BIT(i2c->CR1, I2C_CR1_STOP);
+                SET_BIT(i2c->CR2, I2C_CR2_ITBUFEN);
+            } else if(rxLength_ == 2) {
+                // Both bytes are read once BTF is set
+                clearAddressFlag_();
+                CLEAR_BIT(i2c->CR1, I2C_CR1_ACK);
+            } else {
+                // With 3 bytes, the first one is read once BTF is set
+                clearAddressFlag_();
+                if(rxLength_ > 3) SET_BIT(i2c->CR2, I2C_CR2_ITBUFEN);
+            }
+            break;
+
+        case STATE_TRANSMIT:
+            if((sr1 & I2C_SR1_TXE) && index_ < txLength_) {
+                i2c->DR = txData_[index_++];
+                if(index_ == txLength_) CLEAR_BIT(i2c->CR2, I2C_CR2_ITBUFEN);
+            } else if(sr1 & I2C_SR1_BTF) {
+                // The last byte has been acknowledged, the clock is stretched until the next condition
+                CLEAR_BIT(i2c->CR2, I2C_CR2_DMAEN);
+                if(rxLength_ > 0) {
+                    startPhase_(READ);
+                } else {
+                    SET_BIT(i2c->CR1, I2C_CR1_STOP);
+                    finish_(RESULT_OK);
+                }
+            }
+            break;
+
+        case STATE_RECEIVE: {
+            size_t remaining = rxLength_ - index_;
+            if(remaining == 2) {
+                // Only with 2 bytes: byte 1 is in DR and byte 2 in the shift register
+                if(sr1 & I2C_SR1_BTF) {
+                    SET_BIT(i2c->CR1, I2C_CR1_STOP);
+                    rxData_[index_++] = i2c->DR;
+                    rxData_[index_++] = i2c->DR;
+                    finish_(RESULT_OK);
+                }
+            } else if(remaining == 3) {
+                // Byte N-2 is in DR and byte N-1 in the shift register, the clock is stretched
+                // before the acknowledgement of byte N-1
+                if(sr1 & I2C_SR1_BTF) {
+                    CLEAR_BIT(i2c->CR1, I2C_CR1_ACK);
+                    rxData_[index_++] = i2c->DR;
+                    SET_BIT(i2c->CR1, I2C_CR1_STOP);
+                    rxData_[index_++] = i2c->DR;
+                    SET_BIT(i2c->CR2, I2C_CR2_ITBUFEN);
+                }
+            } else if(sr1 & I2C_SR1_RXNE) {
+                rxData_[index_++] = i2c->DR;
+                if(rxLength_ - index_ == 3) CLEAR_BIT(i2c->CR2, I2C_CR2_ITBUFEN);
+                if(index_ == rxLength_) finish_(RESULT_OK);
+            }
+            break;
+        }
+
+        default:
+            // Spurious event, e.g. after a timeout
+            CLEAR_BIT(i2c->CR2, I2C_CR2_ITEVTEN | I2C_CR2_ITBUFEN);
+            break;
+    }
+}
+
+void i2c::HardwareI2C_Master::handleError_() {
+    uint32_t sr1 = interface.interface->SR1;
+    if(sr1 & I2C_SR1_AF) finish_(state_ == STATE_ADDRESS ? RESULT_ADDRESS_NACK : RESULT_DATA_NACK);
+    else if(sr1 & I2C_SR1_ARLO) finish_(RESULT_ARBITRATION_LOST);
+    else if(sr1 & I2C_SR1_BERR) finish_(RESULT_BUS_ERROR);
+    else CLEAR_BIT(interface.interface->SR1, I2C_SR1_OVR | I2C_SR1_TIMEOUT);
+}
+
+void i2c::HardwareI2C_Master::dmaTransferComplete_(DMA_HandleTypeDef* handle) {
+    HardwareI2C_Master* master = (HardwareI2C_Master*)handle->Parent;
+    // Errors which don't stop the transfer (e.g. FIFO errors) are reported as well
+    if(handle->State == HAL_DMA_STATE_BUSY) return;
+
+    if(handle->ErrorCode != HAL_DMA_ERROR_NONE) {
+        master->finish_(RESULT_BUS_ERROR);
+    } else if(handle == &master->rxDmaHandle_) {
+        // The last byte has already been answered with a NACK because of LAST
+        SET_BIT(master->interface.interface->CR1, I2C_CR1_STOP);
+        master->index_ = master->rxLength_;
+        master->finish_(RESULT_OK);
+    }
+    // The transmitter continues on BTF, after the last byte has been sent
+}
+
+i2c::TransactionResult i2c::HardwareI2C_Master::write(Address_7B address, const uint8_t* data, size_t length, uint32_t timeout) {
+    return writeRead(address, data, length, nullptr, 0, timeout);
+}
+
+i2c::TransactionResult i2c::HardwareI2C_Master::read(Address_7B address, uint8_t* data, size_t length, uint32_t timeout) {
+    return writeRead(address, nullptr, 0, data, length, timeout);
+}
+
+i2c::TransactionResult i2c::HardwareI2C_Master::writeRead(Address_7B address, const uint8_t* txData, size_t txLength, uint8_t* rxData, size_t rxLength, uint32_t timeout) {
+    uint32_t start = HAL_GetTick();
+    I2C_TypeDef* i2c = interface.interface;
+    interface.lock.acquire();
+
+    // Wait for other masters to release the bus
+    while(READ_BIT(i2c->SR2, I2C_SR2_BUSY)) {
+        if(HAL_GetTick() - start >= timeout) {
+            countTransaction_(RESULT_TIMEOUT, 0);
+            interface.lock.release();
+            return RESULT_TIMEOUT;
+        }
+        yield;
+    }
+
+    address_ = address;
+    txData_ = txData;
+    txLength_ = txLength;
+    rxData_ = rxData;
+    rxLength_ = rxLength;
+    active_[interfaceIndex_(i2c)] = this;
+    completed_.clear();
+
+    // A read without a write phase starts with the read address right away
+    SET_BIT(i2c->CR2, I2C_CR2_ITEVTEN | I2C_CR2_ITERREN);
+    startPhase_(txLength > 0 || rxLength == 0 ? WRITE : READ);
+
+    while(!completed_.isSet()) {
+        if(HAL_GetTick() - start >= timeout) {
+            uint32_t primask = __get_PRIMASK();
+            __disable_irq();
+            finish_(RESULT_TIMEOUT);
+            __set_PRIMASK(primask);
+            break;
+        }
+        yield;
+    }
+    completed_.clear();
+    TransactionResult result = result_;
+
+    // The next start condition can't be requested before the stop condition has been sent
+    while(READ_BIT(i2c->CR1, I2C_CR1_STOP) && HAL_GetTick() - start < timeout) { yield; }
+
+    countTransaction_(result, txLength + rxLength);
+    interface.lock.release();
+    return result;
+}
+
+// *** i2c::HardwareI2C_Slave ***
+
+void i2c::HardwareI2C_Slave::begin(Address_7B address, RegisterFile& file) {
+    i2c_enable_clocks_();
+    I2C_TypeDef* i2c = interface.interface;
+    file_ = &file;
+    pointer_ = 0;
+    slaves_[interfaceIndex_(i2c)] = this;
+
+    txDmaEnabled_ = txDmaEnabled_ || claimDMA_(txDmaHandle_, interface.txDma, DMA_MEMORY_TO_PERIPH, this, dmaTransferComplete_);
+    rxDmaEnabled_ = rxDmaEnabled_ || claimDMA_(rxDmaHandle_, interface.rxDma, DMA_PERIPH_TO_MEMORY, this, dmaTransferComplete_);
+
+    // Bit 14 of OAR1 must be kept at 1 by software
+    CLEAR_BIT(i2c->CR1, I2C_CR1_PE);
+    i2c->CR2 = HAL_RCC_GetPCLK1Freq() / 1000000;
+    i2c->OAR1 = (1u << 14) | (address << 1);
+    SET_BIT(i2c->CR1, I2C_CR1_PE);
+    SET_BIT(i2c->CR1, I2C_CR1_ACK);
+
+    enableInterrupts_(interface);
+    SET_BIT(i2c->CR2, I2C_CR2_ITEVTEN | I2C_CR2_ITERREN);
+}
+
+void i2c::HardwareI2C_Slave::update(size_t address, const uint8_t* data, size_t length) {
+    if(address + length > file_->size) return;
+
+    // The snapshot is taken in the event interrupt
+    HAL_NVIC_DisableIRQ(interface.eventIrq);
+    memcpy(file_->registers + address, data, length);
+    HAL_NVIC_EnableIRQ(interface.eventIrq);
+}
+
+void i2c::HardwareI2C_Slave::read(size_t address, uint8_t* data, size_t length) {
+    if(address + length > file_->size) return;
+
+    // Received data is applied in the event interrupt
+    HAL_NVIC_DisableIRQ(interface.eventIrq);
+    memcpy(data, file_->registers + address, length);
+    HAL_NVIC_EnableIRQ(interface.eventIrq);
+}
+
+void i2c::HardwareI2C_Slave::startTransmit_() {
+    I2C_TypeDef* i2c = interface.interface;
+    size_t start = pointer_ < file_->size ? pointer_ : file_->size;
+    size_t length = file_->size - start;
+    if(length > sizeof(txBuffer_)) length = sizeof(txBuffer_);
+
+    memcpy(txBuffer_, file_->registers + start, length);
+    memset(txBuffer_ + length, 0xFF, sizeof(txBuffer_) - length);
+    index_ = 0;
+    transmitting_ = true;
+    reads_++;
+
+    // The first byte is requested as soon as ADDR has been cleared
+    if(txDmaEnabled_) {
+        HAL_DMA_Start_IT(&txDmaHandle_, (uint32_t)txBuffer_, (uint32_t)&i2c->DR, sizeof(txBuffer_));
+        SET_BIT(i2c->CR2, I2C_CR2_DMAEN);
+    } else {
+        SET_BIT(i2c->CR2, I2C_CR2_ITBUFEN);
+    }
+}
+
+void i2c::HardwareI2C_Slave::startReceive_() {
+    I2C_TypeDef* i2c = interface.interface;
+    index_ = 0;
+    receiving_ = true;
+
+    if(rxDmaEnabled_) {
+        HAL_DMA_Start_IT(&rxDmaHandle_, (uint32_t)&i2c->DR, (uint32_t)rxBuffer_, sizeof(rxBuffer_));
+        SET_BIT(i2c->CR2, I2C_CR2_DMAEN);
+    } else {
+        SET_BIT(i2c->CR2, I2C_CR2_ITBUFEN);
+    }
+}
+
+void i2c::HardwareI2C_Slave::finishTransmit_() {
+    if(!transmitting_) return;
+    transmitting_ = false;
+
+    CLEAR_BIT(interface.interface->CR2, I2C_CR2_DMAEN | I2C_CR2_ITBUFEN);
+    if(txDmaEnabled_) HAL_DMA_Abort(&txDmaHandle_);
+}
+
+void i2c::HardwareI2C_Slave::finishReceive_() {
+    if(!receiving_) return;
+    receiving_ = false;
+
+    CLEAR_BIT(interface.interface->CR2, I2C_CR2_DMAEN | I2C_CR2_ITBUFEN);
+    size_t count = index_;
+    if(rxDmaEnabled_) {
+        // After the DMA has completed, the interrupt handler takes over the index
+        if(!index_) count = sizeof(rxBuffer_) - __HAL_DMA_GET_COUNTER(&rxDmaHandle_);
+        HAL_DMA_Abort(&rxDmaHandle_);
+    }
+    if(count == 0) return;
+
+    // The first byte sets the register address, the others are written to the registers
+    pointer_ = rxBuffer_[0];
+    size_t length = count - 1;
+    if(length == 0) return;
+
+    if(pointer_ < file_->firstWritable || pointer_ + length > file_->size || count > sizeof(rxBuffer_)) {
+        errors_++;
+        return;
+    }
+
+    memcpy(file_->registers + pointer_, rxBuffer_ + 1, length);
+    writes_++;
+    if(file_->written) file_->written(pointer_, length);
+}
+
+void i2c::HardwareI2C_Slave::handleEvent_() {
+    I2C_TypeDef* i2c = interface.interface;
+    uint32_t sr1 = i2c->SR1;
+
+    if(sr1 & I2C_SR1_ADDR) {
+        // Reading SR2 clears ADDR. A repeated start ends a write without a stop condition.
+        uint32_t sr2 = i2c->SR2;
+        finishReceive_();
+        finishTransmit_();
+        if(sr2 & I2C_SR2_TRA) startTransmit_();
+        else startReceive_();
+        return;
+    }
+
+    if(sr1 & I2C_SR1_STOPF) {
+        // STOPF is cleared by reading SR1 followed by writing CR1
+        SET_BIT(i2c->CR1, I2C_CR1_PE);
+        finishReceive_();
+        return;
+    }
+
+    // Only reached without the DMA, or after the DMA has reached the end of the buffer
+    if((sr1 & I2C_SR1_TXE) && transmitting_) {
+        i2c->DR = index_ < sizeof(txBuffer_) && !txDmaEnabled_ ? txBuffer_[index_++] : 0xFF;
+    } else if(sr1 & I2C_SR1_RXNE) {
+        uint8_t data = i2c->DR;
+        if(receiving_ && index_ < sizeof(rxBuffer_)) rxBuffer_[index_++] = data;
+        else if(receiving_) index_ = sizeof(rxBuffer_) + 1;
+    }
+}
+
+void i2c::HardwareI2C_Slave::handleError_() {
+    I2C_TypeDef* i2c = interface.interface;
+    uint32_t sr1 = i2c->SR1;
+
+    // The master answers the last byte it reads with a NACK
+    if(sr1 & I2C_SR1_AF) {
+        CLEAR_BIT(i2c->SR1, I2C_SR1_AF);
+        finishTransmit_();
+    }
+
+    if(sr1 & (I2C_SR1_BERR | I2C_SR1_ARLO | I2C_SR1_OVR)) {
+        CLEAR_BIT(i2c->SR1, I2C_SR1_BERR | I2C_SR1_ARLO | I2C_SR1_OVR);
+        errors_++;
+        receiving_ = false;
+        finishTransmit_();
+        CLEAR_BIT(i2c->CR2, I2C_CR2_DMAEN | I2C_CR2_ITBUFEN);
+        if(rxDmaEnabled_) HAL_DMA_Abort(&rxDmaHandle_);
+    }
+}
+
+void i2c::HardwareI2C_Slave::dmaTransferComplete_(DMA_HandleTypeDef* handle) {
+    HardwareI2C_Slave* slave = (HardwareI2C_Slave*)handle->Parent;
+    if(handle->State == HAL_DMA_STATE_BUSY) return;
+
+    // The buffer is exhausted: pad the transmission, or let the interrupt handler count an overflow
+    // if the master writes another byte. A write filling the buffer exactly is still valid.
+    CLEAR_BIT(slave->interface.interface->CR2, I2C_CR2_DMAEN);
+    if(handle == &slave->rxDmaHandle_) slave->index_ = sizeof(slave->rxBuffer_);
+    SET_BIT(slave->interface.interface->CR2, I2C_CR2_ITBUFEN);
+}
+
+void i2c::__i2c_event_irq_handler(I2C_TypeDef* instance) {
+    int index = interfaceIndex_(instance);
+    if(slaves_[index]) slaves_[index]->handleEvent_();
+    else if(active_[index]) active_[index]->handleEvent_();
+}
+
+void i2c::__i2c_error_irq_handler(I2C_TypeDef* instance) {
+    int index = interfaceIndex_(instance);
+    if(slaves_[index]) slaves_[index]->handleError_();
+    else if(active_[index]) active_[index]->handleError_();
+}
+
+#endif
@@ -0,0 +1,31 @@
+#include <libembed/arch/arm/stm32/stm32f412/i2c_timing.h>
+
+// Built for every target, since it doesn't depend on the HAL
+
+namespace timing = embed::arch::arm::stm32::stm32f412::i2c;
+
+uint32_t timing::clockControl(uint32_t pclk, uint32_t freq) {
+    if(freq == 0 || freq > 400000) return 0;
+
+    if(freq <= 100000) {
+        uint32_t ccr = (pclk + 2 * freq - 1) / (2 * freq);
+        if(ccr < 4) ccr = 4;
+        return ccr <= CCR_CLOCK_CONTROL ? ccr : 0;
+    }
+
+    // Fast mode requires PCLK1 to be at least 4 MHz
+    if(pclk < 4000000) return 0;
+    uint32_t ccr2 = (pclk + 3 * freq - 1) / (3 * freq);
+    uint32_t ccr169 = (pclk + 25 * freq - 1) / (25 * freq);
+    if(ccr2 < 1) ccr2 = 1;
+    if(ccr169 < 1) ccr169 = 1;
+
+    // Comparing the periods, the shorter one is closer to the requested frequency
+    if(25 * ccr169 < 3 * ccr2) return CCR_FAST_MODE | CCR_DUTY | ccr169;
+    return CCR_FAST_MODE | ccr2;
+}
+
+uint32_t timing::riseTime(uint32_t pclk, uint32_t freq) {
+    uint32_t mhz = pclk / 1000000;
+    return (freq <= 100000 ? mhz : mhz * 300 / 1000) + 1;
+}
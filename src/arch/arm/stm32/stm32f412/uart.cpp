@@ -4,18 +4,39 @@
 #include <libembed/arch/ident.h>
 #include <libembed/arch/arm/stm32/stm32f412/uart.h>
 #include "../uart_types.h"
+#include "../nvic_types.h"
 
 #if STM32F412xx
 
+// Installed by HardwareUART::begin(), so the application can handle the interfaces it doesn't begin
+static void usart1IrqHandler_() { embed::arch::arm::stm32::uart::__uart_irq_handler(USART1); }
+static void usart2IrqHandler_() { embed::arch::arm::stm32::uart::__uart_irq_handler(USART2); }
+static void usart3IrqHandler_() { embed::arch::arm::stm32::uart::__uart_irq_handler(USART3); }
+
 namespace embed::arch::arm::stm32::stm32f412::uart {
     UART_HardwareInterface UART1 = { 
-        .hwInterfacePtr = USART1
+        .hwInterfacePtr = USART1,
+        .gpioAlternateFunctionID = GPIO_AF7_USART1,
+        .irq = USART1_IRQn,
+        .irqHandler = usart1IrqHandler_,
+        .txDma = { DMA2_Stream7, DMA_CHANNEL_4 },
+        .rxDma = { DMA2_Stream2, DMA_CHANNEL_4 }
     };
     UART_HardwareInterface UART2 = {
-        .hwInterfacePtr = USART2
+        .hwInterfacePtr = USART2,
+        .gpioAlternateFunctionID = GPIO_AF7_USART2,
+        .irq = USART2_IRQn,
+        .irqHandler = usart2IrqHandler_,
+        .txDma = { DMA1_Stream6, DMA_CHANNEL_4 },
+        .rxDma = { DMA1_Stream5, DMA_CHANNEL_4 }
     };
     UART_HardwareInterface UART3 = {
-        .hwInterfacePtr = USART3
+        .hwInterfacePtr = USART3,
+        .gpioAlternateFunctionID = GPIO_AF7_USART3,
+        .irq = USART3_IRQn,
+        .irqHandler = usart3IrqHandler_,
+        .txDma = { DMA1_Stream3, DMA_CHANNEL_4 },
+        .rxDma = { DMA1_Stream1, DMA_CHANNEL_4 }
     };
 }
 
@@ -25,4 +46,68 @@ void embed::arch::arm::stm32::uart::__uart_clock_enable() {
     __HAL_RCC_USART3_CLK_ENABLE();
 }
 
+uint32_t embed::arch::arm::stm32::uart::__uart_clock_frequency(USART_TypeDef* uart) {
+    // USART1 and USART6 are on APB2, the others on APB1
+    if(uart == USART1 || uart == USART6) return HAL_RCC_GetPCLK2Freq();
+    return HAL_RCC_GetPCLK1Freq();
+}
+
+volatile uint32_t* embed::arch::arm::stm32::uart::__uart_tx_data_register(USART_TypeDef* uart) {
+    return &uart->DR;
+}
+
+volatile uint32_t* embed::arch::arm::stm32::uart::__uart_rx_data_register(USART_TypeDef* uart) {
+    return &uart->DR;
+}
+
+// The basic timer releasing the RS-485 driver enable pins
+#if LIBEMBED_CONFIG_STM32_RS485_TIMER == 6
+    #define DE_TIMER TIM6
+    #define DE_TIMER_IRQ TIM6_IRQn
+    #define DE_TIMER_CLK_ENABLE() __HAL_RCC_TIM6_CLK_ENABLE()
+#elif LIBEMBED_CONFIG_STM32_RS485_TIMER == 7
+    #define DE_TIMER TIM7
+    #define DE_TIMER_IRQ TIM7_IRQn
+    #define DE_TIMER_CLK_ENABLE() __HAL_RCC_TIM7_CLK_ENABLE()
+#else
+    #error LIBEMBED_CONFIG_STM32_RS485_TIMER must be 6 or 7
+#endif
+
+static void deTimerIrqHandler_() {
+    DE_TIMER->SR = 0;
+    embed::arch::arm::stm32::uart::__uart_de_timer_irq_handler();
+}
+
+void embed::arch::arm::stm32::uart::__uart_de_timer_start(uint32_t nanoseconds) {
+    // The timer is only taken over once a UART in RS-485 mode has transmitted
+    static bool installed = false;
+    if(!installed) {
+        DE_TIMER_CLK_ENABLE();
+        nvic::__nvic_set_handler(DE_TIMER_IRQ, deTimerIrqHandler_);
+        HAL_NVIC_SetPriority(DE_TIMER_IRQ, 0, 0);
+        HAL_NVIC_EnableIRQ(DE_TIMER_IRQ);
+        installed = true;
+    }
+
+    // The APB1 timers run at twice the bus clock when the bus is divided
+    uint32_t timerClock = HAL_RCC_GetPCLK1Freq();
+    if(RCC->CFGR & RCC_CFGR_PPRE1_2) timerClock *= 2;
+
+    uint64_t cycles = ((uint64_t)nanoseconds * timerClock + 999999999) / 1000000000;
+    if(cycles == 0) cycles = 1;
+    uint32_t prescaler = (uint32_t)((cycles - 1) >> 16);
+    uint32_t reload = (uint32_t)((cycles + prescaler) / (prescaler + 1)) - 1;
+    if(reload == 0) reload = 1;
+
+    DE_TIMER->CR1 = 0;
+    DE_TIMER->PSC = prescaler;
+    DE_TIMER->ARR = reload;
+    // The update event loads the prescaler without raising the interrupt
+    DE_TIMER->CR1 = TIM_CR1_OPM | TIM_CR1_URS;
+    DE_TIMER->EGR = TIM_EGR_UG;
+    DE_TIMER->SR = 0;
+    DE_TIMER->DIER = TIM_DIER_UIE;
+    DE_TIMER->CR1 |= TIM_CR1_CEN;
+}
+
 #endif
\ No newline at end of file
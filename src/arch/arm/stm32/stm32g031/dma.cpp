@@ -0,0 +1,77 @@
+#include <libembed/arch/arm/stm32/stm32_hal.h>
+#include <libembed/arch/ident.h>
+#include "../dma_types.h"
+#include "../nvic_types.h"
+
+#if STM32G031xx
+
+using namespace embed::arch::arm::stm32;
+
+#define DMA_CHANNEL_COUNT 5
+
+static DMA_Channel_TypeDef* const channels_[DMA_CHANNEL_COUNT] = {
+    DMA1_Channel1, DMA1_Channel2, DMA1_Channel3, DMA1_Channel4, DMA1_Channel5
+};
+
+// Channels 2/3 and 4/5 share an interrupt
+static const IRQn_Type irqs_[DMA_CHANNEL_COUNT] = {
+    DMA1_Channel1_IRQn, DMA1_Channel2_3_IRQn, DMA1_Channel2_3_IRQn, DMA1_Ch4_5_DMAMUX1_OVR_IRQn, DMA1_Ch4_5_DMAMUX1_OVR_IRQn
+};
+
+// Handles of the claimed channels, used for dispatching the interrupts
+static DMA_HandleTypeDef* handles_[DMA_CHANNEL_COUNT];
+
+static void dispatch_(int index) {
+    if(handles_[index]) HAL_DMA_IRQHandler(handles_[index]);
+}
+
+static void channel1IrqHandler_() { dispatch_(0); }
+static void channel2_3IrqHandler_() { dispatch_(1); dispatch_(2); }
+static void channel4_5IrqHandler_() { dispatch_(3); dispatch_(4); }
+
+// Installed when a channel is claimed, so the application can handle the channels the library doesn't use
+static void (* const irqHandlers_[DMA_CHANNEL_COUNT])() = {
+    channel1IrqHandler_, channel2_3IrqHandler_, channel2_3IrqHandler_, channel4_5IrqHandler_, channel4_5IrqHandler_
+};
+
+static int channelIndex_(DMA_Channel_TypeDef* channel) {
+    for(int i = 0; i < DMA_CHANNEL_COUNT; i++) {
+        if(channels_[i] == channel) return i;
+    }
+    return -1;
+}
+
+bool dma::__dma_claim(DMA_HandleTypeDef& handle, const __DMA_Request& request) {
+    int index = channelIndex_(request.instance);
+    if(index < 0 || (handles_[index] && handles_[index] != &handle)) return false;
+
+    __HAL_RCC_DMA1_CLK_ENABLE();
+
+    handle.Instance = request.instance;
+    handle.Init.Request = request.request;
+    if(HAL_DMA_Init(&handle) != HAL_OK) return false;
+
+    handles_[index] = &handle;
+    nvic::__nvic_set_handler(irqs_[index], irqHandlers_[index]);
+    HAL_NVIC_SetPriority(irqs_[index], 0, 0);
+    HAL_NVIC_EnableIRQ(irqs_[index]);
+    return true;
+}
+
+void dma::__dma_release(DMA_HandleTypeDef& handle) {
+    int index = channelIndex_(handle.Instance);
+    if(index < 0 || handles_[index] != &handle) return;
+
+    // Only disable the interrupt if the other channel sharing it is unused as well
+    handles_[index] = nullptr;
+    bool irqUsed = false;
+    for(int i = 0; i < DMA_CHANNEL_COUNT; i++) {
+        if(irqs_[i] == irqs_[index] && handles_[i]) irqUsed = true;
+    }
+    if(!irqUsed) HAL_NVIC_DisableIRQ(irqs_[index]);
+
+    HAL_DMA_Abort(&handle);
+    HAL_DMA_DeInit(&handle);
+}
+
+#endif /* STM32G031xx */
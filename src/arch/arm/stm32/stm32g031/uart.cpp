@@ -7,12 +7,26 @@
 
 #if STM32G031xx
 
+// Installed by HardwareUART::begin(), so the application can handle the interfaces it doesn't begin
+static void usart1IrqHandler_() { embed::arch::arm::stm32::uart::__uart_irq_handler(USART1); }
+static void usart2IrqHandler_() { embed::arch::arm::stm32::uart::__uart_irq_handler(USART2); }
+
 namespace embed::arch::arm::stm32::stm32g031::uart {
     UART_HardwareInterface UART1 = { 
-        .hwInterfacePtr = USART1
+        .hwInterfacePtr = USART1,
+        .gpioAlternateFunctionID = GPIO_AF1_USART1,
+        .irq = USART1_IRQn,
+        .irqHandler = usart1IrqHandler_,
+        .txDma = { DMA1_Channel2, DMA_REQUEST_USART1_TX },
+        .rxDma = { DMA1_Channel3, DMA_REQUEST_USART1_RX }
     };
     UART_HardwareInterface UART2 = {
-        .hwInterfacePtr = USART2
+        .hwInterfacePtr = USART2,
+        .gpioAlternateFunctionID = GPIO_AF1_USART2,
+        .irq = USART2_IRQn,
+        .irqHandler = usart2IrqHandler_,
+        .txDma = { DMA1_Channel4, DMA_REQUEST_USART2_TX },
+        .rxDma = { DMA1_Channel5, DMA_REQUEST_USART2_RX }
     };
 }
 
@@ -21,4 +35,18 @@ void embed::arch::arm::stm32::uart::__uart_clock_enable() {
     __HAL_RCC_USART2_CLK_ENABLE();
 }
 
+uint32_t embed::arch::arm::stm32::uart::__uart_clock_frequency(USART_TypeDef* uart) {
+    // USART1 has a selectable kernel clock, USART2 always runs from PCLK
+    if(uart == USART1) return HAL_RCCEx_GetPeriphCLKFreq(RCC_PERIPHCLK_USART1);
+    return HAL_RCC_GetPCLK1Freq();
+}
+
+volatile uint32_t* embed::arch::arm::stm32::uart::__uart_tx_data_register(USART_TypeDef* uart) {
+    return &uart->TDR;
+}
+
+volatile uint32_t* embed::arch::arm::stm32::uart::__uart_rx_data_register(USART_TypeDef* uart) {
+    return &uart->RDR;
+}
+
 #endif
\ No newline at end of file
@@ -1,13 +1,65 @@
 #include <libembed/arch/arm/stm32/uart.h>
+#include <libembed/arch/arm/stm32/gpio.h>
 #include <libembed/arch/arm/stm32/stm32_hal.h>
 #include <libembed/util/exceptions.h>
+#include <libembed/util/coroutines.h>
+#include <libembed/hal/clock/types.h>
 #include "uart_types.h"
+#include "nvic_types.h"
 
 #if LIBEMBED_PLATFORM == ststm32
 
 using namespace embed::arch::arm::stm32;
 
-void uart::HardwareUART::begin(Baudrate baudrate, uint8_t wordLength, ParityMode parityMode, StopBitMode stopBitMode){
+// STM32 devices have at most 8 U(S)ARTs
+#define UART_MAX_INSTANCES 8
+
+// USARTs with a DEM bit drive the RS-485 driver enable output by themselves
+#if defined(USART_CR3_DEM)
+    #define UART_HARDWARE_DE 1
+#else
+    #define UART_HARDWARE_DE 0
+#endif
+
+// USARTs with a clear register (ICR) clear the error flags without touching the data register. The
+// others (e.g. STM32F4) clear them by reading SR and then DR, which still holds a received frame.
+#if defined(USART_ICR_ORECF)
+    #define UART_CLEAR_REGISTER 1
+#else
+    #define UART_CLEAR_REGISTER 0
+#endif
+
+// Hardware UARTs which have been started, used for dispatching the UART interrupts
+static uart::HardwareUART* instances_[UART_MAX_INSTANCES];
+
+/**
+ * @brief Gets the baudrate the UART generates for the requested one.
+ *
+ * BRR holds the number of kernel clock cycles per bit, in 1/16 or 1/8 of a cycle depending on
+ * the oversampling mode, so both modes have the same resolution. Oversampling by 16 requires
+ * at least 16 cycles per bit, oversampling by 8 at least 8.
+ *
+ * @return Returns the baudrate, or 0 if it can't be generated.
+ */
+static uint32_t actualBaudrate_(uint32_t clock, uint32_t baudrate, bool over8) {
+    if(baudrate == 0) return 0;
+    uint32_t cycles = (uint32_t)(((uint64_t)clock + baudrate / 2) / baudrate);
+    if(cycles < (over8 ? 8 : 16) || cycles > (over8 ? 0x7FFF : 0xFFFF)) return 0;
+    return clock / cycles;
+}
+
+//! Gets the deviation of the generated baudrate in tenths of a percent.
+static uint32_t baudrateError_(uint32_t baudrate, uint32_t actual) {
+    uint32_t deviation = actual > baudrate ? actual - baudrate : baudrate - actual;
+    return (uint32_t)((uint64_t)deviation * 1000 / baudrate);
+}
+
+void uart::HardwareUART::begin(Baudrate baudrate, uint8_t wordLength, ParityMode parityMode, StopBitMode stopBitMode) {
+    begin(baudrate, wordLength, parityMode, stopBitMode, FLOWCONTROL_NONE);
+}
+
+void uart::HardwareUART::begin(Baudrate baudrate, uint8_t wordLength, ParityMode parityMode, StopBitMode stopBitMode, FlowControlMode flowControlMode,
+        OversamplingMode oversamplingMode, embed::gpio::_GPIO_Pin_specific* rtsPin, embed::gpio::_GPIO_Pin_specific* ctsPin) {
     __uart_clock_enable();
 
     uartHandle.Instance = interface.hwInterfacePtr;
@@ -32,32 +84,575 @@ void uart::HardwareUART::begin(Baudrate baudrate, uint8_t wordLength, ParityMode
         default: exceptions::throw_exception(exceptions::unsupported_on_this_device("Unsupported stop bit mode."));
     }
 
-    uartHandle.Init.HwFlowCtl = UART_HWCONTROL_NONE;
+    switch(flowControlMode) {
+        case FLOWCONTROL_NONE: uartHandle.Init.HwFlowCtl = UART_HWCONTROL_NONE; break;
+        case FLOWCONTROL_RTS: uartHandle.Init.HwFlowCtl = UART_HWCONTROL_RTS; break;
+        case FLOWCONTROL_CTS: uartHandle.Init.HwFlowCtl = UART_HWCONTROL_CTS; break;
+        case FLOWCONTROL_RTS_CTS: uartHandle.Init.HwFlowCtl = UART_HWCONTROL_RTS_CTS; break;
+        default: exceptions::throw_exception(exceptions::unsupported_on_this_device("Unsupported flow control mode."));
+    }
+    if(dePin_ && (flowControlMode == FLOWCONTROL_RTS || flowControlMode == FLOWCONTROL_RTS_CTS)) {
+        exceptions::throw_exception(exceptions::unsupported_on_this_device("RTS can't be used in RS-485 mode."));
+    }
+
+    // Oversampling by 16 is preferred, as it is more robust against noise and clock deviation
+    uint32_t kernelClock = __uart_clock_frequency(interface.hwInterfacePtr);
+    bool over8 = oversamplingMode == OVERSAMPLING_8 || (oversamplingMode == OVERSAMPLING_AUTO && actualBaudrate_(kernelClock, baudrate, false) == 0);
+    uint32_t actual = actualBaudrate_(kernelClock, baudrate, over8);
+    if(actual == 0 || baudrateError_(baudrate, actual) > LIBEMBED_CONFIG_STM32_UART_MAX_BAUDRATE_ERROR) {
+        exceptions::throw_exception(exceptions::unsupported_on_this_device("Baudrate can't be generated from the UART clock."));
+    }
+
     uartHandle.Init.Mode = UART_MODE_TX_RX;
-    uartHandle.Init.OverSampling = UART_OVERSAMPLING_16;
+    uartHandle.Init.OverSampling = over8 ? UART_OVERSAMPLING_8 : UART_OVERSAMPLING_16;
+
+    if(rtsPin && (flowControlMode == FLOWCONTROL_RTS || flowControlMode == FLOWCONTROL_RTS_CTS)) {
+        rtsPin->setAlternate(interface.gpioAlternateFunctionID);
+    }
+    if(ctsPin && (flowControlMode == FLOWCONTROL_CTS || flowControlMode == FLOWCONTROL_RTS_CTS)) {
+        ctsPin->setAlternate(interface.gpioAlternateFunctionID);
+    }
+
     
+    setTxDMAEnabled(false);
+    setRxDMAEnabled(false);
     HAL_UART_Init(&uartHandle);
+
+    for(int i = 0; i < UART_MAX_INSTANCES; i++) {
+        if(instances_[i] == this || instances_[i] == nullptr) {
+            instances_[i] = this;
+            break;
+        }
+    }
+    nvic::__nvic_set_handler(interface.irq, interface.irqHandler);
+
+    #if UART_HARDWARE_DE
+        // The driver enable configuration can only be written while the UART is disabled
+        __HAL_UART_DISABLE(&uartHandle);
+        MODIFY_REG(uartHandle.Instance->CR1, USART_CR1_DEAT | USART_CR1_DEDT,
+            ((uint32_t)deAssertionTime_ << USART_CR1_DEAT_Pos) | ((uint32_t)deDeassertionTime_ << USART_CR1_DEDT_Pos));
+        MODIFY_REG(uartHandle.Instance->CR3, USART_CR3_DEM | USART_CR3_DEP, dePin_ ? USART_CR3_DEM : 0);
+        __HAL_UART_ENABLE(&uartHandle);
+        if(dePin_) dePin_->setAlternate(interface.gpioAlternateFunctionID);
+    #else
+        deAsserted_ = false;
+        if(dePin_) {
+            // The transmission complete interrupt deasserts the pin
+            dePin_->setOutput(false);
+            HAL_NVIC_SetPriority(interface.irq, 0, 0);
+            HAL_NVIC_EnableIRQ(interface.irq);
+        }
+    #endif
+
+    setTxDMAEnabled(true);
+    setRxDMAEnabled(true);
+}
+
+void uart::HardwareUART::setRS485Mode(embed::gpio::_GPIO_Pin_specific* dePin, uint8_t assertionTime, uint8_t deassertionTime) {
+    dePin_ = dePin;
+    deAssertionTime_ = assertionTime > 31 ? 31 : assertionTime;
+    deDeassertionTime_ = deassertionTime > 31 ? 31 : deassertionTime;
+}
+
+bool uart::HardwareUART::setTxDMAEnabled(bool enabled) {
+    if(enabled == txDmaEnabled_) return txDmaEnabled_;
+    // The buffers only hold bytes, so the DMA can't be used for frames with 9 data bits
+    if(enabled && !byteFrames_()) return false;
+
+    if(!enabled) {
+        flush();
+        CLEAR_BIT(uartHandle.Instance->CR3, USART_CR3_DMAT);
+        dma::__dma_release(txDmaHandle_);
+        txDmaEnabled_ = false;
+        return false;
+    }
+
+    txDmaHandle_.Init.Direction = DMA_MEMORY_TO_PERIPH;
+    txDmaHandle_.Init.PeriphInc = DMA_PINC_DISABLE;
+    txDmaHandle_.Init.MemInc = DMA_MINC_ENABLE;
+    txDmaHandle_.Init.PeriphDataAlignment = DMA_PDATAALIGN_BYTE;
+    txDmaHandle_.Init.MemDataAlignment = DMA_MDATAALIGN_BYTE;
+    txDmaHandle_.Init.Mode = DMA_NORMAL;
+    txDmaHandle_.Init.Priority = DMA_PRIORITY_LOW;
+    if(!dma::__dma_claim(txDmaHandle_, interface.txDma)) return false;
+
+    txDmaHandle_.Parent = this;
+    txDmaHandle_.XferCpltCallback = txTransferComplete_;
+    txDmaHandle_.XferErrorCallback = txTransferComplete_;
+    SET_BIT(uartHandle.Instance->CR3, USART_CR3_DMAT);
+    txDmaEnabled_ = true;
+    return true;
+}
+
+bool uart::HardwareUART::setRxDMAEnabled(bool enabled) {
+    if(enabled == rxDmaEnabled_) return rxDmaEnabled_;
+    if(enabled && !byteFrames_()) return false;
+
+    if(!enabled) {
+        // The interrupt is still needed for releasing the RS-485 driver enable pin
+        if(!dePin_ || UART_HARDWARE_DE) HAL_NVIC_DisableIRQ(interface.irq);
+        __HAL_UART_DISABLE_IT(&uartHandle, UART_IT_IDLE);
+        __HAL_UART_DISABLE_IT(&uartHandle, UART_IT_ERR);
+        CLEAR_BIT(uartHandle.Instance->CR3, USART_CR3_DMAR);
+        dma::__dma_release(rxDmaHandle_);
+        rxBuffer_.reset();
+        rxDmaEnabled_ = false;
+        return false;
+    }
+
+    // Received data must never wait for the DMA, so the receiver gets the highest priority
+    rxDmaHandle_.Init.Direction = DMA_PERIPH_TO_MEMORY;
+    rxDmaHandle_.Init.PeriphInc = DMA_PINC_DISABLE;
+    rxDmaHandle_.Init.MemInc = DMA_MINC_ENABLE;
+    rxDmaHandle_.Init.PeriphDataAlignment = DMA_PDATAALIGN_BYTE;
+    rxDmaHandle_.Init.MemDataAlignment = DMA_MDATAALIGN_BYTE;
+    rxDmaHandle_.Init.Mode = DMA_CIRCULAR;
+    rxDmaHandle_.Init.Priority = DMA_PRIORITY_VERY_HIGH;
+    if(!dma::__dma_claim(rxDmaHandle_, interface.rxDma)) return false;
+
+    rxDmaHandle_.Parent = this;
+    rxDmaHandle_.XferHalfCpltCallback = rxTransferProgress_;
+    rxDmaHandle_.XferCpltCallback = rxTransferProgress_;
+    rxDmaHandle_.XferErrorCallback = rxTransferProgress_;
+
+    // The DMA starts writing at the beginning of the storage
+    rxBuffer_.reset();
+    rxDmaPosition_ = 0;
+    rxOverrun_ = false;
+
+    HAL_DMA_Start_IT(&rxDmaHandle_, (uint32_t)__uart_rx_data_register(uartHandle.Instance), (uint32_t)rxBuffer_.storage(), rxBuffer_.capacity());
+    SET_BIT(uartHandle.Instance->CR3, USART_CR3_DMAR);
+
+    __HAL_UART_CLEAR_IDLEFLAG(&uartHandle);
+    __HAL_UART_ENABLE_IT(&uartHandle, UART_IT_IDLE);
+    __HAL_UART_ENABLE_IT(&uartHandle, UART_IT_ERR);
+    HAL_NVIC_SetPriority(interface.irq, 0, 0);
+    HAL_NVIC_EnableIRQ(interface.irq);
+
+    rxDmaEnabled_ = true;
+    return true;
+}
+
+void uart::HardwareUART::startTxTransfer_() {
+    // This is called from the DMA interrupt as well, so interrupts are masked while starting a transfer
+    uint32_t primask = __get_PRIMASK();
+    __disable_irq();
+
+    if(txTransferLength_ == 0 && !txBuffer_.empty()) {
+        size_t length;
+        const uint8_t* data = txBuffer_.readPointer(length);
+        txTransferLength_ = length;
+        armDriverRelease_();
+        HAL_DMA_Start_IT(&txDmaHandle_, (uint32_t)data, (uint32_t)__uart_tx_data_register(uartHandle.Instance), length);
+    }
+
+    __set_PRIMASK(primask);
+}
+
+void uart::HardwareUART::assertDriverEnable_() {
+    #if !UART_HARDWARE_DE
+        if(!dePin_) return;
+
+        // From here on, nothing releases the pin until the next transfer has been armed
+        uint32_t primask = __get_PRIMASK();
+        __disable_irq();
+        __HAL_UART_DISABLE_IT(&uartHandle, UART_IT_TC);
+        deReleasePending_ = false;
+        bool asserted = deAsserted_;
+        dePin_->port->BSRR = dePin_->pin;
+        deAsserted_ = true;
+        __set_PRIMASK(primask);
+
+        if(!asserted) waitSampleTimes_(deAssertionTime_);
+    #endif
+}
+
+void uart::HardwareUART::armDriverRelease_() {
+    #if !UART_HARDWARE_DE
+        if(!dePin_ || !deAsserted_) return;
+        // The flag is still set from the previous frame
+        __HAL_UART_CLEAR_FLAG(&uartHandle, UART_FLAG_TC);
+        __HAL_UART_ENABLE_IT(&uartHandle, UART_IT_TC);
+    #endif
+}
+
+void uart::HardwareUART::releaseDriverEnable_() {
+    #if !UART_HARDWARE_DE
+        // More data is about to be transmitted, so the pin stays asserted until the next frame is complete
+        if(txTransferLength_ || !txBuffer_.empty()) {
+            __HAL_UART_CLEAR_FLAG(&uartHandle, UART_FLAG_TC);
+            return;
+        }
+        __HAL_UART_DISABLE_IT(&uartHandle, UART_IT_TC);
+
+        if(deDeassertionTime_ == 0) {
+            dePin_->port->BSRR = dePin_->pin << 16;
+            deAsserted_ = false;
+            return;
+        }
+
+        // The deassertion timer releases the pin, so the interrupt handler doesn't wait for it
+        deReleaseTime_ = clock::getTimestamp() + sampleTicks_(deDeassertionTime_);
+        deReleasePending_ = true;
+        updateDriverRelease_();
+    #endif
+}
+
+void uart::HardwareUART::updateDriverRelease_() {
+    #if !UART_HARDWARE_DE
+        uint32_t now = clock::getTimestamp();
+        uint32_t next = UINT32_MAX;
+
+        for(int i = 0; i < UART_MAX_INSTANCES && instances_[i]; i++) {
+            HardwareUART* uart = instances_[i];
+            if(!uart->deReleasePending_) continue;
+
+            int32_t remaining = (int32_t)(uart->deReleaseTime_ - now);
+            if(remaining <= 0) {
+                uart->dePin_->port->BSRR = uart->dePin_->pin << 16;
+                uart->deAsserted_ = false;
+                uart->deReleasePending_ = false;
+            } else if((uint32_t)remaining < next) {
+                next = remaining;
+            }
+        }
+
+        // The timer is shared by all interfaces, so it is started for the earliest release
+        if(next != UINT32_MAX) {
+            __uart_de_timer_start((uint32_t)(((uint64_t)next * 1000000000 + clock::getTimestampFrequency() - 1) / clock::getTimestampFrequency()));
+        }
+    #endif
+}
+
+void uart::__uart_de_timer_irq_handler() {
+    HardwareUART::updateDriverRelease_();
+}
+
+uint32_t uart::HardwareUART::sampleTicks_(uint32_t count) const {
+    uint32_t samplesPerSecond = uartHandle.Init.BaudRate * (uartHandle.Init.OverSampling == UART_OVERSAMPLING_8 ? 8 : 16);
+    return (uint32_t)(((uint64_t)clock::getTimestampFrequency() * count + samplesPerSecond - 1) / samplesPerSecond);
+}
+
+void uart::HardwareUART::waitSampleTimes_(uint32_t count) {
+    if(count == 0) return;
+    uint32_t ticks = sampleTicks_(count);
+    uint32_t start = clock::getTimestamp();
+    while(clock::getTimestamp() - start < ticks);
+}
+
+void uart::HardwareUART::writeDataRegister_(DataFrame data) {
+    assertDriverEnable_();
+
+    // The transmission complete interrupt must not see the flag of the previous frame after being armed
+    uint32_t primask = __get_PRIMASK();
+    __disable_irq();
+    armDriverRelease_();
+    *__uart_tx_data_register(uartHandle.Instance) = data;
+    __set_PRIMASK(primask);
+}
+
+void uart::HardwareUART::txTransferComplete_(DMA_HandleTypeDef* handle) {
+    HardwareUART* uart = (HardwareUART*)handle->Parent;
+    // Errors which don't stop the transfer (e.g. FIFO errors on STM32F4) are reported as well
+    if(handle->State == HAL_DMA_STATE_BUSY) return;
+
+    uart->txBuffer_.consume(uart->txTransferLength_);
+    uart->txTransferLength_ = 0;
+    uart->startTxTransfer_();
+    uart->txComplete_.set();
+}
+
+void uart::HardwareUART::updateRxBuffer_() {
+    // The counter is reloaded when the DMA wraps around, so the position is always within the storage
+    size_t position = (rxBuffer_.capacity() - __HAL_DMA_GET_COUNTER(&rxDmaHandle_)) & (rxBuffer_.capacity() - 1);
+    // The half transfer and transfer complete interrupts ensure that this is called at least
+    // every half buffer, so the distance can't be ambiguous
+    size_t received = (position - rxDmaPosition_) & (rxBuffer_.capacity() - 1);
+    if(received == 0) return;
+
+    rxDmaPosition_ = position;
+    rxBuffer_.produce(received);
+    rxIdle_ = false;
+    rxReceived_.set();
+}
+
+void uart::HardwareUART::syncRxBuffer_() {
+    uint32_t primask = __get_PRIMASK();
+    __disable_irq();
+    updateRxBuffer_();
+    __set_PRIMASK(primask);
+
+    // The DMA has overwritten the oldest data if it got more than one buffer ahead
+    size_t available = rxBuffer_.available();
+    if(available > rxBuffer_.capacity()) {
+        rxBuffer_.consume(available - rxBuffer_.capacity());
+        rxOverrun_ = true;
+    }
+}
+
+bool uart::HardwareUART::waitForData_(uint32_t start, uint32_t timeout) {
+    while(!rxReceived_.isSet()) {
+        if(HAL_GetTick() - start >= timeout) return false;
+        yield;
+    }
+    rxReceived_.clear();
+    return true;
+}
+
+void uart::HardwareUART::rxTransferProgress_(DMA_HandleTypeDef* handle) {
+    ((HardwareUART*)handle->Parent)->updateRxBuffer_();
+}
+
+void uart::__uart_irq_handler(USART_TypeDef* instance) {
+    HardwareUART* uart = nullptr;
+    for(int i = 0; i < UART_MAX_INSTANCES && instances_[i]; i++) {
+        if(instances_[i]->uartHandle.Instance == instance) {
+            uart = instances_[i];
+            break;
+        }
+    }
+    if(!uart) return;
+
+    UART_HandleTypeDef* handle = &uart->uartHandle;
+    // On STM32F4, clearing any of the flags clears all of them, so the idle flag is checked first
+    bool idle = __HAL_UART_GET_FLAG(handle, UART_FLAG_IDLE);
+
+    // Without a clear register, reading SR above is the first half of the clearing sequence. The
+    // frame in DR is left to the DMA (or to the reader), whose read of DR clears the flags.
+    if(__HAL_UART_GET_FLAG(handle, UART_FLAG_ORE)) {
+        #if UART_CLEAR_REGISTER
+            __HAL_UART_CLEAR_OREFLAG(handle);
+        #endif
+        uart->rxOverrun_ = true;
+    }
+    #if UART_CLEAR_REGISTER
+        if(__HAL_UART_GET_FLAG(handle, UART_FLAG_FE)) __HAL_UART_CLEAR_FEFLAG(handle);
+        if(__HAL_UART_GET_FLAG(handle, UART_FLAG_NE)) __HAL_UART_CLEAR_NEFLAG(handle);
+    #endif
+
+    // The line became idle after a burst of data, so hand the data received so far to the reader
+    if(idle) {
+        __HAL_UART_CLEAR_IDLEFLAG(handle);
+        if(uart->rxDmaEnabled_) uart->updateRxBuffer_();
+        if(!uart->rxTimeoutEnabled_) {
+            uart->rxIdle_ = true;
+            uart->rxReceived_.set();
+        }
+    }
+
+    #if defined(USART_CR2_RTOEN)
+        if(uart->rxTimeoutEnabled_ && __HAL_UART_GET_FLAG(handle, UART_FLAG_RTOF)) {
+            __HAL_UART_CLEAR_FLAG(handle, UART_CLEAR_RTOF);
+            if(uart->rxDmaEnabled_) uart->updateRxBuffer_();
+            uart->rxIdle_ = true;
+            uart->rxReceived_.set();
+        }
+    #endif
+
+    #if !UART_HARDWARE_DE
+        if(uart->dePin_ && __HAL_UART_GET_IT_SOURCE(handle, UART_IT_TC) && __HAL_UART_GET_FLAG(handle, UART_FLAG_TC)) {
+            uart->releaseDriverEnable_();
+        }
+    #endif
+}
+
+size_t uart::HardwareUART::available() {
+    if(!rxDmaEnabled_) return 0;
+    syncRxBuffer_();
+    return rxBuffer_.available();
+}
+
+size_t uart::HardwareUART::read(uint8_t* data, size_t length, uint32_t timeout) {
+    if(!rxDmaEnabled_) {
+        if(!byteFrames_()) return UART_Base::read(data, length, timeout);
+
+        uint32_t start = HAL_GetTick();
+        for(size_t i = 0; i < length; i++) {
+            if(!waitForRxFrame_(start, timeout)) return i;
+            data[i] = *__uart_rx_data_register(uartHandle.Instance) & frameMask_();
+        }
+        return length;
+    }
+
+    uint32_t start = HAL_GetTick();
+    size_t received = 0;
+    while(true) {
+        syncRxBuffer_();
+        size_t count = rxBuffer_.read(data + received, length - received);
+        maskRxData_(data + received, count);
+        received += count;
+        if(received == length || !waitForData_(start, timeout)) return received;
+    }
+}
+
+size_t uart::HardwareUART::readUntil(uint8_t delimiter, uint8_t* data, size_t length, uint32_t timeout) {
+    if(!rxDmaEnabled_ || length == 0) return 0;
+
+    uint32_t start = HAL_GetTick();
+    uint8_t mask = frameMask_();
+    size_t scanned = 0;
+    while(true) {
+        syncRxBuffer_();
+        size_t available = rxBuffer_.available();
+        if(available > length) available = length;
+
+        // Only the newly received bytes need to be searched
+        for(; scanned < available; scanned++) {
+            if((rxBuffer_.peek(scanned) & mask) == delimiter) break;
+        }
+        if(scanned < available || available == length) {
+            size_t count = rxBuffer_.read(data, scanned < available ? scanned + 1 : length);
+            maskRxData_(data, count);
+            return count;
+        }
+
+        if(!waitForData_(start, timeout)) return 0;
+    }
+}
+
+size_t uart::HardwareUART::readUntilIdle(uint8_t* data, size_t length, uint32_t timeout) {
+    if(!rxDmaEnabled_) return UART_Base::readUntilIdle(data, length, timeout);
+
+    uint32_t start = HAL_GetTick();
+    size_t received = 0;
+    while(received < length) {
+        syncRxBuffer_();
+        size_t count = rxBuffer_.read(data + received, length - received);
+        maskRxData_(data + received, count);
+        received += count;
+        // Any data received after the idle line has cleared the flag again
+        if(received && rxIdle_ && rxBuffer_.empty()) break;
+
+        // Once the block has started, the timeout applies to the gap between the bytes
+        if(!waitForData_(received ? HAL_GetTick() : start, timeout)) break;
+    }
+    return received;
+}
+
+uint32_t uart::HardwareUART::setIdleTime(uint32_t bits) {
+    #if defined(USART_CR2_RTOEN)
+        if(IS_UART_RECEIVER_TIMEOUT_INSTANCE(uartHandle.Instance)) {
+            // The receiver timeout counts from the end of the last stop bit
+            rxTimeoutEnabled_ = bits != 0;
+            if(rxTimeoutEnabled_) {
+                if(bits > USART_RTOR_RTO) bits = USART_RTOR_RTO;
+                MODIFY_REG(uartHandle.Instance->RTOR, USART_RTOR_RTO, bits);
+                SET_BIT(uartHandle.Instance->CR2, USART_CR2_RTOEN);
+                __HAL_UART_CLEAR_FLAG(&uartHandle, UART_CLEAR_RTOF);
+                __HAL_UART_ENABLE_IT(&uartHandle, UART_IT_RTO);
+                return bits;
+            }
+            __HAL_UART_DISABLE_IT(&uartHandle, UART_IT_RTO);
+            CLEAR_BIT(uartHandle.Instance->CR2, USART_CR2_RTOEN);
+        }
+    #endif
+
+    // The idle line is detected after one frame: start bit, data bits (including parity) and stop bits
+    uint32_t frameBits = 1 + (uartHandle.Init.WordLength == UART_WORDLENGTH_9B ? 9 : 8) + (uartHandle.Init.StopBits == UART_STOPBITS_2 ? 2 : 1);
+    return frameBits;
+}
+
+int uart::HardwareUART::peek(size_t offset) {
+    if(available() <= offset) return -1;
+    return rxBuffer_.peek(offset) & frameMask_();
+}
+
+bool uart::HardwareUART::overrun() {
+    if(rxDmaEnabled_) syncRxBuffer_();
+    bool overrun = rxOverrun_;
+    rxOverrun_ = false;
+    return overrun;
+}
+
+void uart::HardwareUART::write(const uint8_t* data, size_t length) {
+    if(!txDmaEnabled_) {
+        if(!byteFrames_()) return UART_Base::write(data, length);
+
+        for(size_t i = 0; i < length; i++) {
+            if(!waitForFlag_(UART_FLAG_TXE, HAL_GetTick(), LIBEMBED_CONFIG_STM32_UART_DEFAULT_SEND_TIMEOUT)) return;
+            writeDataRegister_(data[i]);
+        }
+        return;
+    }
+
+    while(length) {
+        size_t written = txBuffer_.write(data, length);
+        data += written;
+        length -= written;
+        assertDriverEnable_();
+        startTxTransfer_();
+
+        // Wait for the DMA to make room in the transmit buffer
+        if(length) txComplete_.wait();
+    }
+}
+
+void uart::HardwareUART::flush() {
+    if(txDmaEnabled_) {
+        while(txTransferLength_ || !txBuffer_.empty()) yield;
+    }
+    // Wait for the last frame to leave the shift register
+    while(!__HAL_UART_GET_FLAG(&uartHandle, UART_FLAG_TC)) yield;
 }
 
 void uart::HardwareUART::writeFrame(DataFrame data, uint32_t timeout) {
-    if(uartHandle.Init.WordLength == UART_WORDLENGTH_8B) {
+    if(txDmaEnabled_) {
         uint8_t byte_data = data;
-        HAL_UART_Transmit(&uartHandle, &byte_data, 1, timeout);
-    } else {
-        HAL_UART_Transmit(&uartHandle, (uint8_t*)&data, 1, timeout);
+        write(&byte_data, 1);
+    } else if(waitForFlag_(UART_FLAG_TXE, HAL_GetTick(), timeout)) {
+        writeDataRegister_(data & frameMask_());
     }
 }
 
 uart::DataFrame uart::HardwareUART::recvFrame(uint32_t timeout) {
-    DataFrame recvData;
-    if(uartHandle.Init.WordLength == UART_WORDLENGTH_8B) {
+    DataFrame recvData = 0;
+    if(rxDmaEnabled_) {
         uint8_t recvData_byte;
-        HAL_UART_Receive(&uartHandle, &recvData_byte, 1, timeout);
-        recvData = recvData_byte;
-    } else {
-        HAL_UART_Receive(&uartHandle, (uint8_t*)&recvData, 1, timeout);
+        if(read(&recvData_byte, 1, timeout) == 1) recvData = recvData_byte;
+    } else if(waitForRxFrame_(HAL_GetTick(), timeout)) {
+        recvData = *__uart_rx_data_register(uartHandle.Instance) & frameMask_();
     }
     return recvData;
 }
 
+bool uart::HardwareUART::waitForFlag_(uint32_t flag, uint32_t start, uint32_t timeout) {
+    while(!__HAL_UART_GET_FLAG(&uartHandle, flag)) {
+        if(HAL_GetTick() - start >= timeout) return false;
+        yield;
+    }
+    return true;
+}
+
+bool uart::HardwareUART::waitForRxFrame_(uint32_t start, uint32_t timeout) {
+    if(!waitForFlag_(UART_FLAG_RXNE, start, timeout)) return false;
+
+    // The frame in the data register is still valid, but the following ones have been lost. Without a
+    // clear register, the caller reading the frame clears the flag.
+    if(__HAL_UART_GET_FLAG(&uartHandle, UART_FLAG_ORE)) {
+        #if UART_CLEAR_REGISTER
+            __HAL_UART_CLEAR_OREFLAG(&uartHandle);
+        #endif
+        rxOverrun_ = true;
+    }
+    return true;
+}
+
+uart::DataFrame uart::HardwareUART::frameMask_() const {
+    // The parity bit replaces the most significant data bit
+    DataFrame mask = uartHandle.Init.WordLength == UART_WORDLENGTH_9B ? 0x1FF : 0xFF;
+    if(uartHandle.Init.Parity != UART_PARITY_NONE) mask >>= 1;
+    return mask;
+}
+
+bool uart::HardwareUART::byteFrames_() const {
+    // With parity, a 9-bit word holds 8 data bits
+    return frameMask_() <= 0xFF;
+}
+
+void uart::HardwareUART::maskRxData_(uint8_t* data, size_t length) const {
+    uint8_t mask = frameMask_();
+    if(mask == 0xFF) return;
+    for(size_t i = 0; i < length; i++) data[i] &= mask;
+}
+
 #endif /* LIBEMBED_PLATFORM == ststm32 */
\ No newline at end of file
@@ -1,12 +1,58 @@
 #include <libembed/arch/arm/stm32/stm32_hal.h>
+#include "dma_types.h"
 
 namespace embed::arch::arm::stm32::uart {
     void __uart_clock_enable();
+
+    /**
+     * @brief Gets the frequency of the kernel clock of a UART interface in Hz.
+     */
+    uint32_t __uart_clock_frequency(USART_TypeDef* uart);
+
+    /**
+     * @brief Gets the address of the transmit data register of a UART interface.
+     *
+     * This is `DR` on STM32F4 and `TDR` on STM32G0.
+     */
+    volatile uint32_t* __uart_tx_data_register(USART_TypeDef* uart);
+
+    /**
+     * @brief Gets the address of the receive data register of a UART interface.
+     *
+     * This is `DR` on STM32F4 and `RDR` on STM32G0.
+     */
+    volatile uint32_t* __uart_rx_data_register(USART_TypeDef* uart);
+
+    /**
+     * @brief Handles the interrupt of a UART interface. Called by the handlers installed for the interfaces.
+     */
+    void __uart_irq_handler(USART_TypeDef* uart);
+
+    /**
+     * @brief Starts the one-shot timer releasing the RS-485 driver enable pins, replacing any
+     * running delay. Only implemented by devices whose USART has no DE output.
+     *
+     * @param nanoseconds The delay until @ref __uart_de_timer_irq_handler() is called.
+     */
+    void __uart_de_timer_start(uint32_t nanoseconds);
+
+    /**
+     * @brief Handles the interrupt of the driver enable timer. Called by the handler installed for it.
+     */
+    void __uart_de_timer_irq_handler();
 }
 
 namespace embed::uart {
     struct __UART_HardwareInterface {
         USART_TypeDef* hwInterfacePtr;
         uint32_t gpioAlternateFunctionID;
+        //! Interrupt of the interface
+        IRQn_Type irq;
+        //! Handler of the interrupt, installed by `HardwareUART::begin()`
+        void (*irqHandler)();
+        //! DMA stream used for transmitting
+        embed::arch::arm::stm32::dma::__DMA_Request txDma;
+        //! DMA stream used for receiving
+        embed::arch::arm::stm32::dma::__DMA_Request rxDma;
     };
-}
\ No newline at end of file
+}
@@ -5,6 +5,9 @@
 
 #if LIBEMBED_BOARD_DISCO_F412ZG
 
+    #undef LIBEMBED_DEBUG_MODULE
+    #define LIBEMBED_DEBUG_MODULE embed::debug::MODULE_BSP
+
     using namespace embed;
 
     gpio::DigitalOutput board::LD1(gpio::PE0, true);
@@ -55,8 +58,8 @@
     gpio::_GPIO_Pin_specific& board::arduino::D14 = gpio::PB9;
     gpio::_GPIO_Pin_specific& board::arduino::D15 = gpio::PB10;
 
-    static void __vcp_write(std::string data) {
-        board::UART_VCP.write(data);
+    static void __vcp_write(const uint8_t* data, size_t length) {
+        board::UART_VCP.write(data, length);
     }
 
     void board::disco_f412zg::beginVCP(uart::Baudrate baudrate) {
@@ -65,10 +68,13 @@
         board::UART_VCP.begin(baudrate);
 
         #if LIBEMBED_CONFIG_ENABLE_DEBUGGING
-            debug::writeStringPtr = __vcp_write;
+            debug::addSink(__vcp_write);
+            #if LIBEMBED_CONFIG_ENABLE_COROUTINES
+                debug::startDrainCoroutine();
+            #endif
         #endif
 
-        libembed_debug_info("VCP initialized by BSP.")
+        libembed_debug_info("VCP initialized by BSP.");
     }
 
 #endif
\ No newline at end of file
@@ -5,6 +5,9 @@
 
 #if LIBEMBED_BOARD_NUCLEO_F412ZG
 
+    #undef LIBEMBED_DEBUG_MODULE
+    #define LIBEMBED_DEBUG_MODULE embed::debug::MODULE_BSP
+
     using namespace embed;
 
     gpio::DigitalOutput board::LD1(gpio::PB0, false);
@@ -22,8 +25,8 @@
     gpio::_GPIO_Pin_specific& board::UART_VCP_TX = gpio::PD8;
     gpio::_GPIO_Pin_specific& board::UART_VCP_RX = gpio::PD9;
 
-    static void __vcp_write(std::string data) {
-        board::UART_VCP.write(data);
+    static void __vcp_write(const uint8_t* data, size_t length) {
+        board::UART_VCP.write(data, length);
     }
 
     void board::nucleo_f412zg::beginVCP(uart::Baudrate baudrate) {
@@ -32,10 +35,13 @@
         board::UART_VCP.begin(baudrate);
 
         #if LIBEMBED_CONFIG_ENABLE_DEBUGGING
-            debug::writeStringPtr = __vcp_write;
+            debug::addSink(__vcp_write);
+            #if LIBEMBED_CONFIG_ENABLE_COROUTINES
+                debug::startDrainCoroutine();
+            #endif
         #endif
 
-        libembed_debug_info("VCP initialized by BSP.")
+        libembed_debug_info("VCP initialized by BSP.");
     }
 
 #endif
\ No newline at end of file
@@ -0,0 +1,43 @@
+#include <libembed/hal/clock/types.h>
+#include <libembed/hal/uart/virtual.h>
+#include <chrono>
+#include <thread>
+
+// Host builds (e.g. the virtual UART examples) have no hardware counter, so the timestamp counts
+// nanoseconds of the steady clock or of a virtual line
+#if !__ARM_ARCH
+
+using namespace embed;
+
+// Virtual time spent by one iteration of a loop polling the timestamp, in nanoseconds
+#define VIRTUAL_POLL_TIME 100
+
+// Line driving the timestamp counter, or nullptr for the steady clock
+static uart::VirtualLine* clockLine_ = nullptr;
+
+void uart::VirtualLine::useAsClock() {
+    clockLine_ = this;
+}
+
+void clock::init() { }
+
+void clock::setMaximumFrequency() { }
+
+void clock::delay(unsigned int milliseconds) {
+    if(clockLine_) clockLine_->advance((uint64_t)milliseconds * 1000000);
+    else std::this_thread::sleep_for(std::chrono::milliseconds(milliseconds));
+}
+
+uint32_t clock::getTimestamp() {
+    if(clockLine_) {
+        clockLine_->advance(VIRTUAL_POLL_TIME);
+        return (uint32_t)clockLine_->time();
+    }
+    return (uint32_t)std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now().time_since_epoch()).count();
+}
+
+uint32_t clock::getTimestampFrequency() {
+    return 1000000000;
+}
+
+#endif
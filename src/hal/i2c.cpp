@@ -1,6 +1,58 @@
-#include <libembed/hal/i2c.h>
+#include <libembed/hal/i2c/types.h>
 
 using namespace embed;
 
 i2c::I2C_Master_Base::I2C_Master_Base() { }
-i2c::HardwareI2C_Master_Base::HardwareI2C_Master_Base(i2c::I2C_HardwareInterface& interface) : interface(interface) { }
\ No newline at end of file
+i2c::HardwareI2C_Master_Base::HardwareI2C_Master_Base(i2c::I2C_HardwareInterface& interface) : interface(interface) { }
+
+void i2c::I2C_Master_Base::countTransaction_(TransactionResult result, size_t bytes) {
+    switch(result) {
+        case RESULT_OK:
+            statistics_.transactions++;
+            statistics_.bytes += bytes;
+            break;
+        case RESULT_ADDRESS_NACK:
+        case RESULT_DATA_NACK: statistics_.nacks++; break;
+        case RESULT_ARBITRATION_LOST: statistics_.arbitrationLosses++; break;
+        case RESULT_BUS_ERROR: statistics_.busErrors++; break;
+        case RESULT_TIMEOUT: statistics_.timeouts++; break;
+    }
+}
+
+i2c::TransactionResult i2c::I2C_Master_Base::write(Address_7B address, const uint8_t* data, size_t length, uint32_t timeout) {
+    return writeRead(address, data, length, nullptr, 0, timeout);
+}
+
+i2c::TransactionResult i2c::I2C_Master_Base::read(Address_7B address, uint8_t* data, size_t length, uint32_t timeout) {
+    return writeRead(address, nullptr, 0, data, length, timeout);
+}
+
+i2c::TransactionResult i2c::I2C_Master_Base::writeRead(Address_7B address, const uint8_t* txData, size_t txLength, uint8_t* rxData, size_t rxLength, uint32_t timeout) {
+    TransactionResult result = RESULT_OK;
+
+    // A read without a write phase starts with the read address right away
+    if(txLength > 0 || rxLength == 0) {
+        if(startMessage(address, WRITE) == NACK) {
+            result = RESULT_ADDRESS_NACK;
+        } else {
+            for(size_t i = 0; i < txLength; i++) {
+                if(sendByte(txData[i]) == NACK) {
+                    result = RESULT_DATA_NACK;
+                    break;
+                }
+            }
+        }
+    }
+
+    if(result == RESULT_OK && rxLength > 0) {
+        if(startMessage(address, READ) == NACK) {
+            result = RESULT_ADDRESS_NACK;
+        } else {
+            for(size_t i = 0; i < rxLength; i++) rxData[i] = readByte(i + 1 < rxLength ? ACK : NACK);
+        }
+    }
+
+    stopMessage();
+    countTransaction_(result, txLength + rxLength);
+    return result;
+}
@@ -0,0 +1,43 @@
+#include <libembed/hal/i2c/queue.h>
+
+using namespace embed;
+
+void i2c::TransactionQueue::submit(Transaction& transaction) {
+    transaction.completed.clear();
+    transaction.next_ = nullptr;
+
+    // Insert behind all transactions with the same or a higher priority
+    Transaction** link = &head_;
+    while(*link && (*link)->priority >= transaction.priority) link = &(*link)->next_;
+    transaction.next_ = *link;
+    *link = &transaction;
+}
+
+i2c::TransactionResult i2c::TransactionQueue::execute(Transaction& transaction) {
+    submit(transaction);
+    return transaction.wait();
+}
+
+bool i2c::TransactionQueue::poll() {
+    Transaction* transaction = head_;
+    if(!transaction) return false;
+    head_ = transaction->next_;
+    transaction->next_ = nullptr;
+
+    transaction->result = master_.writeRead(transaction->address, transaction->txData, transaction->txLength,
+        transaction->rxData, transaction->rxLength, transaction->timeout);
+    transaction->completed.set();
+    return true;
+}
+
+void i2c::TransactionQueue::run() {
+    while(true) {
+        if(!poll()) yield;
+    }
+}
+
+size_t i2c::TransactionQueue::pending() const {
+    size_t count = 0;
+    for(Transaction* transaction = head_; transaction; transaction = transaction->next_) count++;
+    return count;
+}
@@ -0,0 +1,213 @@
+#include <libembed/hal/i2c/virtual.h>
+
+using namespace embed;
+
+// *** i2c::VirtualEEPROM ***
+
+bool i2c::VirtualEEPROM::start(Direction direction) {
+    // The EEPROM doesn't respond during the write cycle
+    if(bus_ && bus_->time() < busyUntil_) return false;
+    addressReceived_ = direction == READ ? addressBytes_ : 0;
+    return true;
+}
+
+bool i2c::VirtualEEPROM::write(uint8_t data) {
+    if(addressReceived_ < addressBytes_) {
+        pointer_ = (addressReceived_ == 0 ? 0 : pointer_ << 8) | data;
+        if(++addressReceived_ == addressBytes_) pointer_ %= size_;
+        return true;
+    }
+
+    memory_[pointer_] = data;
+    size_t page = pointer_ - pointer_ % pageSize_;
+    pointer_ = page + (pointer_ + 1 - page) % pageSize_;
+    written_ = true;
+    return true;
+}
+
+uint8_t i2c::VirtualEEPROM::read() {
+    uint8_t data = memory_[pointer_];
+    pointer_ = (pointer_ + 1) % size_;
+    return data;
+}
+
+void i2c::VirtualEEPROM::stop() {
+    if(written_ && bus_) busyUntil_ = bus_->time() + writeTime_;
+    written_ = false;
+}
+
+// *** i2c::VirtualRegisterDevice ***
+
+void i2c::VirtualRegisterDevice::notify_() {
+    if(writtenLength_ && file_.written) file_.written(writtenAddress_, writtenLength_);
+    writtenLength_ = 0;
+}
+
+bool i2c::VirtualRegisterDevice::start(Direction direction) {
+    // A repeated start ends the write like a stop condition
+    notify_();
+    addressReceived_ = direction == READ;
+    return true;
+}
+
+bool i2c::VirtualRegisterDevice::write(uint8_t data) {
+    if(!addressReceived_) {
+        pointer_ = data;
+        addressReceived_ = true;
+        return true;
+    }
+
+    if(pointer_ < file_.firstWritable || pointer_ >= file_.size) return false;
+    if(writtenLength_ == 0) writtenAddress_ = pointer_;
+    file_.registers[pointer_++] = data;
+    writtenLength_++;
+    return true;
+}
+
+uint8_t i2c::VirtualRegisterDevice::read() {
+    uint8_t data = pointer_ < file_.size ? file_.registers[pointer_] : 0xFF;
+    pointer_++;
+    return data;
+}
+
+void i2c::VirtualRegisterDevice::stop() {
+    notify_();
+}
+
+// *** i2c::VirtualBus ***
+
+void i2c::VirtualBus::begin(ClockFrequency freq) {
+    bitTime_ = freq ? 1000000000 / freq : 0;
+}
+
+void i2c::VirtualBus::attach(VirtualDevice& device, Address_7B address) {
+    device.bus_ = this;
+    device.address_ = address;
+    device.next_ = devices_;
+    devices_ = &device;
+}
+
+void i2c::VirtualBus::detach(VirtualDevice& device) {
+    for(VirtualDevice** link = &devices_; *link; link = &(*link)->next_) {
+        if(*link == &device) {
+            *link = device.next_;
+            break;
+        }
+    }
+    if(current_ == &device) current_ = nullptr;
+    device.next_ = nullptr;
+    device.bus_ = nullptr;
+}
+
+uint32_t i2c::VirtualBus::nextRandom_() {
+    random_ ^= random_ << 13;
+    random_ ^= random_ >> 17;
+    random_ ^= random_ << 5;
+    return random_;
+}
+
+bool i2c::VirtualBus::inject_(uint32_t interval) {
+    return interval && nextRandom_() % interval == 0;
+}
+
+void i2c::VirtualBus::setFaults(uint32_t nackInterval, uint32_t arbitrationInterval, uint32_t seed) {
+    nackInterval_ = nackInterval;
+    arbitrationInterval_ = arbitrationInterval;
+    random_ = seed ? seed : 0x12345678;
+}
+
+void i2c::VirtualBus::setClockStretching(uint32_t nanoseconds, uint32_t interval) {
+    stretchTime_ = nanoseconds;
+    stretchInterval_ = interval;
+}
+
+void i2c::VirtualBus::transferByte_() {
+    // 8 data bits and the acknowledgement bit
+    time_ += 9 * bitTime_;
+    if(inject_(stretchInterval_)) time_ += stretchTime_;
+}
+
+i2c::TransactionResult i2c::VirtualBus::start_(Address_7B address, Direction direction) {
+    time_ += bitTime_;
+    active_ = true;
+
+    VirtualDevice* device = devices_;
+    while(device && device->address_ != address) device = device->next_;
+
+    // Addressing another device ends the transfer with the previous one
+    if(current_ && current_ != device) current_->stop();
+    current_ = nullptr;
+
+    if(inject_(arbitrationInterval_)) {
+        // The other master wins within the address byte, and the bus is released to it
+        time_ += (1 + nextRandom_() % 8) * bitTime_;
+        active_ = false;
+        return RESULT_ARBITRATION_LOST;
+    }
+
+    transferByte_();
+    if(!device || !device->start(direction) || inject_(nackInterval_)) return RESULT_ADDRESS_NACK;
+    current_ = device;
+    return RESULT_OK;
+}
+
+i2c::TransactionResult i2c::VirtualBus::send_(uint8_t data) {
+    transferByte_();
+    if(!current_ || !current_->write(data) || inject_(nackInterval_)) return RESULT_DATA_NACK;
+    return RESULT_OK;
+}
+
+uint8_t i2c::VirtualBus::receive_() {
+    transferByte_();
+    return current_ ? current_->read() : 0xFF;
+}
+
+void i2c::VirtualBus::stop_() {
+    if(!active_) return;
+    time_ += bitTime_;
+    if(current_) current_->stop();
+    current_ = nullptr;
+    active_ = false;
+}
+
+i2c::AcknowledgementType i2c::VirtualBus::startMessage(Address_7B address, Direction direction) {
+    return start_(address, direction) == RESULT_OK ? ACK : NACK;
+}
+
+void i2c::VirtualBus::stopMessage() {
+    stop_();
+}
+
+i2c::AcknowledgementType i2c::VirtualBus::sendByte(uint8_t data) {
+    return send_(data) == RESULT_OK ? ACK : NACK;
+}
+
+uint8_t i2c::VirtualBus::readByte(AcknowledgementType ackType) {
+    return receive_();
+}
+
+i2c::TransactionResult i2c::VirtualBus::writeRead(Address_7B address, const uint8_t* txData, size_t txLength, uint8_t* rxData, size_t rxLength, uint32_t timeout) {
+    uint64_t deadline = time_ + (uint64_t)timeout * 1000000;
+    TransactionResult result = RESULT_OK;
+
+    // A read without a write phase starts with the read address right away
+    if(txLength > 0 || rxLength == 0) {
+        result = start_(address, WRITE);
+        for(size_t i = 0; i < txLength && result == RESULT_OK; i++) {
+            result = send_(txData[i]);
+            if(result == RESULT_OK && time_ > deadline) result = RESULT_TIMEOUT;
+        }
+    }
+
+    if(result == RESULT_OK && rxLength > 0) {
+        result = start_(address, READ);
+        for(size_t i = 0; i < rxLength && result == RESULT_OK; i++) {
+            rxData[i] = receive_();
+            if(time_ > deadline) result = RESULT_TIMEOUT;
+        }
+    }
+
+    stop_();
+    countTransaction_(result, txLength + rxLength);
+    return result;
+}
@@ -1,12 +1,42 @@
-#include <libembed/hal/uart.h>
+#include <libembed/hal/uart/types.h>
 
 using namespace embed;
 
 uart::UART_Base::UART_Base() { }
 uart::HardwareUART_Base::HardwareUART_Base(uart::UART_HardwareInterface& interface) : UART_Base(), interface(interface) { }
 
-void uart::UART_Base::write(std::string data) {
-    for(char currentChar : data) {
-        writeFrame(currentChar);
+void uart::UART_Base::write(const uint8_t* data, size_t length) {
+    for(size_t i = 0; i < length; i++) {
+        writeFrame(data[i]);
     }
-}
\ No newline at end of file
+}
+
+size_t uart::UART_Base::read(uint8_t* data, size_t length, uint32_t timeout) {
+    for(size_t i = 0; i < length; i++) {
+        data[i] = recvFrame(timeout);
+    }
+    return length;
+}
+
+size_t uart::UART_Base::readUntilIdle(uint8_t* data, size_t length, uint32_t timeout) {
+    if(length == 0 || read(data, 1, timeout) == 0) return 0;
+
+    size_t received = 1;
+    while(received < length) {
+        size_t count = available();
+        if(count == 0) break;
+        if(count > length - received) count = length - received;
+        received += read(data + received, count, 0);
+    }
+    return received;
+}
+
+uint32_t uart::UART_Base::setIdleTime(uint32_t bits) {
+    return 0;
+}
+
+size_t uart::UART_Base::available() {
+    return 0;
+}
+
+void uart::UART_Base::flush() { }
\ No newline at end of file
@@ -0,0 +1,66 @@
+#include <libembed/hal/uart/virtual.h>
+
+using namespace embed;
+
+void uart::VirtualUART::begin(Baudrate baudrate, uint8_t wordLength, ParityMode parityMode, StopBitMode stopBitMode) {
+    // Start bit, word (including the parity bit) and stop bits, as on the hardware UARTs
+    uint32_t bits = 1 + wordLength + (stopBitMode == STOPBIT_2 ? 2 : 1);
+    uint32_t dataBits = wordLength - (parityMode != PARITY_DISABLED ? 1 : 0);
+    frameTime_ = baudrate ? (uint64_t)bits * 1000000000 / baudrate : 0;
+    frameMask_ = (DataFrame)((1u << dataBits) - 1);
+    rxBuffer_.reset();
+}
+
+uint32_t uart::VirtualUART::nextRandom_() {
+    random_ ^= random_ << 13;
+    random_ ^= random_ >> 17;
+    random_ ^= random_ << 5;
+    return random_;
+}
+
+void uart::VirtualUART::setErrorRate(uint32_t corruptInterval, uint32_t dropInterval, uint32_t seed) {
+    corruptInterval_ = corruptInterval;
+    dropInterval_ = dropInterval;
+    random_ = seed ? seed : 0x12345678;
+}
+
+void uart::VirtualUART::receive_(DataFrame data) {
+    received_++;
+    if(dropInterval_ && nextRandom_() % dropInterval_ == 0) {
+        errors_++;
+        return;
+    }
+    if(corruptInterval_ && nextRandom_() % corruptInterval_ == 0) {
+        data ^= 1 << (nextRandom_() % 8);
+        errors_++;
+    }
+    if(!rxBuffer_.push(data & frameMask_)) overruns_++;
+}
+
+void uart::VirtualUART::writeFrame(DataFrame data, uint32_t timeout) {
+    line_.advance(frameTime_);
+    transmitted_++;
+    peer_.receive_(data);
+}
+
+uart::DataFrame uart::VirtualUART::recvFrame(uint32_t timeout) {
+    DataFrame data = 0;
+    if(!rxBuffer_.pop(data)) line_.advance((uint64_t)timeout * 1000000);
+    return data;
+}
+
+void uart::VirtualUART::write(const uint8_t* data, size_t length) {
+    for(size_t i = 0; i < length; i++) writeFrame(data[i]);
+}
+
+size_t uart::VirtualUART::read(uint8_t* data, size_t length, uint32_t timeout) {
+    size_t received = 0;
+    DataFrame frame;
+    while(received < length && rxBuffer_.pop(frame)) data[received++] = frame;
+    if(received < length) line_.advance((uint64_t)timeout * 1000000);
+    return received;
+}
+
+size_t uart::VirtualUART::available() {
+    return rxBuffer_.available();
+}
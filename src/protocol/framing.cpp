@@ -0,0 +1,209 @@
+#include <libembed/protocol/framing.h>
+
+using namespace embed;
+
+// SLIP special characters (RFC 1055)
+static constexpr uint8_t SLIP_END = 0xC0;
+static constexpr uint8_t SLIP_ESC = 0xDB;
+static constexpr uint8_t SLIP_ESC_END = 0xDC;
+static constexpr uint8_t SLIP_ESC_ESC = 0xDD;
+
+size_t framing::__Checksum::bytes(uint8_t* data) const {
+    switch(type_) {
+        case CHECKSUM_CRC16: {
+            uint16_t crc = crc16_.value();
+            data[0] = crc >> 8;
+            data[1] = crc & 0xFF;
+            return crc::CRC16::SIZE;
+        }
+        case CHECKSUM_CRC32: {
+            uint32_t crc = crc32_.value();
+            for(size_t i = 0; i < crc::CRC32::SIZE; i++) data[i] = (crc >> (8 * i)) & 0xFF;
+            return crc::CRC32::SIZE;
+        }
+        default:
+            return 0;
+    }
+}
+
+bool framing::__Checksum::valid() const {
+    switch(type_) {
+        case CHECKSUM_CRC16: return crc16_.value() == crc::CRC16::RESIDUE;
+        case CHECKSUM_CRC32: return crc32_.value() == crc::CRC32::RESIDUE;
+        default: return true;
+    }
+}
+
+void framing::Decoder::reset() {
+    length_ = 0;
+    started_ = false;
+    invalid_ = false;
+    overflow_ = false;
+    remaining_ = 0;
+    code_ = 0;
+    escaped_ = false;
+    checksum_.reset();
+}
+
+framing::DecodeResult framing::Decoder::finish_(bool valid) {
+    DecodeResult result;
+    if(overflow_) result = DECODE_ERROR_OVERFLOW;
+    else if(!valid || invalid_ || length_ < checksum_.size()) result = DECODE_ERROR_FRAMING;
+    else if(!checksum_.valid()) result = DECODE_ERROR_CHECKSUM;
+    else {
+        packetLength_ = length_ - checksum_.size();
+        result = DECODE_PACKET;
+    }
+    reset();
+    return result;
+}
+
+framing::DecodeResult framing::Decoder::feed(uint8_t byte) {
+    if(framing_ == FRAMING_COBS) {
+        if(byte == 0) {
+            // Consecutive delimiters are allowed, they don't produce empty packets
+            if(!started_) return DECODE_PENDING;
+            // The last block must be complete
+            return finish_(remaining_ == 0);
+        }
+
+        started_ = true;
+        if(remaining_) {
+            put_(byte);
+            remaining_--;
+        } else {
+            // Code byte: every block except for the last one and full blocks is followed by a
+            // zero, which is only added once it is clear that another block follows
+            if(code_ && code_ != 0xFF) put_(0);
+            code_ = byte;
+            remaining_ = byte - 1;
+        }
+        return DECODE_PENDING;
+    }
+
+    if(byte == SLIP_END) {
+        if(!started_) return DECODE_PENDING;
+        return finish_(!escaped_);
+    }
+
+    started_ = true;
+    if(escaped_) {
+        escaped_ = false;
+        if(byte == SLIP_ESC_END) put_(SLIP_END);
+        else if(byte == SLIP_ESC_ESC) put_(SLIP_ESC);
+        else invalid_ = true;
+    } else if(byte == SLIP_ESC) {
+        escaped_ = true;
+    } else {
+        put_(byte);
+    }
+    return DECODE_PENDING;
+}
+
+void framing::Encoder::flush_() {
+    if(length_) uart_.write(buffer_, length_);
+    length_ = 0;
+}
+
+void framing::Encoder::put_(uint8_t byte) {
+    if(framing_ == FRAMING_COBS) {
+        // The block is only written once its length, i.e. its code byte, is known
+        if(byte == 0) {
+            buffer_[0] = length_;
+            flush_();
+            length_ = 1;
+            return;
+        }
+        buffer_[length_++] = byte;
+        if(length_ == sizeof(buffer_)) {
+            buffer_[0] = 0xFF;
+            flush_();
+            length_ = 1;
+        }
+        return;
+    }
+
+    if(length_ > sizeof(buffer_) - 2) flush_();
+    if(byte == SLIP_END) {
+        buffer_[length_++] = SLIP_ESC;
+        buffer_[length_++] = SLIP_ESC_END;
+    } else if(byte == SLIP_ESC) {
+        buffer_[length_++] = SLIP_ESC;
+        buffer_[length_++] = SLIP_ESC_ESC;
+    } else {
+        buffer_[length_++] = byte;
+    }
+}
+
+void framing::Encoder::begin() {
+    checksum_.reset();
+    if(framing_ == FRAMING_COBS) {
+        // Space for the code byte
+        length_ = 1;
+    } else {
+        // A leading END flushes any line noise received before the packet
+        length_ = 0;
+        buffer_[length_++] = SLIP_END;
+    }
+}
+
+void framing::Encoder::write(const uint8_t* data, size_t length) {
+    while(length--) {
+        checksum_.update(*data);
+        put_(*data++);
+    }
+}
+
+void framing::Encoder::end() {
+    uint8_t checksum[crc::CRC32::SIZE];
+    size_t checksumLength = checksum_.bytes(checksum);
+    for(size_t i = 0; i < checksumLength; i++) put_(checksum[i]);
+
+    if(framing_ == FRAMING_COBS) {
+        buffer_[0] = length_;
+        // put_() never leaves the buffer full, so the delimiter always fits
+        buffer_[length_++] = 0;
+    } else {
+        if(length_ == sizeof(buffer_)) flush_();
+        buffer_[length_++] = SLIP_END;
+    }
+    flush_();
+}
+
+void framing::Link::send(const uint8_t* data, size_t length) {
+    encoder_.begin();
+    encoder_.write(data, length);
+    encoder_.end();
+}
+
+size_t framing::Link::receive(uint32_t timeout) {
+    while(true) {
+        if(pendingStart_ == pendingLength_) {
+            // Read everything which is already available at once, or wait for a single byte
+            size_t count = uart_.available();
+            if(count > sizeof(pending_)) count = sizeof(pending_);
+            if(count == 0) count = 1;
+            pendingStart_ = 0;
+            pendingLength_ = uart_.read(pending_, count, timeout);
+            if(pendingLength_ == 0) return 0;
+        }
+
+        while(pendingStart_ < pendingLength_) {
+            switch(decoder_.feed(pending_[pendingStart_++])) {
+                case DECODE_PACKET:
+                    // Empty packets can't be told apart from a timeout, so they are ignored
+                    if(decoder_.length()) return decoder_.length();
+                    break;
+                case DECODE_ERROR_CHECKSUM:
+                    checksumErrors_++;
+                    break;
+                case DECODE_ERROR_FRAMING:
+                case DECODE_ERROR_OVERFLOW:
+                    framingErrors_++;
+                    break;
+                default:
+                    break;
+            }
+        }
+    }
+}
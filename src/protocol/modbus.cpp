@@ -0,0 +1,140 @@
+#include <libembed/protocol/modbus.h>
+#include <libembed/hal/clock/types.h>
+#include <libembed/util/coroutines.h>
+
+using namespace embed;
+
+// Modbus transmits 16-bit values in big-endian byte order
+
+static uint16_t read16_(const uint8_t* data) {
+    return (data[0] << 8) | data[1];
+}
+
+static void write16_(uint8_t* data, uint16_t value) {
+    data[0] = value >> 8;
+    data[1] = value & 0xFF;
+}
+
+void modbus::Slave::begin(uart::Baudrate baudrate) {
+    // 3.5 characters of 11 bits, rounded up to full bits
+    uint32_t gapBits = baudrate > 19200 ? (uint32_t)(((uint64_t)baudrate * 1750 + 999999) / 1000000) : 39;
+
+    // The UART may detect the end of a frame before the gap has elapsed, e.g. after a single
+    // idle frame. The rest of the gap is waited for before responding.
+    uint32_t idleBits = uart_.setIdleTime(gapBits);
+    uint32_t remainingBits = idleBits == 0 ? gapBits : idleBits < gapBits ? gapBits - idleBits : 0;
+
+    // Gaps of up to 1.5 characters (0.75 ms above 19200 baud) are allowed within a frame, so data
+    // arriving that long after an earlier idle detection still belongs to the request
+    uint32_t charGapBits = baudrate > 19200 ? (uint32_t)(((uint64_t)baudrate * 750 + 999999) / 1000000) : 17;
+    uint32_t continuationBits = idleBits < charGapBits ? charGapBits - idleBits : 0;
+
+    uint32_t frequency = clock::getTimestampFrequency();
+    turnaroundTicks_ = (uint32_t)((uint64_t)frequency * remainingBits / baudrate);
+    continuationTicks_ = (uint32_t)(((uint64_t)frequency * continuationBits + baudrate - 1) / baudrate);
+    characterTicks_ = (uint32_t)((uint64_t)frequency * 11 / baudrate);
+}
+
+bool modbus::Slave::poll(uint32_t timeout) {
+    size_t length = uart_.readUntilIdle(frame_, sizeof(frame_), timeout);
+    uint32_t received = clock::getTimestamp();
+
+    // The UART may report the idle line within a frame. The frame only ends once no data has
+    // arrived for 1.5 characters, which is shorter than a character after the detection.
+    while(length && length < sizeof(frame_) && continuationTicks_) {
+        while(!uart_.available() && clock::getTimestamp() - received < continuationTicks_);
+        if(!uart_.available()) break;
+        length += uart_.readUntilIdle(frame_ + length, sizeof(frame_) - length, timeout);
+        received = clock::getTimestamp();
+    }
+
+    // A frame has at least an address, a function code and the CRC
+    if(length < 4) return false;
+    bool broadcast = frame_[0] == 0;
+    if(frame_[0] != address_ && !broadcast) return false;
+
+    if(crc::CRC16Modbus::compute(frame_, length) != crc::CRC16Modbus::RESIDUE) {
+        crcErrors_++;
+        return false;
+    }
+
+    requests_++;
+    size_t responseLength = process_(length - crc::CRC16Modbus::SIZE);
+    if(broadcast) return true;
+
+    uint16_t crc = crc::CRC16Modbus::compute(frame_, responseLength);
+    frame_[responseLength++] = crc & 0xFF;
+    frame_[responseLength++] = crc >> 8;
+
+    // Hold the response back until the line has been silent for 3.5 characters. Other coroutines
+    // only get to run while they can't delay the response beyond the gap.
+    uint32_t elapsed;
+    while((elapsed = clock::getTimestamp() - received) < turnaroundTicks_) {
+        if(turnaroundTicks_ - elapsed > characterTicks_) yield;
+    }
+    uart_.write(frame_, responseLength);
+    return true;
+}
+
+void modbus::Slave::run() {
+    while(true) poll();
+}
+
+size_t modbus::Slave::exception_(ExceptionCode code) {
+    exceptions_++;
+    frame_[1] |= 0x80;
+    frame_[2] = code;
+    return 3;
+}
+
+size_t modbus::Slave::process_(size_t length) {
+    // The response is built in place of the request
+    uint8_t function = frame_[1];
+    switch(function) {
+        case FUNCTION_READ_HOLDING_REGISTERS:
+        case FUNCTION_READ_INPUT_REGISTERS: {
+            if(length != 6) return exception_(EXCEPTION_ILLEGAL_DATA_VALUE);
+            uint16_t address = read16_(frame_ + 2);
+            uint16_t count = read16_(frame_ + 4);
+            bool holding = function == FUNCTION_READ_HOLDING_REGISTERS;
+            const uint16_t* registers = holding ? table_.holdingRegisters : table_.inputRegisters;
+            uint16_t registerCount = holding ? table_.holdingRegisterCount : table_.inputRegisterCount;
+
+            if(count == 0 || count > 125) return exception_(EXCEPTION_ILLEGAL_DATA_VALUE);
+            if((uint32_t)address + count > registerCount) return exception_(EXCEPTION_ILLEGAL_DATA_ADDRESS);
+
+            frame_[2] = count * 2;
+            for(uint16_t i = 0; i < count; i++) write16_(frame_ + 3 + 2 * i, registers[address + i]);
+            return 3 + count * 2;
+        }
+
+        case FUNCTION_WRITE_SINGLE_REGISTER: {
+            if(length != 6) return exception_(EXCEPTION_ILLEGAL_DATA_VALUE);
+            uint16_t address = read16_(frame_ + 2);
+            if(address >= table_.holdingRegisterCount) return exception_(EXCEPTION_ILLEGAL_DATA_ADDRESS);
+
+            table_.holdingRegisters[address] = read16_(frame_ + 4);
+            if(table_.written) table_.written(address, 1);
+            // The response echoes the request
+            return 6;
+        }
+
+        case FUNCTION_WRITE_MULTIPLE_REGISTERS: {
+            if(length < 7) return exception_(EXCEPTION_ILLEGAL_DATA_VALUE);
+            uint16_t address = read16_(frame_ + 2);
+            uint16_t count = read16_(frame_ + 4);
+            uint8_t byteCount = frame_[6];
+
+            if(count == 0 || count > 123 || byteCount != count * 2 || length != 7u + byteCount) return exception_(EXCEPTION_ILLEGAL_DATA_VALUE);
+            if((uint32_t)address + count > table_.holdingRegisterCount) return exception_(EXCEPTION_ILLEGAL_DATA_ADDRESS);
+
+            for(uint16_t i = 0; i < count; i++) table_.holdingRegisters[address + i] = read16_(frame_ + 7 + 2 * i);
+            if(table_.written) table_.written(address, count);
+            // The response echoes the address and the count
+            return 6;
+        }
+
+        default:
+            return exception_(EXCEPTION_ILLEGAL_FUNCTION);
+    }
+}
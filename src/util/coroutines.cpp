@@ -5,6 +5,9 @@
 #include <vector>
 #include <algorithm>
 
+#undef LIBEMBED_DEBUG_MODULE
+#define LIBEMBED_DEBUG_MODULE embed::debug::MODULE_COROUTINES
+
 using namespace embed;
 
 #if LIBEMBED_CONFIG_ENABLE_COROUTINES == true
@@ -15,6 +18,7 @@ using namespace embed;
 // *** Global variables ***
 static std::vector<coroutines::Coroutine_Base*> activeCoroutines_ = {};
 static size_t currentContext_ = NO_COROUTINE;
+static uint16_t nextId_ = 1;
 
 coroutines::Coroutine_Base* coroutines::current;
 
@@ -22,10 +26,13 @@ void coroutines::enterScheduler() {
     libembed_debug_info("Entering coroutine scheduler...");
     while(1) {
         for(currentContext_ = 0; currentContext_ < activeCoroutines_.size(); currentContext_++) {
+            if(activeCoroutines_[currentContext_]->isTraced) libembed_debug_trace("Rescheduling to coroutine {}", activeCoroutines_[currentContext_]->name);
+
             embed::coroutines::current = activeCoroutines_[currentContext_];
-            
-            libembed_debug_trace("Rescheduling to coroutine " + activeCoroutines_[currentContext_]->name);
             activeCoroutines_[currentContext_]->__start_or_resume();
+
+            // Back in the scheduler, records must not carry the id of the coroutine
+            embed::coroutines::current = nullptr;
         }
     }
 }
@@ -36,7 +43,7 @@ void coroutines::__yield() {
 }
 
 // *** coroutines::Coroutine_Base class ***
-coroutines::Coroutine_Base::Coroutine_Base(size_t stackSize) : stackSize(stackSize) {
+coroutines::Coroutine_Base::Coroutine_Base(size_t stackSize) : stackSize(stackSize), id(nextId_++) {
 }
 
 coroutines::Coroutine_Base::~Coroutine_Base() {
@@ -49,7 +56,7 @@ void coroutines::Coroutine_Base::start() {
         isActive = true;
         isPaused = false;
         exitReason_ = EXIT_REASON_NONE;
-        libembed_debug_trace("Coroutine " + name + " started.");
+        libembed_debug_trace("Coroutine {} started.", name, debug::field("id", id));
     }
 }
 
@@ -58,7 +65,7 @@ void coroutines::Coroutine_Base::stop() {
     this->isActive = false;
     this->wasCalled_ = false;
     this->isPaused = false;
-    libembed_debug_trace("Coroutine " + this->name + " stopped.");
+    libembed_debug_trace("Coroutine {} stopped.", this->name);
 }
 
 void coroutines::Coroutine_Base::pause() {
@@ -93,7 +100,7 @@ void coroutines::Coroutine_Base::__start_or_resume() {
     if(isPaused) return; // Don't resume if the coroutine is currently paused
     CoroutineState state = (CoroutineState)setjmp(yieldBuf_);
     if(state == SETJMP_EXECUTED) {
-        libembed_debug_trace("Coroutine " + name + " resuming...");
+        if(isTraced) libembed_debug_trace("Coroutine {} resuming...", name);
         if(!wasCalled_) {
             wasCalled_ = true;
             runFromEntryPoint_();
@@ -101,13 +108,13 @@ void coroutines::Coroutine_Base::__start_or_resume() {
             longjmp(resumeBuf_, 1); // Jump back into the coroutine
         }
     } else if(state == YIELDED) {
-        libembed_debug_trace("Coroutine " + name + " yielded.");
+        if(isTraced) libembed_debug_trace("Coroutine {} yielded.", name);
     } else if(state == EXITED) {
-        libembed_debug_info("Coroutine " + name + " exited.");
+        libembed_debug_info("Coroutine {} exited.", name);
         this->stop();
         this->exitReason_ = EXIT_REASON_RETURN;
     } else if(state == ERRORED) {
-        libembed_debug_info("Coroutine " + name + " errored.");
+        libembed_debug_info("Coroutine {} errored.", name);
         this->stop();
         this->exitReason_ = EXIT_REASON_ERRORED;
     }
@@ -144,6 +151,11 @@ void coroutines::Lock::release_noyield() {
     locked_ = false;
 }
 
+void coroutines::Event::wait() {
+    while(!set_) yield;
+    set_ = false;
+}
+
 #else
 
 void coroutines::Lock::acquire() { }
@@ -152,4 +164,9 @@ void coroutines::Lock::release() { }
 
 void coroutines::Lock::release_noyield() { }
 
+void coroutines::Event::wait() {
+    while(!set_);
+    set_ = false;
+}
+
 #endif
\ No newline at end of file
@@ -0,0 +1,39 @@
+#include <libembed/util/crc.h>
+
+using namespace embed;
+
+// The tables are generated at compile time, so they end up in flash
+
+static constexpr std::array<uint16_t, 256> crc16Table_() {
+    std::array<uint16_t, 256> table = {};
+    for(uint32_t i = 0; i < 256; i++) {
+        uint16_t crc = i << 8;
+        for(int bit = 0; bit < 8; bit++) crc = crc & 0x8000 ? (crc << 1) ^ 0x1021 : crc << 1;
+        table[i] = crc;
+    }
+    return table;
+}
+
+static constexpr std::array<uint32_t, 256> crc32Table_() {
+    std::array<uint32_t, 256> table = {};
+    for(uint32_t i = 0; i < 256; i++) {
+        uint32_t crc = i;
+        for(int bit = 0; bit < 8; bit++) crc = crc & 1 ? (crc >> 1) ^ 0xEDB88320 : crc >> 1;
+        table[i] = crc;
+    }
+    return table;
+}
+
+static constexpr std::array<uint16_t, 256> crc16ModbusTable_() {
+    std::array<uint16_t, 256> table = {};
+    for(uint32_t i = 0; i < 256; i++) {
+        uint16_t crc = i;
+        for(int bit = 0; bit < 8; bit++) crc = crc & 1 ? (crc >> 1) ^ 0xA001 : crc >> 1;
+        table[i] = crc;
+    }
+    return table;
+}
+
+constexpr std::array<uint16_t, 256> crc::__crc16Table = crc16Table_();
+constexpr std::array<uint32_t, 256> crc::__crc32Table = crc32Table_();
+constexpr std::array<uint16_t, 256> crc::__crc16ModbusTable = crc16ModbusTable_();
@@ -1,27 +1,433 @@
 #include <libembed/util/debug.h>
+#include <libembed/util/ringbuffer.h>
+#include <libembed/util/format.h>
+#include <libembed/util/coroutines.h>
+#include <libembed/hal/clock/types.h>
 
 #if LIBEMBED_CONFIG_ENABLE_DEBUGGING == true
 
-static void __dummy_write(std::string _) { };
-void (*embed::debug::writeStringPtr)(std::string) = __dummy_write;
+#undef LIBEMBED_DEBUG_MODULE
+#define LIBEMBED_DEBUG_MODULE embed::debug::MODULE_DEBUG
 
-static void __printDebug(std::string level, std::string message, std::string functionName) {
-    int paddingLength = LIBEMBED_CONFIG_DEBUG_FUNCTION_NAME_MAXLEN - functionName.length();
-    if(paddingLength < 0) paddingLength = 1;
-    std::string padding(paddingLength, ' ');
-    embed::debug::writeStringPtr(
-        "[" + level + "]\t" +
-        functionName + "()" + padding +
-        message + "\r\n"
-    );
+using namespace embed;
+
+// Log buffer containing the serialized records
+static util::RingBuffer<uint32_t, LIBEMBED_CONFIG_DEBUG_BUFFER_SIZE> logBuffer_;
+
+// Records are copied out of the log buffer before emitting them, so the buffer
+// can be modified (e.g. by dropping the oldest records) while the sinks are busy
+static uint32_t drainBuffer_[debug::__maxRecordWords];
+static bool draining_ = false;
+
+// Stored inverted, so all levels are enabled after zero-initialization
+debug::LevelMask debug::__disabledLevels[debug::MODULE_COUNT];
+
+static debug::OverflowPolicy overflowPolicy_ = debug::OVERFLOW_DROP_NEWEST;
+static uint32_t droppedRecords_ = 0;
+
+//! Registered sink
+struct Sink_ {
+    //! Sink function, or `nullptr` if the slot is unused
+    debug::SinkFunction write;
+    debug::OutputMode mode;
+    debug::LevelMask levels;
+};
+
+static Sink_ sinks_[LIBEMBED_CONFIG_DEBUG_MAX_SINKS];
+
+/**
+ * @brief Gets the length of a record in the log buffer.
+ *
+ * @param offset Offset of the record relative to the oldest word in the buffer.
+ * @return Returns the length of the record in words.
+ */
+static size_t recordLength_(size_t offset) {
+    uint32_t siteWords[debug::__pointerWords];
+    for(size_t i = 0; i < debug::__pointerWords; i++) siteWords[i] = logBuffer_.peek(offset + i);
+
+    const debug::LogSite* site;
+    memcpy(&site, siteWords, sizeof(site));
+
+    size_t length = debug::__headerWords;
+    for(const uint8_t* type = site->argumentTypes; *type != debug::ARG_END; type++) {
+        if(*type & debug::ARG_FIELD) length += debug::__pointerWords;
+        switch(*type & ~debug::ARG_FIELD) {
+            case debug::ARG_STRING:
+                length += 1 + (logBuffer_.peek(offset + length) + sizeof(uint32_t) - 1) / sizeof(uint32_t);
+                break;
+            case debug::ARG_UNSIGNED64:
+            case debug::ARG_SIGNED64:
+            case debug::ARG_DOUBLE:
+                length += 2;
+                break;
+            default:
+                length += 1;
+                break;
+        }
+    }
+    return length;
 }
 
-void embed::debug::info(std::string message, std::string functionName) {
-    __printDebug("INFO", message, functionName);
+// *** Text rendering ***
+
+static const char* const levelNames_[] = { "INFO", "TRACE" };
+static const char* const moduleNames_[] = { "user", "debug", "coroutines", "exceptions", "bsp", "uart", "i2c" };
+static_assert(sizeof(moduleNames_) / sizeof(moduleNames_[0]) == debug::MODULE_COUNT, "Missing module name.");
+
+// Line rendered in the text mode; two additional characters are reserved for the line ending
+static char line_[LIBEMBED_CONFIG_DEBUG_LINE_LENGTH + 2];
+static size_t lineLength_ = 0;
+
+/**
+ * @brief Decodes the next argument of a record.
+ *
+ * @param pos Read position in the record. Advanced past the argument.
+ * @param type The @ref debug::ArgumentType of the argument.
+ * @param argument The decoded argument.
+ * @return Returns the key of the argument if it is a field, or `nullptr` otherwise.
+ */
+static const char* decodeArgument_(const uint32_t*& pos, uint8_t type, format::Argument& argument) {
+    const char* key = nullptr;
+    if(type & debug::ARG_FIELD) {
+        memcpy(&key, pos, sizeof(key));
+        pos += debug::__pointerWords;
+    }
+
+    switch(type & ~debug::ARG_FIELD) {
+        case debug::ARG_STRING:
+            argument.type = format::TYPE_STRING;
+            argument.length = *pos++;
+            argument.string = (const char*)pos;
+            pos += (argument.length + sizeof(uint32_t) - 1) / sizeof(uint32_t);
+            break;
+        case debug::ARG_UNSIGNED64:
+        case debug::ARG_SIGNED64:
+            argument.type = (type & ~debug::ARG_FIELD) == debug::ARG_SIGNED64 ? format::TYPE_SIGNED : format::TYPE_UNSIGNED;
+            argument.integer = pos[0] | (uint64_t)pos[1] << 32;
+            pos += 2;
+            break;
+        case debug::ARG_DOUBLE:
+            argument.type = format::TYPE_FLOAT;
+            memcpy(&argument.real, pos, sizeof(double));
+            pos += 2;
+            break;
+        case debug::ARG_FLOAT: {
+            float real;
+            memcpy(&real, pos++, sizeof(float));
+            argument.type = format::TYPE_FLOAT;
+            argument.real = real;
+            break;
+        }
+        case debug::ARG_SIGNED:
+            argument.type = format::TYPE_SIGNED;
+            argument.integer = (uint64_t)(int64_t)(int32_t)*pos++;
+            break;
+        case debug::ARG_CHAR:
+            argument.type = format::TYPE_CHAR;
+            argument.integer = *pos++;
+            break;
+        case debug::ARG_BOOL:
+            argument.type = format::TYPE_BOOL;
+            argument.integer = *pos++;
+            break;
+        case debug::ARG_POINTER:
+            argument.type = format::TYPE_POINTER;
+            argument.integer = *pos++;
+            break;
+        default:
+            argument.type = format::TYPE_UNSIGNED;
+            argument.integer = *pos++;
+            break;
+    }
+    return key;
 }
 
-void embed::debug::trace(std::string message, std::string functionName) {
-    __printDebug("TRACE", message, functionName);
+/**
+ * @brief Renders the message of a record, followed by its fields.
+ *
+ * Arguments are decoded from the record one by one, so this doesn't use
+ * @ref format::__vformat().
+ *
+ * @param output The output to render to.
+ * @param site The call site of the record.
+ * @param arguments Pointer to the first argument of the record.
+ */
+static void renderMessage_(format::Output& output, const debug::LogSite* site, const uint32_t* arguments) {
+    const uint8_t* type = site->argumentTypes;
+    const uint32_t* pos = arguments;
+    format::Argument argument;
+
+    const char* text = site->format;
+    while(*text) {
+        char c = *text++;
+        if((c == '{' || c == '}') && *text == c) {
+            // Escaped brace
+            output.put(c);
+            text++;
+            continue;
+        }
+        format::Spec spec;
+        const char* next = c == '{' ? format::__parseSpec(text, spec) : nullptr;
+        if(!next) {
+            output.put(c);
+            continue;
+        }
+        text = next;
+
+        // Fields are not used as positional arguments
+        while(*type & debug::ARG_FIELD) decodeArgument_(pos, *type++, argument);
+        if(*type == debug::ARG_END) {
+            output.put("{?}");
+            continue;
+        }
+        decodeArgument_(pos, *type++, argument);
+        format::__formatArgument(output, argument, spec);
+    }
+
+    pos = arguments;
+    for(type = site->argumentTypes; *type != debug::ARG_END; type++) {
+        const char* key = decodeArgument_(pos, *type, argument);
+        if(key) {
+            output.put(' ');
+            output.put(key);
+            output.put('=');
+            format::__formatArgument(output, argument, format::Spec());
+        }
+    }
+}
+
+/**
+ * @brief Renders a record as a line of text into @ref line_.
+ *
+ * @param record Pointer to the record.
+ */
+static void renderRecord_(const uint32_t* record) {
+    const debug::LogSite* site;
+    memcpy(&site, record, sizeof(site));
+
+    // Text exceeding the line length is discarded
+    format::Output output(line_, LIBEMBED_CONFIG_DEBUG_LINE_LENGTH);
+    output.put('[');
+    output.put(site->level < sizeof(levelNames_) / sizeof(levelNames_[0]) ? levelNames_[site->level] : "?");
+    output.put("]\t[");
+    output.put(site->module < debug::MODULE_COUNT ? moduleNames_[site->module] : "?");
+    output.put("]\t@");
+    format::__formatArgument(output, format::__argument(record[debug::__pointerWords]), format::Spec());
+    output.put("\t#");
+    format::__formatArgument(output, format::__argument(record[debug::__pointerWords + 1]), format::Spec());
+    output.put('\t');
+
+    size_t functionStart = output.length();
+    output.put(site->function);
+    output.put("()");
+    size_t functionLength = output.length() - functionStart;
+    output.repeat(' ', functionLength < LIBEMBED_CONFIG_DEBUG_FUNCTION_NAME_MAXLEN + 2 ? LIBEMBED_CONFIG_DEBUG_FUNCTION_NAME_MAXLEN + 2 - functionLength : 1);
+
+    renderMessage_(output, site, record + debug::__headerWords);
+    lineLength_ = output.buffered();
+    line_[lineLength_++] = '\r';
+    line_[lineLength_++] = '\n';
+}
+
+// *** Log buffer ***
+
+/**
+ * @brief Emits the oldest record to all sinks whose level mask contains its level.
+ *
+ * @return Returns the length of the emitted record in words, or 0 if there was nothing
+ * to emit or if this was called recursively (i.e. from a log call inside a sink).
+ */
+static size_t drainRecord_() {
+    if(draining_ || logBuffer_.empty()) return 0;
+    draining_ = true;
+
+    size_t length = recordLength_(0);
+    logBuffer_.read(drainBuffer_, length);
+
+    const debug::LogSite* site;
+    memcpy(&site, drainBuffer_, sizeof(site));
+
+    // The record is rendered at most once, no matter how many sinks use the text mode
+    bool rendered = false;
+    for(const Sink_& sink : sinks_) {
+        if(!sink.write || !(sink.levels & (1 << site->level))) continue;
+        if(sink.mode == debug::OUTPUT_BINARY) {
+            sink.write((const uint8_t*)drainBuffer_, length * sizeof(uint32_t));
+        } else {
+            if(!rendered) {
+                renderRecord_(drainBuffer_);
+                rendered = true;
+            }
+            sink.write((const uint8_t*)line_, lineLength_);
+        }
+    }
+
+    draining_ = false;
+    return length;
+}
+
+void debug::__commit(uint32_t* record, size_t length) {
+    record[__pointerWords] = clock::getTimestamp();
+    #if LIBEMBED_CONFIG_ENABLE_COROUTINES == true
+        record[__pointerWords + 1] = coroutines::current ? coroutines::current->id : 0;
+    #else
+        record[__pointerWords + 1] = 0;
+    #endif
+
+    if(logBuffer_.free() < length) {
+        switch(overflowPolicy_) {
+            case OVERFLOW_DROP_OLDEST:
+                // Log calls are never made from interrupt handlers, so the tail
+                // can safely be moved from this side as well
+                while(logBuffer_.free() < length && !logBuffer_.empty()) {
+                    logBuffer_.consume(recordLength_(0));
+                    droppedRecords_++;
+                }
+                break;
+
+            case OVERFLOW_BLOCK:
+                while(logBuffer_.free() < length && drainRecord_());
+                break;
+
+            default:
+                break;
+        }
+
+        if(logBuffer_.free() < length) {
+            droppedRecords_++;
+            return;
+        }
+    }
+    // Records are never split, so a partial record can never reach the host
+    logBuffer_.write(record, length);
+}
+
+
+void debug::flush() {
+    while(drainRecord_());
 }
 
-#endif
\ No newline at end of file
+bool debug::addSink(SinkFunction write, OutputMode mode, LevelMask levels) {
+    Sink_* freeSlot = nullptr;
+    for(Sink_& sink : sinks_) {
+        if(sink.write == write) {
+            freeSlot = &sink;
+            break;
+        }
+        if(!sink.write && !freeSlot) freeSlot = &sink;
+    }
+    if(!freeSlot) return false;
+
+    freeSlot->mode = mode;
+    freeSlot->levels = levels;
+    freeSlot->write = write;
+    return true;
+}
+
+void debug::removeSink(SinkFunction write) {
+    for(Sink_& sink : sinks_) {
+        if(sink.write == write) sink.write = nullptr;
+    }
+}
+
+void debug::setLevelMask(Module module, LevelMask mask) {
+    __disabledLevels[module] = ~mask;
+}
+
+void debug::setLevelMask(LevelMask mask) {
+    for(LevelMask& disabledLevels : __disabledLevels) disabledLevels = ~mask;
+}
+
+void debug::setOverflowPolicy(OverflowPolicy policy) {
+    overflowPolicy_ = policy;
+}
+
+uint32_t debug::droppedRecords() {
+    return droppedRecords_;
+}
+
+#if LIBEMBED_CONFIG_DEBUG_CRASH_BUFFER_SIZE > 0
+
+static_assert((LIBEMBED_CONFIG_DEBUG_CRASH_BUFFER_SIZE & (LIBEMBED_CONFIG_DEBUG_CRASH_BUFFER_SIZE - 1)) == 0,
+    "The crash buffer size must be a power of two.");
+
+#define CRASH_BUFFER_MAGIC 0x4C4F4721
+
+// Retained across warm resets, so it is neither zeroed nor initialized by the startup code
+static struct {
+    uint32_t magic;
+    //! Free-running write index
+    uint32_t head;
+    //! Inverted copy of the write index, used for detecting random RAM contents after a power-on reset
+    uint32_t headCheck;
+    uint8_t data[LIBEMBED_CONFIG_DEBUG_CRASH_BUFFER_SIZE];
+} crashBuffer_ __attribute__((section(LIBEMBED_CONFIG_DEBUG_CRASH_BUFFER_SECTION)));
+
+static bool crashBufferValid_() {
+    return crashBuffer_.magic == CRASH_BUFFER_MAGIC && crashBuffer_.headCheck == ~crashBuffer_.head;
+}
+
+void debug::crashBufferSink(const uint8_t* data, size_t length) {
+    if(!crashBufferValid_()) {
+        crashBuffer_.head = 0;
+        crashBuffer_.magic = CRASH_BUFFER_MAGIC;
+    }
+    uint32_t head = crashBuffer_.head;
+    for(size_t i = 0; i < length; i++) {
+        crashBuffer_.data[head++ & (LIBEMBED_CONFIG_DEBUG_CRASH_BUFFER_SIZE - 1)] = data[i];
+    }
+    crashBuffer_.head = head;
+    crashBuffer_.headCheck = ~head;
+}
+
+bool debug::dumpCrashBuffer(SinkFunction write) {
+    if(!crashBufferValid_() || crashBuffer_.head == 0) return false;
+
+    uint32_t head = crashBuffer_.head;
+    size_t length = head < LIBEMBED_CONFIG_DEBUG_CRASH_BUFFER_SIZE ? head : LIBEMBED_CONFIG_DEBUG_CRASH_BUFFER_SIZE;
+    size_t start = (head - length) & (LIBEMBED_CONFIG_DEBUG_CRASH_BUFFER_SIZE - 1);
+    size_t firstLength = LIBEMBED_CONFIG_DEBUG_CRASH_BUFFER_SIZE - start;
+    if(firstLength > length) firstLength = length;
+
+    write(crashBuffer_.data + start, firstLength);
+    if(length > firstLength) write(crashBuffer_.data, length - firstLength);
+
+    crashBuffer_.magic = 0;
+    return true;
+}
+
+#endif
+
+#if LIBEMBED_CONFIG_ENABLE_COROUTINES == true
+
+static void drainEntryPoint_() {
+    uint32_t reportedDroppedRecords = 0;
+    while(1) {
+        // Emit a block of records per scheduler pass
+        for(size_t words = 0; words < debug::__maxRecordWords; ) {
+            size_t length = drainRecord_();
+            if(!length) break;
+            words += length;
+        }
+
+        uint32_t droppedRecords = droppedRecords_;
+        if(droppedRecords != reportedDroppedRecords) {
+            libembed_debug_info("{} log records dropped", droppedRecords - reportedDroppedRecords);
+            reportedDroppedRecords = droppedRecords;
+        }
+
+        yield;
+    }
+}
+
+static coroutines::Coroutine<LIBEMBED_CONFIG_DEBUG_DRAIN_STACK_SIZE> drainCoroutine_{ drainEntryPoint_ };
+
+void debug::startDrainCoroutine() {
+    drainCoroutine_.name = "debug-drain";
+    drainCoroutine_.isTraced = false;
+    drainCoroutine_.start();
+}
+
+#endif
+
+#endif
@@ -1,6 +1,9 @@
 #include <libembed/util/exceptions.h>
 #include <libembed/util/debug.h>
 
+#undef LIBEMBED_DEBUG_MODULE
+#define LIBEMBED_DEBUG_MODULE embed::debug::MODULE_EXCEPTIONS
+
 using namespace embed;
 
 bool exceptions::__throwTarget = false;
@@ -9,7 +12,10 @@ exceptions::exception exceptions::__currentException("<none>");
 int exceptions::__setjmpRetVal;
 
 static void __rootExceptionHandler() {
-    libembed_debug_info("Uncaught exception: " + std::string(exceptions::__currentException.message));
+    libembed_debug_info("Uncaught exception: {}", exceptions::__currentException.message);
+    #if LIBEMBED_CONFIG_ENABLE_DEBUGGING
+        debug::flush();
+    #endif
     while(1);
 }
 
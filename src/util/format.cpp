@@ -0,0 +1,326 @@
+#include <libembed/util/format.h>
+
+using namespace embed;
+
+void format::Output::put(const char* data, size_t length) {
+    while(length) {
+        if(used_ == size_) flush();
+        size_t count = size_ - used_;
+        if(count == 0) {
+            // Without a flush function, the remaining characters are discarded
+            total_ += length;
+            return;
+        }
+        if(count > length) count = length;
+        memcpy(buffer_ + used_, data, count);
+        used_ += count;
+        total_ += count;
+        data += count;
+        length -= count;
+    }
+}
+
+void format::Output::repeat(char c, size_t count) {
+    while(count--) put(c);
+}
+
+void format::Output::flush() {
+    if(!flush_ || used_ == 0) return;
+    flush_(context_, buffer_, used_);
+    used_ = 0;
+}
+
+const char* format::__parseSpec(const char* format, Spec& spec) {
+    // Explicit argument indices are not supported and ignored
+    while(*format >= '0' && *format <= '9') format++;
+    if(*format == ':') {
+        format++;
+        auto isAlign = [](char c) { return c == '<' || c == '>' || c == '^'; };
+        if(format[0] && format[0] != '}' && isAlign(format[1])) {
+            spec.fill = *format++;
+            spec.align = *format++;
+        } else if(isAlign(*format)) {
+            spec.align = *format++;
+        }
+        if(*format == '+' || *format == ' ') spec.sign = *format++;
+        else if(*format == '-') format++;
+        if(*format == '#') { spec.alternate = true; format++; }
+        if(*format == '0') { spec.zeroPad = true; format++; }
+        while(*format >= '0' && *format <= '9') spec.width = spec.width * 10 + *format++ - '0';
+        if(*format == '.') {
+            format++;
+            spec.precision = 0;
+            while(*format >= '0' && *format <= '9') spec.precision = spec.precision * 10 + *format++ - '0';
+        }
+        if(*format && *format != '}') spec.type = *format++;
+    }
+    return *format == '}' ? format + 1 : nullptr;
+}
+
+/**
+ * @brief Writes a rendered value padded according to its format specification.
+ *
+ * @param spec The format specification.
+ * @param prefix Sign and base prefix, which are placed before zero padding.
+ * @param body The rendered value.
+ * @param defaultAlign Alignment used if the specification does not contain one.
+ */
+static void pad_(format::Output& output, const format::Spec& spec, const char* prefix, size_t prefixLength, const char* body, size_t bodyLength, char defaultAlign) {
+    size_t length = prefixLength + bodyLength;
+    size_t padding = spec.width > length ? spec.width - length : 0;
+
+    if(spec.zeroPad && !spec.align && defaultAlign == '>') {
+        output.put(prefix, prefixLength);
+        output.repeat('0', padding);
+        output.put(body, bodyLength);
+        return;
+    }
+
+    char align = spec.align ? spec.align : defaultAlign;
+    char fill = spec.zeroPad && !spec.align ? '0' : spec.fill;
+    size_t before = align == '>' ? padding : align == '^' ? padding / 2 : 0;
+    output.repeat(fill, before);
+    output.put(prefix, prefixLength);
+    output.put(body, bodyLength);
+    output.repeat(fill, padding - before);
+}
+
+/**
+ * @brief Renders the digits of an unsigned integer right-aligned into a buffer.
+ *
+ * @param end Pointer past the end of the buffer.
+ * @return Returns the number of digits rendered.
+ */
+static size_t renderDigits_(char* end, uint64_t value, unsigned int base, bool upper) {
+    const char* digits = upper ? "0123456789ABCDEF" : "0123456789abcdef";
+    char* pos = end;
+    // 64-bit divisions are expensive on Cortex-M, so only use them if required
+    while(value > UINT32_MAX) {
+        *--pos = digits[value % base];
+        value /= base;
+    }
+    uint32_t value32 = (uint32_t)value;
+    do {
+        *--pos = digits[value32 % base];
+        value32 /= base;
+    } while(value32);
+    return end - pos;
+}
+
+static void renderInteger_(format::Output& output, uint64_t magnitude, bool negative, const format::Spec& spec, size_t minDigits = 1) {
+    unsigned int base = 10;
+    const char* basePrefix = "";
+    switch(spec.type) {
+        case 'x': base = 16; basePrefix = "0x"; break;
+        case 'X': base = 16; basePrefix = "0X"; break;
+        case 'o': base = 8; basePrefix = "0o"; break;
+        case 'b': base = 2; basePrefix = "0b"; break;
+    }
+
+    char prefix[3];
+    size_t prefixLength = 0;
+    if(negative) prefix[prefixLength++] = '-';
+    else if(spec.sign) prefix[prefixLength++] = spec.sign;
+    if(spec.alternate && *basePrefix) {
+        prefix[prefixLength++] = basePrefix[0];
+        prefix[prefixLength++] = basePrefix[1];
+    }
+
+    char digits[64];
+    size_t length = renderDigits_(digits + sizeof(digits), magnitude, base, spec.type == 'X');
+    while(length < minDigits) digits[sizeof(digits) - ++length] = '0';
+    pad_(output, spec, prefix, prefixLength, digits + sizeof(digits) - length, length, '>');
+}
+
+/**
+ * @brief Renders a decimal number which has already been split into its integer and fractional part.
+ *
+ * @param integer The integer part.
+ * @param fraction The fractional part, multiplied by 10 ^ @p precision.
+ * @param precision The number of decimals.
+ * @param trim Specifies if trailing zeros of the decimals are removed.
+ * @param exponent Decimal exponent, or 0 for fixed-point notation.
+ */
+static void renderDecimal_(format::Output& output, const format::Spec& spec, const char* prefix, size_t prefixLength,
+        uint64_t integer, uint32_t fraction, int precision, bool trim, int exponent) {
+    char body[48];
+    char* end = body + 24;
+    char* start = end - renderDigits_(end, integer, 10, false);
+    if(precision > 0) {
+        char* point = end;
+        *end++ = '.';
+        end += precision;
+        for(char* pos = end; pos > point + 1; fraction /= 10) *--pos = '0' + fraction % 10;
+        if(trim) {
+            while(end[-1] == '0' && end[-2] != '.') end--;
+        }
+    } else if(spec.alternate) {
+        *end++ = '.';
+    }
+    if(exponent) {
+        char digits[3];
+        size_t length = renderDigits_(digits + sizeof(digits), exponent, 10, false);
+        *end++ = 'e';
+        *end++ = '+';
+        if(length < 2) *end++ = '0';
+        memcpy(end, digits + sizeof(digits) - length, length);
+        end += length;
+    }
+    pad_(output, spec, prefix, prefixLength, start, end - start, '>');
+}
+
+/**
+ * @brief Gets the number of decimals of a floating or fixed-point value.
+ *
+ * Without an explicit precision, six decimals are used and trailing zeros are removed like
+ * Python's repr(). The precision is limited to 9, so the decimals fit into 32 bits.
+ */
+static int decimalPrecision_(const format::Spec& spec, bool& trim) {
+    trim = spec.precision < 0 && spec.type != 'f' && spec.type != 'F';
+    return spec.precision < 0 ? 6 : spec.precision > 9 ? 9 : spec.precision;
+}
+
+static uint32_t powerOf10_(int exponent) {
+    uint32_t value = 1;
+    while(exponent--) value *= 10;
+    return value;
+}
+
+static void renderFloat_(format::Output& output, double value, const format::Spec& spec) {
+    char prefix[1];
+    size_t prefixLength = 0;
+    if(value < 0) {
+        prefix[prefixLength++] = '-';
+        value = -value;
+    } else if(spec.sign) {
+        prefix[prefixLength++] = spec.sign;
+    }
+
+    if(value != value) return pad_(output, spec, prefix, prefixLength, "nan", 3, '>');
+    if(value > 1.7976931348623157e308) return pad_(output, spec, prefix, prefixLength, "inf", 3, '>');
+
+    bool trim;
+    int precision = decimalPrecision_(spec, trim);
+    uint32_t scale = powerOf10_(precision);
+
+    // Values not representable in fixed-point notation are rendered in scientific notation
+    int exponent = 0;
+    if(value * scale >= 1.8e19) {
+        while(value >= 10) {
+            value /= 10;
+            exponent++;
+        }
+    }
+
+    uint64_t scaled = (uint64_t)(value * scale + 0.5);
+    renderDecimal_(output, spec, prefix, prefixLength, scaled / scale, scaled % scale, precision, trim, exponent);
+}
+
+static void renderFixed_(format::Output& output, int64_t raw, uint8_t fractionalBits, const format::Spec& spec) {
+    char prefix[1];
+    size_t prefixLength = 0;
+    if(raw < 0) prefix[prefixLength++] = '-';
+    else if(spec.sign) prefix[prefixLength++] = spec.sign;
+
+    if(fractionalBits > 32) fractionalBits = 32;
+    uint64_t magnitude = raw < 0 ? -(uint64_t)raw : (uint64_t)raw;
+    uint64_t integer = magnitude >> fractionalBits;
+    uint64_t fractionBits = magnitude & (((uint64_t)1 << fractionalBits) - 1);
+
+    bool trim;
+    int precision = decimalPrecision_(spec, trim);
+    uint32_t scale = powerOf10_(precision);
+
+    // Round to the nearest decimal; the product fits into 64 bits as the scale is below 2 ^ 30
+    uint64_t fraction = fractionalBits ? (fractionBits * scale + ((uint64_t)1 << (fractionalBits - 1))) >> fractionalBits : 0;
+    if(fraction >= scale) {
+        integer++;
+        fraction -= scale;
+    }
+    renderDecimal_(output, spec, prefix, prefixLength, integer, (uint32_t)fraction, precision, trim, 0);
+}
+
+void format::__formatArgument(Output& output, const Argument& argument, const Spec& spec) {
+    bool numeric = spec.type && strchr("dxXob", spec.type);
+    switch(argument.type) {
+        case TYPE_STRING: {
+            size_t length = argument.length;
+            if(spec.precision >= 0 && (size_t)spec.precision < length) length = spec.precision;
+            pad_(output, spec, nullptr, 0, argument.string, length, '<');
+            break;
+        }
+        case TYPE_BOOL:
+            if(numeric) renderInteger_(output, argument.integer != 0, false, spec);
+            else if(argument.integer) pad_(output, spec, nullptr, 0, "True", 4, '<');
+            else pad_(output, spec, nullptr, 0, "False", 5, '<');
+            break;
+        case TYPE_CHAR:
+            if(numeric) renderInteger_(output, argument.integer & 0xFF, false, spec);
+            else {
+                char c = (char)argument.integer;
+                pad_(output, spec, nullptr, 0, &c, 1, '<');
+            }
+            break;
+        case TYPE_POINTER:
+            if(spec.type) {
+                renderInteger_(output, argument.integer, false, spec);
+            } else {
+                Spec pointerSpec = spec;
+                pointerSpec.type = 'x';
+                pointerSpec.alternate = true;
+                renderInteger_(output, argument.integer, false, pointerSpec, 8);
+            }
+            break;
+        case TYPE_FLOAT:
+            renderFloat_(output, argument.real, spec);
+            break;
+        case TYPE_FIXED:
+            renderFixed_(output, (int64_t)argument.integer, argument.fractionalBits, spec);
+            break;
+        default: {
+            bool negative = argument.type == TYPE_SIGNED && (int64_t)argument.integer < 0;
+            uint64_t magnitude = negative ? -argument.integer : argument.integer;
+            if(spec.type == 'c') {
+                char c = (char)argument.integer;
+                pad_(output, spec, nullptr, 0, &c, 1, '<');
+            } else {
+                renderInteger_(output, magnitude, negative, spec);
+            }
+            break;
+        }
+    }
+}
+
+void format::__vformat(Output& output, const char* format, const Argument* arguments, size_t count) {
+    size_t index = 0;
+    while(*format) {
+        // Copy the literal text up to the next brace at once
+        const char* literal = format;
+        while(*format && *format != '{' && *format != '}') format++;
+        if(format != literal) {
+            output.put(literal, format - literal);
+            continue;
+        }
+
+        char c = *format++;
+        if(*format == c) {
+            // Escaped brace
+            output.put(c);
+            format++;
+            continue;
+        }
+        Spec spec;
+        const char* next = c == '{' ? __parseSpec(format, spec) : nullptr;
+        if(!next) {
+            output.put(c);
+            continue;
+        }
+        format = next;
+
+        if(index >= count) {
+            output.put("{?}");
+            continue;
+        }
+        __formatArgument(output, arguments[index++], spec);
+    }
+}